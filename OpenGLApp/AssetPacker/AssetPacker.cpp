@@ -0,0 +1,257 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#define STAT_STRUCT struct _stat64
+#define STAT_FUNCTION _stat64
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#define STAT_STRUCT struct stat
+#define STAT_FUNCTION stat
+#endif
+
+#include "AssetPackFormat.h"
+
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+using std::ifstream;
+using std::ofstream;
+
+/*
+    Builds the asset pack the app maps at startup (ASSET_PACK_FILE).
+
+    Run it from the folder the app runs in, with the folders to pack:
+
+        AssetPacker Assets.pack Assets Shaders MeshCache
+
+    Paths are stored the way the app asks for them. Run the app once
+    before packing, so the cooked textures, packed material maps and mesh
+    cache exist and go into the pack too. Virtual texture page files are
+    left out, they are read page by page from disk.
+*/
+
+struct PackedFile
+{
+    string location;            // As found on disk
+    string name;                // Normalized, what the app looks up
+    uint64_t pathHash;
+    uint64_t modifiedTime;
+    uint64_t size;
+    uint64_t offset;
+};
+
+static bool HasExtension(const string& location, const char* extension)
+{
+    size_t length = strlen(extension);
+    return location.size() >= length && location.compare(location.size() - length, length, extension) == 0;
+}
+
+static void AddFile(const string& location, vector<PackedFile>& files)
+{
+    if (HasExtension(location, ".vt") || HasExtension(location, ".pack")) return;
+
+    STAT_STRUCT fileInfo;
+
+    if (STAT_FUNCTION(location.c_str(), &fileInfo) != 0)
+    {
+        cerr << "\n\nERROR: Failed to read " << location << ".\n" << endl;
+        return;
+    }
+
+    PackedFile file;
+    file.location = location;
+    file.name = NormalizeAssetPath(location);
+    file.pathHash = HashFNV1a64(file.name);
+    file.modifiedTime = (uint64_t)fileInfo.st_mtime;
+    file.size = (uint64_t)fileInfo.st_size;
+    file.offset = 0;
+
+    files.push_back(file);
+}
+
+// Every file under location, or location itself when it's a file
+static void CollectFiles(const string& location, vector<PackedFile>& files)
+{
+#ifdef _WIN32
+    WIN32_FIND_DATAA findData;
+    HANDLE findHandle = FindFirstFileA((location + "/*").c_str(), &findData);
+
+    if (findHandle == INVALID_HANDLE_VALUE)
+    {
+        AddFile(location, files);
+        return;
+    }
+
+    do
+    {
+        string name = findData.cFileName;
+        if (name == "." || name == "..") continue;
+
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) CollectFiles(location + "/" + name, files);
+        else AddFile(location + "/" + name, files);
+    } while (FindNextFileA(findHandle, &findData));
+
+    FindClose(findHandle);
+#else
+    DIR* directory = opendir(location.c_str());
+
+    if (!directory)
+    {
+        AddFile(location, files);
+        return;
+    }
+
+    while (dirent* entry = readdir(directory))
+    {
+        string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+
+        string child = location + "/" + name;
+        STAT_STRUCT fileInfo;
+
+        if (STAT_FUNCTION(child.c_str(), &fileInfo) == 0 && S_ISDIR(fileInfo.st_mode)) CollectFiles(child, files);
+        else AddFile(child, files);
+    }
+
+    closedir(directory);
+#endif
+}
+
+static uint64_t AlignOffset(uint64_t offset)
+{
+    return (offset + ASSET_PACK_ALIGNMENT - 1) / ASSET_PACK_ALIGNMENT * ASSET_PACK_ALIGNMENT;
+}
+
+static void WritePadding(ofstream& fileStream, uint64_t from, uint64_t to)
+{
+    const char zeros[ASSET_PACK_ALIGNMENT] = {};
+    fileStream.write(zeros, (std::streamsize)(to - from));
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        cerr << "Usage: AssetPacker <output.pack> <folder or file>..." << endl;
+        return 1;
+    }
+
+    string packLocation = argv[1];
+    vector<PackedFile> files;
+
+    for (int i = 2; i < argc; i++)
+    {
+        CollectFiles(argv[i], files);
+    }
+
+    // Sorted by hash, the app binary searches the table
+    std::sort(files.begin(), files.end(), [](const PackedFile& a, const PackedFile& b)
+    {
+        return (a.pathHash != b.pathHash) ? a.pathHash < b.pathHash : a.name < b.name;
+    });
+
+    // The same file given twice, or two paths that only differ in case
+    files.erase(std::unique(files.begin(), files.end(), [](const PackedFile& a, const PackedFile& b)
+    {
+        if (a.name != b.name) return false;
+
+        cerr << "Skipping " << b.location << ", already packed as " << a.location << endl;
+        return true;
+    }), files.end());
+
+    // Header, table and names first, then the files
+    string names;
+    vector<AssetPackEntry> entries(files.size());
+
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        entries[i].nameOffset = (uint32_t)names.size();
+        entries[i].nameLength = (uint32_t)files[i].name.size();
+        names += files[i].name;
+    }
+
+    AssetPackHeader header = {};
+    header.magic = ASSET_PACK_MAGIC;
+    header.version = ASSET_PACK_VERSION;
+    header.entryCount = (uint32_t)files.size();
+    header.namesOffset = sizeof(AssetPackHeader) + entries.size() * sizeof(AssetPackEntry);
+    header.namesSize = names.size();
+
+    uint64_t offset = AlignOffset(header.namesOffset + header.namesSize);
+
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        files[i].offset = offset;
+
+        entries[i].pathHash = files[i].pathHash;
+        entries[i].offset = offset;
+        entries[i].size = files[i].size;
+        entries[i].modifiedTime = files[i].modifiedTime;
+
+        offset = AlignOffset(offset + files[i].size);
+    }
+
+    ofstream packStream(packLocation, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (!packStream.is_open())
+    {
+        cerr << "\n\nERROR: Failed to write " << packLocation << ".\n" << endl;
+        return 1;
+    }
+
+    packStream.write((const char*)&header, sizeof(header));
+    packStream.write((const char*)entries.data(), entries.size() * sizeof(AssetPackEntry));
+    packStream.write(names.data(), names.size());
+
+    uint64_t written = header.namesOffset + header.namesSize;
+    vector<char> contents;
+
+    for (const PackedFile& file : files)
+    {
+        WritePadding(packStream, written, file.offset);
+
+        ifstream fileStream(file.location, std::ios::in | std::ios::binary);
+        contents.resize((size_t)file.size);
+
+        if (!contents.empty()) fileStream.read(contents.data(), contents.size());
+
+        // The offsets are already in the table, so a file that changed size can't be packed
+        if (!fileStream.good() && !contents.empty())
+        {
+            cerr << "\n\nERROR: Failed to read " << file.location << " while packing.\n" << endl;
+            packStream.close();
+            remove(packLocation.c_str());
+            return 1;
+        }
+
+        packStream.write(contents.data(), contents.size());
+        written = file.offset + file.size;
+    }
+
+    packStream.close();
+
+    if (packStream.fail())
+    {
+        cerr << "\n\nERROR: Failed to write " << packLocation << ".\n" << endl;
+        remove(packLocation.c_str());
+        return 1;
+    }
+
+    cerr << "Packed " << files.size() << " files into " << packLocation << " (" << (written >> 20) << " MB)" << endl;
+
+    return 0;
+}
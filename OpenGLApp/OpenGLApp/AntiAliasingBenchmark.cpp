@@ -0,0 +1,95 @@
+#include "AntiAliasingBenchmark.h"
+
+#include <stdio.h>
+
+// Frames still in flight when the mode changes, plus the ones compiling the new passes
+static const uint32_t AA_BENCHMARK_SKIPPED_FRAMES = 8;
+
+AntiAliasingBenchmark::AntiAliasingBenchmark()
+{
+    running = false;
+    currentMode = AA_NONE;
+    skippedFrames = 0;
+    previousMode = AA_NONE;
+    width = 0;
+    height = 0;
+
+    for (ModeTimes& modeTimes : times)
+    {
+        modeTimes = { 0.0, 0.0, 0.0, 0 };
+    }
+}
+
+void AntiAliasingBenchmark::Start(AntiAliasingMode previousMode, uint32_t width, uint32_t height)
+{
+    this->previousMode = previousMode;
+    this->width = width;
+    this->height = height;
+
+    for (ModeTimes& modeTimes : times)
+    {
+        modeTimes = { 0.0, 0.0, 0.0, 0 };
+    }
+
+    running = true;
+    currentMode = AA_NONE;
+    skippedFrames = AA_BENCHMARK_SKIPPED_FRAMES;
+
+    cerr << "Benchmarking antialiasing, " << AA_BENCHMARK_FRAMES << " frames per mode..." << endl;
+}
+
+AntiAliasingMode AntiAliasingBenchmark::GetMode()
+{
+    return running ? (AntiAliasingMode)currentMode : previousMode;
+}
+
+void AntiAliasingBenchmark::AddFrame(double sceneMs, double postMs, double frameMs)
+{
+    if (!running) return;
+
+    // Drawn with the mode before
+    if (skippedFrames > 0)
+    {
+        skippedFrames--;
+        return;
+    }
+
+    ModeTimes& modeTimes = times[currentMode];
+    modeTimes.sceneMs += sceneMs;
+    modeTimes.postMs += postMs;
+    modeTimes.frameMs += frameMs;
+    modeTimes.frames++;
+
+    if (modeTimes.frames < AA_BENCHMARK_FRAMES) return;
+
+    currentMode++;
+    skippedFrames = AA_BENCHMARK_SKIPPED_FRAMES;
+
+    if (currentMode == AA_MODE_COUNT)
+    {
+        running = false;
+        PrintResults();
+    }
+}
+
+void AntiAliasingBenchmark::PrintResults()
+{
+    char line[128];
+
+    cerr << "\nAntialiasing benchmark at " << width << "x" << height << ", GPU ms per frame" << endl;
+
+    snprintf(line, sizeof(line), "  %-10s %8s %8s %8s", "Mode", "Scene", "Post", "Frame");
+    cerr << line << endl;
+
+    for (uint32_t i = 0; i < AA_MODE_COUNT; i++)
+    {
+        const ModeTimes& modeTimes = times[i];
+        double frames = modeTimes.frames > 0 ? (double)modeTimes.frames : 1.0;
+
+        snprintf(line, sizeof(line), "  %-10s %8.3f %8.3f %8.3f", GetAntiAliasingName((AntiAliasingMode)i),
+            modeTimes.sceneMs / frames, modeTimes.postMs / frames, modeTimes.frameMs / frames);
+        cerr << line << endl;
+    }
+
+    cerr << endl;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <iostream>
+
+#include "Config.h"
+#include "PostProcessing.h"
+
+using std::cerr;
+using std::endl;
+
+/*
+    Times every AntiAliasingMode on the GPU, one after the other, and
+    prints the averages side by side.
+
+    Each mode gets AA_BENCHMARK_FRAMES finished frames, after dropping the
+    ones still in flight from the mode before. The scene part includes the
+    MSAA resolve, the post part the FXAA and SMAA passes. Dynamic resolution
+    should be held at full size while it runs and the camera kept still,
+    or the modes aren't measured on the same pixels.
+*/
+class AntiAliasingBenchmark
+{
+public:
+
+    AntiAliasingBenchmark();
+
+    // Goes back to previousMode when it's done
+    void Start(AntiAliasingMode previousMode, uint32_t width, uint32_t height);
+
+    bool IsRunning() { return running; }
+
+    // Mode to draw with, the one being timed or previousMode once it's done
+    AntiAliasingMode GetMode();
+
+    // One frame the GPU finished, in ms
+    void AddFrame(double sceneMs, double postMs, double frameMs);
+
+private:
+
+    struct ModeTimes
+    {
+        double sceneMs;
+        double postMs;
+        double frameMs;
+        uint32_t frames;
+    };
+
+    bool running;
+    uint32_t currentMode;
+    uint32_t skippedFrames;
+    AntiAliasingMode previousMode;
+    uint32_t width, height;
+
+    ModeTimes times[AA_MODE_COUNT];
+
+    void PrintResults();
+};
@@ -0,0 +1,145 @@
+#include "AssetPack.h"
+
+#include <string.h>
+#include <algorithm>
+
+MappedFile AssetPack::packFile;
+const AssetPackEntry* AssetPack::entries = nullptr;
+uint32_t AssetPack::entryCount = 0;
+const char* AssetPack::names = nullptr;
+
+bool AssetPack::Open(const string& packLocation)
+{
+    Close();
+
+    if (!packFile.Open(packLocation))
+    {
+        cerr << "Asset pack: no " << packLocation << ", reading loose files." << endl;
+        return false;
+    }
+
+    const uint8_t* data = packFile.GetData();
+    size_t size = packFile.GetSize();
+
+    AssetPackHeader header;
+    bool valid = size >= sizeof(header);
+
+    if (valid)
+    {
+        memcpy(&header, data, sizeof(header));
+
+        size_t tableEnd = sizeof(header) + (size_t)header.entryCount * sizeof(AssetPackEntry);
+
+        valid = header.magic == ASSET_PACK_MAGIC &&
+                header.version == ASSET_PACK_VERSION &&
+                tableEnd <= size &&
+                header.namesOffset >= tableEnd &&
+                header.namesSize <= size - header.namesOffset;
+    }
+
+    if (valid)
+    {
+        // The header is 32 bytes, the table after it is aligned for the 8 byte fields
+        entries = (const AssetPackEntry*)(data + sizeof(header));
+        entryCount = header.entryCount;
+        names = (const char*)(data + header.namesOffset);
+
+        for (uint32_t i = 0; valid && i < entryCount; i++)
+        {
+            const AssetPackEntry& entry = entries[i];
+
+            valid = entry.offset <= size && entry.size <= size - entry.offset &&
+                    (uint64_t)entry.nameOffset + entry.nameLength <= header.namesSize;
+        }
+    }
+
+    if (!valid)
+    {
+        cerr << "\n\nERROR: " << packLocation << " is not a valid asset pack, reading loose files.\n" << endl;
+        Close();
+        return false;
+    }
+
+    cerr << "Asset pack: " << packLocation << " (" << entryCount << " files, " << (size >> 20) << " MB)" << endl;
+
+    return true;
+}
+
+const AssetPackEntry* AssetPack::FindEntry(const string& fileLocation)
+{
+    if (entryCount == 0) return nullptr;
+
+    string path = NormalizeAssetPath(fileLocation);
+    uint64_t pathHash = HashFNV1a64(path);
+
+    const AssetPackEntry* end = entries + entryCount;
+    const AssetPackEntry* entry = std::lower_bound(entries, end, pathHash, [](const AssetPackEntry& candidate, uint64_t hash)
+    {
+        return candidate.pathHash < hash;
+    });
+
+    // Paths with the same hash sit next to each other
+    for (; entry != end && entry->pathHash == pathHash; entry++)
+    {
+        if (entry->nameLength == path.size() && memcmp(names + entry->nameOffset, path.data(), path.size()) == 0) return entry;
+    }
+
+    return nullptr;
+}
+
+bool AssetPack::Find(const string& fileLocation, const uint8_t*& data, size_t& size)
+{
+    const AssetPackEntry* entry = FindEntry(fileLocation);
+    if (!entry) return false;
+
+    data = packFile.GetData() + entry->offset;
+    size = (size_t)entry->size;
+
+    return true;
+}
+
+bool AssetPack::GetStamp(const string& fileLocation, uint64_t& modifiedTime, uint64_t& fileSize)
+{
+    const AssetPackEntry* entry = FindEntry(fileLocation);
+    if (!entry) return false;
+
+    modifiedTime = entry->modifiedTime;
+    fileSize = entry->size;
+
+    return true;
+}
+
+void AssetPack::Close()
+{
+    entries = nullptr;
+    entryCount = 0;
+    names = nullptr;
+    packFile.Close();
+}
+
+AssetFile::AssetFile()
+{
+    data = nullptr;
+    size = 0;
+}
+
+bool AssetFile::Open(const string& fileLocation)
+{
+    Close();
+
+    if (AssetPack::Find(fileLocation, data, size)) return true;
+
+    if (!looseFile.Open(fileLocation)) return false;
+
+    data = looseFile.GetData();
+    size = looseFile.GetSize();
+
+    return true;
+}
+
+void AssetFile::Close()
+{
+    looseFile.Close();
+    data = nullptr;
+    size = 0;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+#include "Config.h"
+#include "AssetPackFormat.h"
+#include "MappedFile.h"
+
+using std::cerr;
+using std::endl;
+using std::string;
+
+/*
+    Read only access to the asset pack (ASSET_PACK_FILE), one memory mapped
+    file with every asset in it, instead of opening hundreds of loose files.
+
+    The pack is built by the AssetPacker tool. Without one, every lookup
+    misses and AssetFile reads the loose files, which is what development
+    uses. Open and Close on the main thread, Find is safe from any thread
+    in between.
+*/
+class AssetPack
+{
+public:
+
+    static bool Open(const string& packLocation);
+    static bool IsOpen() { return packFile.IsOpen(); }
+
+    // data points into the mapping, valid until Close
+    static bool Find(const string& fileLocation, const uint8_t*& data, size_t& size);
+
+    // The modification time and size the file had when it was packed
+    static bool GetStamp(const string& fileLocation, uint64_t& modifiedTime, uint64_t& fileSize);
+
+    static size_t GetEntryCount() { return entryCount; }
+
+    static void Close();
+
+private:
+
+    static MappedFile packFile;
+    static const AssetPackEntry* entries;
+    static uint32_t entryCount;
+    static const char* names;
+
+    static const AssetPackEntry* FindEntry(const string& fileLocation);
+};
+
+// One asset, from the pack when it's there, from a mapped loose file otherwise
+class AssetFile
+{
+public:
+
+    AssetFile();
+
+    bool Open(const string& fileLocation);
+    void Close();
+
+    bool IsPacked() const { return data != nullptr && !looseFile.IsOpen(); }
+    const uint8_t* GetData() const { return data; }
+    size_t GetSize() const { return size; }
+
+private:
+
+    AssetFile(const AssetFile&) = delete;
+    AssetFile& operator=(const AssetFile&) = delete;
+
+    MappedFile looseFile;
+    const uint8_t* data;
+    size_t size;
+};
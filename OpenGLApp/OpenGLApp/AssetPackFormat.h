@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+#include <ctype.h>
+#include <string>
+#include <vector>
+
+#include "Hash.h"
+
+/*
+    Layout of an asset pack, shared by the app (AssetPack) and the packer tool.
+
+    Header, the entry table sorted by path hash, the path names, then the
+    file contents. Each file starts ASSET_PACK_ALIGNMENT aligned, so the
+    data can be used straight from the mapping.
+*/
+
+constexpr uint32_t ASSET_PACK_MAGIC = 0x50414F4D;     // "MOAP"
+constexpr uint32_t ASSET_PACK_VERSION = 1;
+constexpr uint64_t ASSET_PACK_ALIGNMENT = 64;
+
+struct AssetPackHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+};
+
+struct AssetPackEntry
+{
+    uint64_t pathHash;          // HashFNV1a64 of the normalized path
+    uint64_t offset;            // From the start of the pack
+    uint64_t size;
+    uint64_t modifiedTime;      // Of the packed file, so cooked data keyed on it stays valid
+    uint32_t nameOffset;        // Into the names, to tell apart paths with the same hash
+    uint32_t nameLength;
+};
+
+// Forward slashes, no "." or "..", lower case. Packs are built on Windows, where the case of a path doesn't matter
+inline std::string NormalizeAssetPath(const std::string& fileLocation)
+{
+    std::vector<std::string> parts;
+    std::string part;
+
+    for (size_t i = 0; i <= fileLocation.size(); i++)
+    {
+        char c = (i < fileLocation.size()) ? fileLocation[i] : '/';
+
+        if (c != '/' && c != '\\')
+        {
+            part += (char)tolower((unsigned char)c);
+            continue;
+        }
+
+        if (part == ".." && !parts.empty() && parts.back() != "..") parts.pop_back();
+        else if (!part.empty() && part != ".") parts.push_back(part);
+
+        part.clear();
+    }
+
+    std::string path;
+
+    for (size_t i = 0; i < parts.size(); i++)
+    {
+        if (i > 0) path += "/";
+        path += parts[i];
+    }
+
+    return path;
+}
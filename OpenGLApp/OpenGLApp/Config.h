@@ -7,6 +7,86 @@ constexpr auto MAX_POINT_LIGHTS = 16;
 constexpr auto MAX_SPOT_LIGHTS = 16;
 constexpr auto MAX_LIGHTS = MAX_POINT_LIGHTS + MAX_SPOT_LIGHTS;
 
+// Per-draw data ring buffer (PerDrawBuffer)
+constexpr auto PER_DRAW_BINDING = 0;
+constexpr auto MAX_DRAWS_PER_FRAME = 1024;
+constexpr auto PER_DRAW_FRAMES = 3;
+
+// Folder of the program binaries saved by ShaderCache
+constexpr auto SHADER_CACHE_DIR = "ShaderCache";
+
+// Imported models saved by MeshCache, so Assimp only runs when the source changes
+constexpr auto MESH_CACHE_DIR = "MeshCache";
+constexpr auto MESH_CACHE_COMPRESS_INDICES = true;     // Delta + varint, decoded at load
+constexpr auto MESH_16BIT_INDICES = true;              // GL_UNSIGNED_SHORT for meshes of up to 65536 vertices
+
+// glTF and GLB read by GltfImporter, straight from the mapped buffers. Assimp takes the rest
+constexpr auto GLTF_NATIVE_IMPORT = true;
+
+// Import time triangle and vertex reordering (MeshOptimizer)
+constexpr auto MESH_OPTIMIZE = true;
+constexpr auto MESH_VERTEX_CACHE_SIZE = 16u;            // Post-transform cache Tipsify plans for, and the stats are measured with
+constexpr auto MESH_OVERDRAW_CLUSTER_TRIANGLES = 64u;   // Smallest cluster the overdraw sort moves around
+
+// Clusters culled on the CPU for every pass (CullView)
+constexpr auto MESH_CLUSTER_TRIANGLES = 128u;           // Most triangles in a cluster, 0 culls whole meshes only
+constexpr auto MESH_CLUSTER_CONE_CULLING = false;       // Back facing clusters too. Only right with GL_CULL_FACE, single sided planes draw both sides for now
+
+// Background model loading (ModelLoader)
+constexpr auto MODEL_UPLOAD_MESHES_PER_FRAME = 32u;   // GL buffers made per frame once a model is imported
+
+// Render target of the main pass (HDR), resolved to the screen by post-processing.frag
+constexpr auto HDR_HALF_FLOAT = false;          // GL_RGBA16F instead of GL_R11F_G11F_B10F, twice the bandwidth
+
+// Main pass resolution from the GPU frame time (DynamicResolution), upscaled and sharpened to the window
+constexpr auto DYNAMIC_RESOLUTION = true;
+constexpr auto DYNAMIC_RESOLUTION_TARGET_MS = 14.0;     // GPU time per frame it aims for, some room under 60 Hz
+constexpr auto DYNAMIC_RESOLUTION_MIN_SCALE = 0.5f;     // Of the window width and height
+constexpr auto DYNAMIC_RESOLUTION_MAX_SCALE = 1.0f;
+constexpr auto UPSCALE_SHARPNESS = 0.5f;                // 0 is plain bilinear
+
+// Antialiasing at startup, an AntiAliasingMode: 0 none, 1 FXAA, 2 SMAA 1x, 3 MSAA 2x, 4 MSAA 4x. Cycled with keypad 4
+constexpr auto ANTI_ALIASING = 1;
+constexpr auto AA_BENCHMARK_FRAMES = 300u;              // Timed per mode by AntiAliasingBenchmark, started with keypad 5
+
+// Built by the AssetPacker tool, loose files are read when it isn't there
+constexpr auto ASSET_PACK_FILE = "Assets.pack";
+
+// Texture loading pipeline (TextureLoader)
+constexpr auto TEXTURE_UPLOAD_PBOS = 3;
+constexpr auto TEXTURE_UPLOADS_PER_FRAME = 4;
+constexpr auto TEXTURE_MAX_SIZE = 4096;          // Bigger images are halved on the worker
+
+// Mip level streaming (TextureStreamer)
+constexpr auto TEXTURE_STREAMING_BUDGET_MB = 256;
+constexpr auto TEXTURE_STREAMING_START_SIZE = 128;     // Biggest level loaded up front
+constexpr auto TEXTURE_STREAMING_IDLE_FRAMES = 120;    // Not drawn for this long, the texture can shrink back
+constexpr auto TEXTURE_STREAMING_EVICTED_FRAMES = 300; // Dropped for the budget, it isn't streamed back in for this long
+
+// Texture units of the model texture arrays, kept clear of the omni shadow maps
+constexpr auto ALBEDO_ARRAY_UNIT = 14;
+constexpr auto NORMAL_ARRAY_UNIT = 15;
+
+// Packed occlusion/roughness/metalness/height of the models (MaterialPacker), as a texture or an array layer
+constexpr auto MATERIAL_ARRAY_UNIT = 10;
+constexpr auto MATERIAL_MAP_UNIT = 11;
+
+// Virtual texturing (VirtualTexture). The page sizes are repeated in shader.frag
+constexpr auto VT_ENABLED = true;               // Model albedo textures go through the page cache
+constexpr auto VT_PAGE_SIZE = 128;              // Texels across a page, without its border
+constexpr auto VT_PAGE_BORDER = 4;              // Texels copied from the neighbours on each side, for filtering
+constexpr auto VT_TABLE_PAGES = 256;            // Level 0 pages across the virtual space
+constexpr auto VT_CACHE_PAGES = 32;             // Pages across the physical page cache
+constexpr auto VT_MAX_REGION_PAGES = 32;        // Biggest texture, in level 0 pages across
+constexpr auto VT_FEEDBACK_DIVISOR = 8;         // The feedback pass renders at 1/8 of the window
+constexpr auto VT_FEEDBACK_FRAMES = 3;          // Readbacks in flight
+constexpr auto VT_PAGE_UPLOADS_PER_FRAME = 8;
+constexpr auto VT_MAX_PENDING_PAGES = 32;
+constexpr auto VIRTUAL_TABLE_UNIT = 12;
+constexpr auto VIRTUAL_CACHE_UNIT = 13;
+
+constexpr auto CAMERA_FOV = 60.0f;    // Vertical, in degrees
+
 constexpr auto WINDOW_WIDTH = 1900;
 constexpr auto WINDOW_HEIGHT = 980;
 
@@ -0,0 +1,94 @@
+#include "CullView.h"
+
+CullView::CullView()
+{
+    for (size_t i = 0; i < 6; i++)
+    {
+        planes[i] = glm::vec4(0.0f);
+    }
+
+    planeCount = 0;
+    eye = glm::vec3(0.0f);
+    range = 0.0f;
+    direction = glm::vec3(0.0f, 0.0f, -1.0f);
+    orthographic = false;
+}
+
+CullView CullView::FromPerspective(const glm::mat4& viewProjection, const glm::vec3& eye)
+{
+    CullView view;
+    view.SetPlanes(viewProjection);
+    view.eye = eye;
+
+    return view;
+}
+
+CullView CullView::FromOrthographic(const glm::mat4& viewProjection, const glm::vec3& direction)
+{
+    CullView view;
+    view.SetPlanes(viewProjection);
+    view.direction = glm::normalize(direction);
+    view.orthographic = true;
+
+    return view;
+}
+
+CullView CullView::FromSphere(const glm::vec3& center, float range)
+{
+    CullView view;
+    view.eye = center;
+    view.range = range;
+
+    return view;
+}
+
+void CullView::SetPlanes(const glm::mat4& viewProjection)
+{
+    // Rows of the matrix, glm stores columns
+    glm::vec4 rows[4];
+
+    for (int32_t i = 0; i < 4; i++)
+    {
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+
+    // Left, right, bottom, top, near, far
+    planes[0] = rows[3] + rows[0];
+    planes[1] = rows[3] - rows[0];
+    planes[2] = rows[3] + rows[1];
+    planes[3] = rows[3] - rows[1];
+    planes[4] = rows[3] + rows[2];
+    planes[5] = rows[3] - rows[2];
+    planeCount = 6;
+
+    // Normalized, so the plane distance can be compared with the radius
+    for (uint32_t i = 0; i < planeCount; i++)
+    {
+        float length = glm::length(glm::vec3(planes[i]));
+        if (length > 0.0f) planes[i] /= length;
+    }
+}
+
+bool CullView::IsSphereVisible(const glm::vec3& center, float radius) const
+{
+    for (uint32_t i = 0; i < planeCount; i++)
+    {
+        if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius) return false;
+    }
+
+    if (range > 0.0f && glm::length(center - eye) - radius > range) return false;
+
+    return true;
+}
+
+bool CullView::IsConeVisible(const glm::vec3& center, float radius, const glm::vec3& axis, float cutoff) const
+{
+    if (!MESH_CLUSTER_CONE_CULLING) return true;
+
+    // Every direction within 90 degrees minus the cone's angle of the axis sees only back faces
+    if (orthographic) return glm::dot(direction, axis) < cutoff;
+
+    // Same from a point, widened by the sphere because the triangles aren't all at the center
+    glm::vec3 toCenter = center - eye;
+    return glm::dot(toCenter, axis) < cutoff * glm::length(toCenter) + radius;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <iostream>
+
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+
+#include "Config.h"
+
+using std::cerr;
+using std::endl;
+
+/*
+    What one pass can see, for culling mesh clusters on the CPU.
+
+    A camera or a light's view projection gives the frustum planes (the
+    Gribb/Hartmann extraction, so orthographic works the same). Omni
+    shadow maps draw the six faces in one go, so they only get a sphere
+    around the light. The cone test throws away clusters whose triangles
+    all face away from the eye, or from the direction of an orthographic
+    view.
+*/
+class CullView
+{
+public:
+
+    CullView();
+
+    // Camera or spot light, the cones are tested from the eye
+    static CullView FromPerspective(const glm::mat4& viewProjection, const glm::vec3& eye);
+
+    // Directional light, the cones are tested against the direction it looks in
+    static CullView FromOrthographic(const glm::mat4& viewProjection, const glm::vec3& direction);
+
+    // Every face of an omni shadow map at once
+    static CullView FromSphere(const glm::vec3& center, float range);
+
+    // World space sphere
+    bool IsSphereVisible(const glm::vec3& center, float radius) const;
+
+    // False when every triangle inside the sphere faces away. cutoff is MeshCluster::coneCutoff
+    bool IsConeVisible(const glm::vec3& center, float radius, const glm::vec3& axis, float cutoff) const;
+
+private:
+
+    glm::vec4 planes[6];        // xyz normalized and pointing inside
+    uint32_t planeCount;
+
+    glm::vec3 eye;
+    float range;                // Sphere views, 0 without one
+
+    glm::vec3 direction;
+    bool orthographic;
+
+    void SetPlanes(const glm::mat4& viewProjection);
+};
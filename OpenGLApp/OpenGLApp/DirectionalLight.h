@@ -16,6 +16,8 @@ public:
 
     glm::mat4 CalculateLightTransform();
 
+    glm::vec3 GetDirection() { return direction; }
+
     ~DirectionalLight();
 
 private:
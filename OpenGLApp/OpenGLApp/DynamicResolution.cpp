@@ -0,0 +1,89 @@
+#include "DynamicResolution.h"
+
+#include <math.h>
+#include <algorithm>
+
+// Weight of each new frame in the averages
+static const double DYNAMIC_RESOLUTION_SMOOTHING = 0.1;
+
+// Most the scale moves at once, and how far off it has to be to move at all
+static const float DYNAMIC_RESOLUTION_MAX_STEP = 0.1f;
+static const float DYNAMIC_RESOLUTION_DEAD_ZONE = 0.02f;
+
+// After a change, the frames still in flight at the old scale are dropped,
+// then this many are averaged before the next decision
+static const uint32_t DYNAMIC_RESOLUTION_IN_FLIGHT_FRAMES = 4;
+static const uint32_t DYNAMIC_RESOLUTION_SETTLE_FRAMES = 8;
+
+DynamicResolution::DynamicResolution()
+{
+    fullWidth = 0;
+    fullHeight = 0;
+    scale = DYNAMIC_RESOLUTION_MAX_SCALE;
+
+    smoothedFrameMs = 0.0;
+    smoothedScaledMs = 0.0;
+    sampleCount = 0;
+    skippedSamples = 0;
+}
+
+void DynamicResolution::Init(uint32_t width, uint32_t height)
+{
+    fullWidth = width;
+    fullHeight = height;
+    scale = DYNAMIC_RESOLUTION ? DYNAMIC_RESOLUTION_MAX_SCALE : 1.0f;
+}
+
+void DynamicResolution::Update(double frameMs, double scaledMs)
+{
+    if (!DYNAMIC_RESOLUTION) return;
+
+    if (skippedSamples > 0)
+    {
+        skippedSamples--;
+        return;
+    }
+
+    if (sampleCount == 0)
+    {
+        smoothedFrameMs = frameMs;
+        smoothedScaledMs = scaledMs;
+    }
+    else
+    {
+        smoothedFrameMs += (frameMs - smoothedFrameMs) * DYNAMIC_RESOLUTION_SMOOTHING;
+        smoothedScaledMs += (scaledMs - smoothedScaledMs) * DYNAMIC_RESOLUTION_SMOOTHING;
+    }
+
+    sampleCount++;
+
+    // Nothing to scale from yet
+    if (sampleCount < DYNAMIC_RESOLUTION_SETTLE_FRAMES || smoothedScaledMs <= 0.01) return;
+
+    // What the frame costs whatever the resolution, the scaled passes get the rest of the target
+    double fixedMs = std::max(smoothedFrameMs - smoothedScaledMs, 0.0);
+    double budgetMs = DYNAMIC_RESOLUTION_TARGET_MS - fixedMs;
+
+    // The scaled passes cost about the pixel count, so the square root of the ratio
+    float wanted = budgetMs > 0.0 ? scale * (float)sqrt(budgetMs / smoothedScaledMs) : DYNAMIC_RESOLUTION_MIN_SCALE;
+    wanted = std::min(std::max(wanted, (float)DYNAMIC_RESOLUTION_MIN_SCALE), (float)DYNAMIC_RESOLUTION_MAX_SCALE);
+
+    float change = wanted - scale;
+    if (fabs(change) < DYNAMIC_RESOLUTION_DEAD_ZONE) return;
+
+    scale += std::min(std::max(change, -DYNAMIC_RESOLUTION_MAX_STEP), DYNAMIC_RESOLUTION_MAX_STEP);
+
+    // The averages were measured at the old scale
+    sampleCount = 0;
+    skippedSamples = DYNAMIC_RESOLUTION_IN_FLIGHT_FRAMES;
+}
+
+uint32_t DynamicResolution::GetRenderWidth()
+{
+    return std::max(1u, std::min(fullWidth, (uint32_t)(fullWidth * scale + 0.5f)));
+}
+
+uint32_t DynamicResolution::GetRenderHeight()
+{
+    return std::max(1u, std::min(fullHeight, (uint32_t)(fullHeight * scale + 0.5f)));
+}
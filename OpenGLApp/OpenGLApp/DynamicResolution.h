@@ -0,0 +1,51 @@
+#pragma once
+
+#include <iostream>
+
+#include "Config.h"
+
+using std::cerr;
+using std::endl;
+
+/*
+    Picks the resolution of the main pass from the GPU frame time.
+
+    Fed with the time of the whole frame and of the passes whose cost
+    follows the pixel count, it treats the rest (shadow maps, upscale) as
+    fixed and solves for the scale that brings the frame to
+    DYNAMIC_RESOLUTION_TARGET_MS, assuming the scaled part goes with the
+    area. After a change it drops the frames still in flight and averages
+    a few new ones before deciding again, with some slack around the
+    target, so it settles instead of pumping.
+    The render size is a viewport inside the full size targets, changing
+    it never reallocates anything.
+*/
+class DynamicResolution
+{
+public:
+
+    DynamicResolution();
+
+    // Full size, what the scale is relative to
+    void Init(uint32_t width, uint32_t height);
+
+    // One finished frame: its GPU time and the part of it that scales with the pixels, in ms
+    void Update(double frameMs, double scaledMs);
+
+    float GetScale() { return scale; }
+    uint32_t GetRenderWidth();
+    uint32_t GetRenderHeight();
+
+    // Smoothed GPU frame time, for the window title
+    double GetFrameMs() { return smoothedFrameMs; }
+
+private:
+
+    uint32_t fullWidth, fullHeight;
+    float scale;
+
+    double smoothedFrameMs;
+    double smoothedScaledMs;
+    uint32_t sampleCount;           // Averaged since the last change
+    uint32_t skippedSamples;        // Still to drop after it
+};
@@ -0,0 +1,509 @@
+#include "GltfImporter.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <float.h>
+#include <algorithm>
+
+// Little endian "glTF", "JSON" and "BIN\0"
+static const uint32_t GLB_MAGIC = 0x46546C67;
+static const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+static const uint32_t GLB_CHUNK_BIN = 0x004E4942;
+
+// accessor.componentType
+static const uint32_t GLTF_BYTE = 5120;
+static const uint32_t GLTF_UNSIGNED_BYTE = 5121;
+static const uint32_t GLTF_SHORT = 5122;
+static const uint32_t GLTF_UNSIGNED_SHORT = 5123;
+static const uint32_t GLTF_UNSIGNED_INT = 5125;
+static const uint32_t GLTF_FLOAT = 5126;
+
+static const int64_t GLTF_TRIANGLES = 4;
+
+// Node trees are shallow, this only stops cycles in broken files
+static const uint32_t GLTF_MAX_NODE_DEPTH = 256;
+
+static uint32_t ReadU32(const uint8_t* data)
+{
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static uint32_t GetComponentSize(uint32_t componentType)
+{
+    switch (componentType)
+    {
+    case GLTF_BYTE:
+    case GLTF_UNSIGNED_BYTE:    return 1;
+    case GLTF_SHORT:
+    case GLTF_UNSIGNED_SHORT:   return 2;
+    case GLTF_UNSIGNED_INT:
+    case GLTF_FLOAT:            return 4;
+    default:                    return 0;
+    }
+}
+
+static uint32_t GetComponentCount(const string& type)
+{
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+
+    return 0;
+}
+
+GltfImporter::GltfImporter()
+{
+}
+
+bool GltfImporter::IsGltf(const string& fileLocation)
+{
+    size_t dot = fileLocation.rfind('.');
+    if (dot == string::npos) return false;
+
+    string extension = fileLocation.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+
+    return extension == "gltf" || extension == "glb";
+}
+
+bool GltfImporter::Fail(const string& reason)
+{
+    cerr << "glTF: " << fileLocation << " " << reason << ", using Assimp" << endl;
+    return false;
+}
+
+bool GltfImporter::Open(const string& fileLocation)
+{
+    this->fileLocation = fileLocation;
+
+    if (!documentFile.Open(fileLocation)) return Fail("can't be opened");
+
+    BufferRange json = { documentFile.GetData(), documentFile.GetSize() };
+    BufferRange binary = { nullptr, 0 };
+
+    if (json.size >= 4 && ReadU32(json.data) == GLB_MAGIC)
+    {
+        if (!ReadGLB(documentFile.GetData(), documentFile.GetSize(), json, binary)) return false;
+    }
+
+    string error;
+    if (!JsonValue::Parse((const char*)json.data, json.size, document, error)) return Fail("has bad JSON (" + error + ")");
+
+    if (document["asset"]["version"].AsString().compare(0, 2, "2.") != 0) return Fail("isn't glTF 2.0");
+    if (!MapBuffers(binary)) return false;
+    if (!CheckImages()) return false;
+
+    const JsonValue& scenes = document["scenes"];
+    const JsonValue& scene = scenes[(size_t)document["scene"].AsInt(0)];
+    if (!scene.IsObject()) return Fail("has no scene");
+
+    const JsonValue& rootNodes = scene["nodes"];
+
+    for (size_t i = 0; i < rootNodes.Size(); i++)
+    {
+        if (!LoadNode(document["nodes"][(size_t)rootNodes[i].AsInt(-1)], 0)) return false;
+    }
+
+    return true;
+}
+
+bool GltfImporter::ReadGLB(const uint8_t* data, size_t size, BufferRange& json, BufferRange& binary)
+{
+    if (size < 20 || ReadU32(data + 4) != 2) return Fail("isn't a version 2 GLB");
+
+    size_t length = std::min<size_t>(ReadU32(data + 8), size);
+    size_t offset = 12;
+
+    json.data = nullptr;
+
+    // JSON comes first, the optional binary chunk right after
+    while (offset + 8 <= length)
+    {
+        uint32_t chunkLength = ReadU32(data + offset);
+        uint32_t chunkType = ReadU32(data + offset + 4);
+        offset += 8;
+
+        if (chunkLength > length - offset) return Fail("has a truncated chunk");
+
+        if (chunkType == GLB_CHUNK_JSON && json.data == nullptr) json = { data + offset, chunkLength };
+        else if (chunkType == GLB_CHUNK_BIN && binary.data == nullptr) binary = { data + offset, chunkLength };
+
+        // Chunks are 4 byte aligned
+        offset += (chunkLength + 3) & ~3u;
+    }
+
+    if (json.data == nullptr) return Fail("has no JSON chunk");
+
+    return true;
+}
+
+bool GltfImporter::MapBuffers(const BufferRange& binary)
+{
+    const JsonValue& bufferList = document["buffers"];
+
+    size_t slash = fileLocation.find_last_of("/\\");
+    string directory = slash == string::npos ? "" : fileLocation.substr(0, slash + 1);
+
+    for (size_t i = 0; i < bufferList.Size(); i++)
+    {
+        const JsonValue& buffer = bufferList[i];
+        size_t byteLength = (size_t)buffer["byteLength"].AsInt(0);
+        BufferRange range = { nullptr, 0 };
+
+        if (!buffer.Has("uri"))
+        {
+            // The GLB binary chunk, only the first buffer can be it
+            if (i != 0 || binary.data == nullptr) return Fail("has a buffer without data");
+
+            range = binary;
+        }
+        else
+        {
+            const string& uri = buffer["uri"].AsString();
+            if (uri.compare(0, 5, "data:") == 0) return Fail("has an embedded buffer");
+
+            std::unique_ptr<AssetFile> bufferFile(new AssetFile());
+            if (!bufferFile->Open(directory + DecodeURI(uri))) return Fail("is missing " + uri);
+
+            range = { bufferFile->GetData(), bufferFile->GetSize() };
+            bufferFiles.push_back(std::move(bufferFile));
+        }
+
+        if (range.size < byteLength) return Fail("has a buffer shorter than its byteLength");
+
+        buffers.push_back(range);
+    }
+
+    return true;
+}
+
+bool GltfImporter::LoadNode(const JsonValue& node, uint32_t depth)
+{
+    if (!node.IsObject() || depth > GLTF_MAX_NODE_DEPTH) return Fail("has a bad node");
+
+    // Transforms are left out, same as the Assimp path
+    if (node.Has("mesh"))
+    {
+        const JsonValue& mesh = document["meshes"][(size_t)node["mesh"].AsInt(-1)];
+        if (!mesh.IsObject()) return Fail("has a node with a bad mesh");
+
+        if (!LoadPrimitives(mesh)) return false;
+    }
+
+    const JsonValue& children = node["children"];
+
+    for (size_t i = 0; i < children.Size(); i++)
+    {
+        if (!LoadNode(document["nodes"][(size_t)children[i].AsInt(-1)], depth + 1)) return false;
+    }
+
+    return true;
+}
+
+bool GltfImporter::LoadPrimitives(const JsonValue& mesh)
+{
+    const JsonValue& primitives = mesh["primitives"];
+
+    // Meshes without a material get the default one after the file's
+    uint32_t defaultMaterial = (uint32_t)document["materials"].Size();
+
+    for (size_t i = 0; i < primitives.Size(); i++)
+    {
+        const JsonValue& primitive = primitives[i];
+        const JsonValue& attributes = primitive["attributes"];
+
+        if (primitive["mode"].AsInt(GLTF_TRIANGLES) != GLTF_TRIANGLES) return Fail("has primitives that aren't triangle lists");
+        if (!attributes.Has("NORMAL")) return Fail("has a primitive without normals");
+
+        GltfMesh gltfMesh = {};
+        gltfMesh.name = mesh["name"].AsString();
+        gltfMesh.hasTexCoords = attributes.Has("TEXCOORD_0");
+        gltfMesh.hasIndices = primitive.Has("indices");
+
+        int64_t material = primitive["material"].AsInt(-1);
+        gltfMesh.materialIndex = material >= 0 && material < defaultMaterial ? (uint32_t)material : defaultMaterial;
+
+        if (!ResolveAccessor(attributes["POSITION"], gltfMesh.positions) || gltfMesh.positions.components != 3 || gltfMesh.positions.componentType != GLTF_FLOAT) return Fail("has bad positions");
+        if (!ResolveAccessor(attributes["NORMAL"], gltfMesh.normals) || gltfMesh.normals.components != 3 || gltfMesh.normals.componentType != GLTF_FLOAT) return Fail("has bad normals");
+
+        if (gltfMesh.normals.count != gltfMesh.positions.count) return Fail("has fewer normals than positions");
+
+        if (gltfMesh.hasTexCoords)
+        {
+            if (!ResolveAccessor(attributes["TEXCOORD_0"], gltfMesh.texCoords) || gltfMesh.texCoords.components != 2) return Fail("has bad texture coordinates");
+            if (gltfMesh.texCoords.count != gltfMesh.positions.count) return Fail("has fewer texture coordinates than positions");
+        }
+
+        if (gltfMesh.hasIndices)
+        {
+            const AccessorView& indices = gltfMesh.indices;
+
+            if (!ResolveAccessor(primitive["indices"], gltfMesh.indices) || indices.components != 1 ||
+                (indices.componentType != GLTF_UNSIGNED_BYTE && indices.componentType != GLTF_UNSIGNED_SHORT && indices.componentType != GLTF_UNSIGNED_INT))
+            {
+                return Fail("has bad indices");
+            }
+        }
+
+        meshes.push_back(gltfMesh);
+    }
+
+    return true;
+}
+
+bool GltfImporter::ResolveAccessor(const JsonValue& index, AccessorView& view)
+{
+    const JsonValue& accessor = document["accessors"][(size_t)index.AsInt(-1)];
+    if (!accessor.IsObject() || accessor.Has("sparse") || !accessor.Has("bufferView")) return false;
+
+    const JsonValue& bufferView = document["bufferViews"][(size_t)accessor["bufferView"].AsInt(-1)];
+    if (!bufferView.IsObject()) return false;
+
+    size_t bufferIndex = (size_t)bufferView["buffer"].AsInt(-1);
+    if (bufferIndex >= buffers.size()) return false;
+
+    view.componentType = (uint32_t)accessor["componentType"].AsInt(0);
+    view.components = GetComponentCount(accessor["type"].AsString());
+    view.normalized = accessor["normalized"].AsBool(false);
+    view.count = (size_t)accessor["count"].AsInt(0);
+
+    uint32_t componentSize = GetComponentSize(view.componentType);
+    if (componentSize == 0 || view.components == 0) return false;
+
+    size_t elementSize = (size_t)componentSize * view.components;
+    view.stride = (size_t)bufferView["byteStride"].AsInt(0);
+    if (view.stride == 0) view.stride = elementSize;
+
+    size_t viewOffset = (size_t)bufferView["byteOffset"].AsInt(0);
+    size_t viewLength = (size_t)bufferView["byteLength"].AsInt(0);
+    size_t accessorOffset = (size_t)accessor["byteOffset"].AsInt(0);
+
+    const BufferRange& buffer = buffers[bufferIndex];
+
+    // Every element has to be inside the view, and the view inside the buffer
+    if (viewOffset > buffer.size || viewLength > buffer.size - viewOffset) return false;
+    if (view.count > 0 && (accessorOffset > viewLength || (view.count - 1) > (viewLength - accessorOffset) / view.stride ||
+        accessorOffset + (view.count - 1) * view.stride + elementSize > viewLength))
+    {
+        return false;
+    }
+
+    view.data = buffer.data + viewOffset + accessorOffset;
+
+    return true;
+}
+
+float GltfImporter::ReadComponent(const AccessorView& view, size_t element, uint32_t component)
+{
+    const uint8_t* data = view.data + element * view.stride + component * GetComponentSize(view.componentType);
+
+    switch (view.componentType)
+    {
+    case GLTF_FLOAT:
+    {
+        float value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    case GLTF_UNSIGNED_BYTE:
+        return view.normalized ? *data / 255.0f : (float)*data;
+
+    case GLTF_BYTE:
+        return view.normalized ? std::max(*(const int8_t*)data / 127.0f, -1.0f) : (float)*(const int8_t*)data;
+
+    case GLTF_UNSIGNED_SHORT:
+    {
+        uint16_t value;
+        memcpy(&value, data, sizeof(value));
+        return view.normalized ? value / 65535.0f : (float)value;
+    }
+
+    case GLTF_SHORT:
+    {
+        int16_t value;
+        memcpy(&value, data, sizeof(value));
+        return view.normalized ? std::max(value / 32767.0f, -1.0f) : (float)value;
+    }
+
+    default:
+        return 0.0f;
+    }
+}
+
+uint32_t GltfImporter::ReadIndex(const AccessorView& view, size_t element)
+{
+    const uint8_t* data = view.data + element * view.stride;
+
+    if (view.componentType == GLTF_UNSIGNED_BYTE) return *data;
+
+    if (view.componentType == GLTF_UNSIGNED_SHORT)
+    {
+        uint16_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    return ReadU32(data);
+}
+
+bool GltfImporter::ConvertMesh(size_t i, vector<GLfloat>& vertices, vector<uint32_t>& indices, glm::vec3& boundsMin, glm::vec3& boundsMax) const
+{
+    const GltfMesh& mesh = meshes[i];
+    size_t vertexCount = mesh.positions.count;
+
+    vertices.resize(vertexCount * 8);
+    boundsMin = glm::vec3(FLT_MAX);
+    boundsMax = glm::vec3(-FLT_MAX);
+
+    bool floatTexCoords = mesh.hasTexCoords && mesh.texCoords.componentType == GLTF_FLOAT;
+
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        GLfloat* output = vertices.data() + v * 8;
+
+        // Positions and normals are always floats, copied straight from the mapping
+        memcpy(output, mesh.positions.data + v * mesh.positions.stride, 3 * sizeof(float));
+
+        if (floatTexCoords) memcpy(output + 3, mesh.texCoords.data + v * mesh.texCoords.stride, 2 * sizeof(float));
+        else if (mesh.hasTexCoords) { output[3] = ReadComponent(mesh.texCoords, v, 0); output[4] = ReadComponent(mesh.texCoords, v, 1); }
+        else { output[3] = 0.0f; output[4] = 0.0f; }
+
+        // glTF's top left UV origin is what Assimp gives with FlipUVs, so they go in as they are
+
+        memcpy(output + 5, mesh.normals.data + v * mesh.normals.stride, 3 * sizeof(float));
+
+        // Minus because they are not negative in the FRAG SHADER as normaly are
+        output[5] = -output[5];
+        output[6] = -output[6];
+        output[7] = -output[7];
+
+        glm::vec3 point(output[0], output[1], output[2]);
+        boundsMin = glm::min(boundsMin, point);
+        boundsMax = glm::max(boundsMax, point);
+    }
+
+    if (!mesh.hasIndices)
+    {
+        indices.resize(vertexCount - vertexCount % 3);
+        for (size_t j = 0; j < indices.size(); j++) indices[j] = (uint32_t)j;
+
+        return true;
+    }
+
+    indices.resize(mesh.indices.count - mesh.indices.count % 3);
+
+    for (size_t j = 0; j < indices.size(); j++)
+    {
+        indices[j] = ReadIndex(mesh.indices, j);
+
+        if (indices[j] >= vertexCount)
+        {
+            cerr << "glTF: " << fileLocation << " mesh " << mesh.name << " has an index out of range" << endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool GltfImporter::CheckImages()
+{
+    const JsonValue& materialList = document["materials"];
+
+    for (size_t i = 0; i < materialList.Size(); i++)
+    {
+        const JsonValue& material = materialList[i];
+        const JsonValue& pbr = material["pbrMetallicRoughness"];
+
+        const JsonValue* textureInfos[] =
+        {
+            &pbr["baseColorTexture"], &material["normalTexture"], &pbr["metallicRoughnessTexture"], &material["occlusionTexture"]
+        };
+
+        for (const JsonValue* textureInfo : textureInfos)
+        {
+            if (!textureInfo->IsObject()) continue;
+
+            // Assimp doesn't write them out either, the model just loads the way it did before this reader
+            if (GetImageURI(*textureInfo).empty()) return Fail("has images inside the file or in data URIs");
+        }
+    }
+
+    return true;
+}
+
+string GltfImporter::GetImageURI(const JsonValue& textureInfo) const
+{
+    if (!textureInfo.IsObject()) return "";
+
+    const JsonValue& texture = document["textures"][(size_t)textureInfo["index"].AsInt(-1)];
+    const JsonValue& image = document["images"][(size_t)texture["source"].AsInt(-1)];
+
+    // Empty for an image in a buffer view
+    const string& uri = image["uri"].AsString();
+    if (uri.compare(0, 5, "data:") == 0) return "";
+
+    return DecodeURI(uri);
+}
+
+string GltfImporter::GetTexturePath(const string& uri, const string& objName)
+{
+    if (uri.empty()) return "";
+
+    // Same folder as Model::GetTexturePath, only the file name is kept
+    size_t slash = uri.find_last_of("/\\");
+    string fileName = slash == string::npos ? uri : uri.substr(slash + 1);
+
+    return string("Assets/Models/Textures/") + objName + string("/") + fileName;
+}
+
+string GltfImporter::DecodeURI(const string& uri)
+{
+    string decoded;
+    decoded.reserve(uri.size());
+
+    for (size_t i = 0; i < uri.size(); i++)
+    {
+        if (uri[i] == '%' && i + 2 < uri.size() && isxdigit((unsigned char)uri[i + 1]) && isxdigit((unsigned char)uri[i + 2]))
+        {
+            decoded += (char)strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16);
+            i += 2;
+        }
+        else
+        {
+            decoded += uri[i];
+        }
+    }
+
+    return decoded;
+}
+
+void GltfImporter::GetMaterials(const string& objName, vector<MaterialData>& materials) const
+{
+    const JsonValue& materialList = document["materials"];
+
+    // The last one is the default material, like Assimp adds
+    materials.resize(materialList.Size() + 1);
+
+    for (size_t i = 0; i < materialList.Size(); i++)
+    {
+        const JsonValue& material = materialList[i];
+        const JsonValue& pbr = material["pbrMetallicRoughness"];
+        MaterialData& materialData = materials[i];
+
+        materialData.albedo = GetTexturePath(GetImageURI(pbr["baseColorTexture"]), objName);
+        materialData.normal = GetTexturePath(GetImageURI(material["normalTexture"]), objName);
+
+        // Roughness in G and metalness in B, the channels MaterialPacker reads them from
+        string metallicRoughness = GetTexturePath(GetImageURI(pbr["metallicRoughnessTexture"]), objName);
+
+        materialData.maps.occlusion = GetTexturePath(GetImageURI(material["occlusionTexture"]), objName);
+        materialData.maps.roughness = metallicRoughness;
+        materialData.maps.metalness = metallicRoughness;
+    }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+
+#include "Json.h"
+#include "AssetPack.h"
+#include "MeshCache.h"
+
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+
+/*
+    glTF 2.0 (.gltf + .bin, or .glb) without Assimp.
+
+    The JSON is parsed once, the buffers stay mapped (AssetFile) and each
+    triangle primitive is read straight from its accessors into the
+    engine's vertex layout, so there is no aiScene in between. Primitives
+    are listed the way Assimp lists them: one mesh per primitive, walking
+    the default scene's nodes, and a default material after the file's
+    ones. Anything it doesn't cover (images inside the file, data URIs,
+    sparse accessors, strips, missing normals) makes Open fail and the
+    model goes through Assimp.
+*/
+class GltfImporter
+{
+public:
+
+    GltfImporter();
+
+    // By the extension
+    static bool IsGltf(const string& fileLocation);
+
+    // Parses the document, maps the buffers and checks every accessor the meshes use
+    bool Open(const string& fileLocation);
+
+    size_t GetMeshCount() const { return meshes.size(); }
+    const string& GetMeshName(size_t i) const { return meshes[i].name; }
+    uint32_t GetMaterialIndex(size_t i) const { return meshes[i].materialIndex; }
+
+    // 8 floats per vertex (position, uv, negated normal) and the triangle list, also the position bounds.
+    // Only reads the mappings, fine from several threads. False if an index is out of range
+    bool ConvertMesh(size_t i, vector<GLfloat>& vertices, vector<uint32_t>& indices, glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+
+    // Texture files where Model looks for them, metallicRoughness feeds both packed channels
+    void GetMaterials(const string& objName, vector<MaterialData>& materials) const;
+
+private:
+
+    // Elements of one accessor in its mapped buffer
+    struct AccessorView
+    {
+        const uint8_t* data;
+        size_t stride;
+        size_t count;
+        uint32_t componentType;
+        uint32_t components;
+        bool normalized;
+    };
+
+    struct GltfMesh
+    {
+        string name;
+        AccessorView positions;
+        AccessorView normals;
+        AccessorView texCoords;
+        AccessorView indices;
+        bool hasTexCoords;
+        bool hasIndices;
+        uint32_t materialIndex;
+    };
+
+    struct BufferRange
+    {
+        const uint8_t* data;
+        size_t size;
+    };
+
+    string fileLocation;
+    JsonValue document;
+    AssetFile documentFile;
+    vector<std::unique_ptr<AssetFile>> bufferFiles;
+    vector<BufferRange> buffers;
+    vector<GltfMesh> meshes;
+
+    bool Fail(const string& reason);
+
+    bool ReadGLB(const uint8_t* data, size_t size, BufferRange& json, BufferRange& binary);
+    bool MapBuffers(const BufferRange& binary);
+    bool LoadNode(const JsonValue& node, uint32_t depth);
+    bool LoadPrimitives(const JsonValue& mesh);
+    bool ResolveAccessor(const JsonValue& index, AccessorView& view);
+
+    // One component as a float, normalized integers mapped to 0..1 or -1..1
+    static float ReadComponent(const AccessorView& view, size_t element, uint32_t component);
+    static uint32_t ReadIndex(const AccessorView& view, size_t element);
+
+    // The texture loader reads files, a material image in a buffer view or a data URI fails
+    bool CheckImages();
+
+    // URI of the image behind a textureInfo, empty if there isn't one
+    string GetImageURI(const JsonValue& textureInfo) const;
+    static string GetTexturePath(const string& uri, const string& objName);
+    static string DecodeURI(const string& uri);
+};
@@ -0,0 +1,105 @@
+#include "GpuTimer.h"
+
+GpuTimer::GpuTimer()
+{
+    markerCount = 0;
+    currentSet = 0;
+    oldestPending = 0;
+    timingFrame = false;
+}
+
+void GpuTimer::Init(uint32_t markerCount)
+{
+    this->markerCount = markerCount;
+
+    for (QuerySet& querySet : querySets)
+    {
+        querySet.queries.resize(markerCount);
+        glGenQueries(markerCount, querySet.queries.data());
+        querySet.pending = false;
+    }
+
+    currentSet = 0;
+    oldestPending = 0;
+}
+
+void GpuTimer::BeginFrame()
+{
+    timingFrame = false;
+    if (markerCount == 0) return;
+
+    // The GPU is more than GPU_TIMER_FRAMES behind, this frame goes untimed instead of waiting
+    if (querySets[currentSet].pending) return;
+
+    timingFrame = true;
+}
+
+void GpuTimer::Mark(uint32_t marker)
+{
+    if (!timingFrame || marker >= markerCount) return;
+
+    QuerySet& querySet = querySets[currentSet];
+    glQueryCounter(querySet.queries[marker], GL_TIMESTAMP);
+
+    // The last marker closes the frame
+    if (marker + 1 == markerCount)
+    {
+        querySet.pending = true;
+        currentSet = (currentSet + 1) % GPU_TIMER_FRAMES;
+        timingFrame = false;
+    }
+}
+
+bool GpuTimer::ReadFrame(vector<double>& markerMs)
+{
+    bool read = false;
+
+    // Oldest first, they finish in order. Only the newest result is kept
+    while (querySets[oldestPending].pending)
+    {
+        QuerySet& querySet = querySets[oldestPending];
+
+        GLint available = 0;
+        glGetQueryObjectiv(querySet.queries[markerCount - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+
+        GLuint64 first = 0;
+        glGetQueryObjectui64v(querySet.queries[0], GL_QUERY_RESULT, &first);
+
+        markerMs.resize(markerCount);
+
+        for (uint32_t i = 0; i < markerCount; i++)
+        {
+            GLuint64 timestamp = 0;
+            glGetQueryObjectui64v(querySet.queries[i], GL_QUERY_RESULT, &timestamp);
+
+            markerMs[i] = (double)(timestamp - first) / 1000000.0;
+        }
+
+        querySet.pending = false;
+        oldestPending = (oldestPending + 1) % GPU_TIMER_FRAMES;
+        read = true;
+    }
+
+    return read;
+}
+
+void GpuTimer::ClearTimer()
+{
+    for (QuerySet& querySet : querySets)
+    {
+        if (!querySet.queries.empty())
+        {
+            glDeleteQueries((GLsizei)querySet.queries.size(), querySet.queries.data());
+        }
+
+        querySet.queries.clear();
+        querySet.pending = false;
+    }
+
+    markerCount = 0;
+}
+
+GpuTimer::~GpuTimer()
+{
+}
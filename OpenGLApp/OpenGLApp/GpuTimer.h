@@ -0,0 +1,56 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+#include <GL\glew.h>
+
+using std::cerr;
+using std::endl;
+using std::vector;
+
+/*
+    GPU timestamps at a few points of the frame (glQueryCounter).
+
+    Results are read a few frames later, once the GPU got there, so asking
+    for them never stalls the pipeline. Timestamps rather than
+    GL_TIME_ELAPSED because elapsed queries can't overlap, and the spans
+    measured here do (the whole frame and the passes inside it).
+*/
+class GpuTimer
+{
+public:
+
+    GpuTimer();
+
+    void Init(uint32_t markerCount);
+
+    // Picks the queries of this frame. The markers do nothing if they are all still in flight
+    void BeginFrame();
+    void Mark(uint32_t marker);
+
+    // Milliseconds of each marker since the first one, of the newest frame the GPU finished.
+    // False when no frame finished since the last call
+    bool ReadFrame(vector<double>& markerMs);
+
+    void ClearTimer();
+
+    ~GpuTimer();
+
+private:
+
+    // Frames in flight before a query set is reused
+    static const uint32_t GPU_TIMER_FRAMES = 4;
+
+    struct QuerySet
+    {
+        vector<GLuint> queries;
+        bool pending;           // Issued and not read yet
+    };
+
+    QuerySet querySets[GPU_TIMER_FRAMES];
+    uint32_t markerCount;
+    uint32_t currentSet;
+    uint32_t oldestPending;
+    bool timingFrame;
+};
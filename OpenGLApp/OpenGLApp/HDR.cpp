@@ -1,25 +1,192 @@
-#pragma once
+#include "HDR.h"
 
-#include <iostream>
+HDR::HDR()
+{
+    FBO = 0;
+    colourBuffer = 0;
+    depthBuffer = 0;
+    bufferWidth = 0;
+    bufferHeight = 0;
+    renderWidth = 0;
+    renderHeight = 0;
+
+    multisampleFBO = 0;
+    multisampleColour = 0;
+    multisampleDepth = 0;
+    sampleCount = 1;
+}
+
+bool HDR::Init(uint32_t width, uint32_t height)
+{
+    bufferWidth = width;
+    bufferHeight = height;
+    renderWidth = width;
+    renderHeight = height;
+
+    // Three floats are enough for the light, the half float one has room for alpha
+    GLenum internalFormat = HDR_HALF_FLOAT ? GL_RGBA16F : GL_R11F_G11F_B10F;
+    GLenum format = HDR_HALF_FLOAT ? GL_RGBA : GL_RGB;
+
+    glGenFramebuffers(1, &FBO);
+
+    // Creates the colour texture the lighting goes into
+    glGenTextures(1, &colourBuffer);
+    glBindTexture(GL_TEXTURE_2D, colourBuffer);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_FLOAT, nullptr);
+
+    // Read one texel per pixel, no filtering needed
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // Depth is never sampled, a renderbuffer does
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colourBuffer, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+    // Check for errors
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
 
-#include <GL\glew.h>
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-using std::cerr;
-using std::cout;
-using std::endl;
+    if( status != GL_FRAMEBUFFER_COMPLETE )
+    {
+        cerr << "\nERROR: HDR Framebuffer Error. " << status << ".\n" << endl;
+        return false;
+    }
 
-class HDR
+    return true;
+}
+
+void HDR::SetRenderSize(uint32_t width, uint32_t height)
+{
+    renderWidth = width < bufferWidth ? width : bufferWidth;
+    renderHeight = height < bufferHeight ? height : bufferHeight;
+}
+
+bool HDR::SetSamples(uint32_t samples)
 {
-public:
-    HDR();
+    GLint maxSamples = 1;
+    glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+
+    if (samples > (uint32_t)maxSamples) samples = maxSamples;
+    if (samples < 1) samples = 1;
+
+    if (samples == sampleCount) return true;
+
+    ClearMultisample();
+    sampleCount = samples;
+
+    if (sampleCount == 1) return true;
+
+    GLenum internalFormat = HDR_HALF_FLOAT ? GL_RGBA16F : GL_R11F_G11F_B10F;
+
+    // Same formats as the texture, only read by the resolve
+    glGenRenderbuffers(1, &multisampleColour);
+    glBindRenderbuffer(GL_RENDERBUFFER, multisampleColour);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, sampleCount, internalFormat, bufferWidth, bufferHeight);
+
+    glGenRenderbuffers(1, &multisampleDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, multisampleDepth);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, sampleCount, GL_DEPTH_COMPONENT24, bufferWidth, bufferHeight);
+
+    glGenFramebuffers(1, &multisampleFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, multisampleFBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, multisampleColour);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, multisampleDepth);
 
-    virtual bool Init(uint32_t width, uint32_t height);
-    virtual void Write();
-    virtual void Read(GLenum textureUnit);
+    // Check for errors
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
 
-    ~HDR();
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-protected:
-    GLuint FBO, shadowMap;
-    GLuint shadowWidth, shadowHeight;
-};
+    if( status != GL_FRAMEBUFFER_COMPLETE )
+    {
+        cerr << "\nERROR: HDR Multisample Framebuffer Error. " << status << ".\n" << endl;
+
+        // Back to drawing into the texture
+        ClearMultisample();
+        sampleCount = 1;
+        return false;
+    }
+
+    return true;
+}
+
+void HDR::Write()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, sampleCount > 1 ? multisampleFBO : FBO);
+    glViewport(0, 0, renderWidth, renderHeight);
+}
+
+void HDR::Resolve()
+{
+    if (sampleCount == 1) return;
+
+    // Only the part that was drawn
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, multisampleFBO);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, FBO);
+    glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, renderWidth, renderHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void HDR::ClearMultisample()
+{
+    if( multisampleFBO )
+    {
+        glDeleteFramebuffers(1, &multisampleFBO);
+        multisampleFBO = 0;
+    }
+
+    if( multisampleColour )
+    {
+        glDeleteRenderbuffers(1, &multisampleColour);
+        multisampleColour = 0;
+    }
+
+    if( multisampleDepth )
+    {
+        glDeleteRenderbuffers(1, &multisampleDepth);
+        multisampleDepth = 0;
+    }
+}
+
+void HDR::Read(GLenum textureUnit)
+{
+    glActiveTexture(textureUnit);
+    glBindTexture(GL_TEXTURE_2D, colourBuffer);
+}
+
+void HDR::ClearBuffer()
+{
+    ClearMultisample();
+
+    if( FBO )
+    {
+        glDeleteFramebuffers(1, &FBO);
+        FBO = 0;
+    }
+
+    if( colourBuffer )
+    {
+        glDeleteTextures(1, &colourBuffer);
+        colourBuffer = 0;
+    }
+
+    if( depthBuffer )
+    {
+        glDeleteRenderbuffers(1, &depthBuffer);
+        depthBuffer = 0;
+    }
+}
+
+HDR::~HDR()
+{
+    ClearBuffer();
+}
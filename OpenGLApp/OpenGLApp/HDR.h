@@ -0,0 +1,62 @@
+#pragma once
+
+#include <iostream>
+
+#include <GL\glew.h>
+
+#include "Config.h"
+
+using std::cerr;
+using std::endl;
+
+/*
+    Floating point render target of the main pass.
+
+    The scene is lit in linear space into a GL_R11F_G11F_B10F (or
+    GL_RGBA16F with HDR_HALF_FLOAT) texture with its own depth buffer, and
+    the post-processing stack tone maps and gamma corrects it once per
+    pixel, instead of once per shaded fragment.
+    With MSAA the scene goes into multisampled renderbuffers instead, and
+    Resolve averages them into the colour texture.
+*/
+class HDR
+{
+public:
+    HDR();
+
+    virtual bool Init(uint32_t width, uint32_t height);
+
+    // Part of the target Write draws into, from the bottom left corner. The whole target by default
+    void SetRenderSize(uint32_t width, uint32_t height);
+
+    // 1 draws straight into the colour texture. Makes the multisampled buffers again when it changes
+    bool SetSamples(uint32_t samples);
+
+    virtual void Write();
+
+    // Into the colour texture, before post-processing reads it. Nothing to do without MSAA
+    void Resolve();
+
+    virtual void Read(GLenum textureUnit);
+
+    GLuint GetColourBuffer() { return colourBuffer; }
+    GLuint GetWidth() { return bufferWidth; }
+    GLuint GetHeight() { return bufferHeight; }
+    GLuint GetRenderWidth() { return renderWidth; }
+    GLuint GetRenderHeight() { return renderHeight; }
+    GLuint GetSamples() { return sampleCount; }
+
+    void ClearBuffer();
+
+    ~HDR();
+
+protected:
+    GLuint FBO, colourBuffer, depthBuffer;
+    GLuint bufferWidth, bufferHeight;
+    GLuint renderWidth, renderHeight;
+
+    GLuint multisampleFBO, multisampleColour, multisampleDepth;
+    GLuint sampleCount;
+
+    void ClearMultisample();
+};
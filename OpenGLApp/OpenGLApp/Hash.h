@@ -0,0 +1,91 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+constexpr uint64_t FNV_OFFSET_64 = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME_64 = 1099511628211ull;
+
+// FNV-1a, used for cache keys. Pass the previous result as the seed to chain buffers
+inline uint64_t HashFNV1a64(const void* data, size_t size, uint64_t seed = FNV_OFFSET_64)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint64_t hash = seed;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME_64;
+    }
+
+    return hash;
+}
+
+inline uint64_t HashFNV1a64(const std::string& text, uint64_t seed = FNV_OFFSET_64)
+{
+    return HashFNV1a64(text.data(), text.size(), seed);
+}
+
+constexpr uint32_t FNV_OFFSET_32 = 2166136261u;
+constexpr uint32_t FNV_PRIME_32 = 16777619u;
+
+// 32 bit FNV-1a of a uniform name, usable at compile time
+constexpr uint32_t HashUniform(const char* name, uint32_t seed = FNV_OFFSET_32)
+{
+    uint32_t hash = seed;
+
+    for (; *name; name++)
+    {
+        hash ^= (uint8_t)*name;
+        hash *= FNV_PRIME_32;
+    }
+
+    return hash;
+}
+
+// Continues a hash with the decimal digits of an array index
+constexpr uint32_t HashUniformIndex(uint32_t index, uint32_t seed)
+{
+    char digits[12] = {};
+    int count = 0;
+
+    do
+    {
+        digits[count++] = (char)('0' + index % 10);
+        index /= 10;
+    } while (index > 0);
+
+    uint32_t hash = seed;
+
+    while (count > 0)
+    {
+        hash ^= (uint8_t)digits[--count];
+        hash *= FNV_PRIME_32;
+    }
+
+    return hash;
+}
+
+// Same hash as HashUniform("array[index]member") without building the string
+constexpr uint32_t HashUniformArray(const char* array, uint32_t index, const char* member = "")
+{
+    return HashUniform(member, HashUniform("]", HashUniformIndex(index, HashUniform("[", HashUniform(array)))));
+}
+
+// 16 hex digits, for cache file names
+inline std::string HashToString(uint64_t hash)
+{
+    const char* digits = "0123456789abcdef";
+    std::string text(16, '0');
+
+    for (size_t i = 0; i < 16; i++)
+    {
+        text[15 - i] = digits[(hash >> (i * 4)) & 0xF];
+    }
+
+    return text;
+}
+
+#endif // HASH_H
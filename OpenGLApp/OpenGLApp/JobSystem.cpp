@@ -0,0 +1,147 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+bool JobSystem::running = false;
+vector<std::thread> JobSystem::workers;
+
+std::mutex JobSystem::queueMutex;
+std::condition_variable JobSystem::queueCondition;
+std::condition_variable JobSystem::doneCondition;
+deque<JobSystem::Job> JobSystem::jobQueue;
+
+void JobSystem::Init(uint32_t threadCount)
+{
+    if (running) return;
+
+    if (threadCount == 0)
+    {
+        uint32_t cores = std::thread::hardware_concurrency();
+        threadCount = cores > 1 ? cores - 1 : 1;
+    }
+
+    running = true;
+
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        workers.push_back(std::thread(WorkerLoop));
+    }
+
+    cerr << "Job system: " << threadCount << " worker threads" << endl;
+}
+
+void JobSystem::RunJob(std::unique_lock<std::mutex>& lock, deque<Job>::iterator queued)
+{
+    Job job = std::move(*queued);
+    jobQueue.erase(queued);
+
+    lock.unlock();
+    job.function();
+    lock.lock();
+
+    // Under the lock, so a waiter can't miss the last one
+    job.group->pendingCount--;
+    doneCondition.notify_all();
+}
+
+void JobSystem::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(queueMutex);
+
+    while (true)
+    {
+        queueCondition.wait(lock, [] { return !running || !jobQueue.empty(); });
+
+        if (!running) return;
+
+        RunJob(lock, jobQueue.begin());
+    }
+}
+
+void JobSystem::ParallelFor(size_t count, const std::function<void(size_t)>& job)
+{
+    if (count == 0) return;
+
+    // A few batches per thread, so uneven items still spread out
+    size_t batchCount = std::min(count, (size_t)(GetThreadCount() + 1) * 4);
+    size_t batchSize = (count + batchCount - 1) / batchCount;
+
+    JobGroup group;
+
+    for (size_t first = 0; first < count; first += batchSize)
+    {
+        size_t last = std::min(first + batchSize, count);
+
+        group.Run([&job, first, last]
+        {
+            for (size_t i = first; i < last; i++) job(i);
+        });
+    }
+
+    group.Wait();
+}
+
+void JobSystem::Shutdown()
+{
+    if (!running) return;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        running = false;
+    }
+
+    queueCondition.notify_all();
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    workers.clear();
+}
+
+JobGroup::JobGroup()
+{
+    pendingCount = 0;
+}
+
+void JobGroup::Run(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(JobSystem::queueMutex);
+
+        JobSystem::Job queued;
+        queued.function = std::move(job);
+        queued.group = this;
+
+        JobSystem::jobQueue.push_back(std::move(queued));
+        pendingCount++;
+    }
+
+    JobSystem::queueCondition.notify_one();
+}
+
+void JobGroup::Wait()
+{
+    std::unique_lock<std::mutex> lock(JobSystem::queueMutex);
+
+    while (pendingCount > 0)
+    {
+        // Helps with its own jobs instead of sleeping, the rest is left to the workers
+        auto own = std::find_if(JobSystem::jobQueue.begin(), JobSystem::jobQueue.end(),
+                                [this](const JobSystem::Job& job) { return job.group == this; });
+
+        if (own != JobSystem::jobQueue.end())
+        {
+            JobSystem::RunJob(lock, own);
+            continue;
+        }
+
+        JobSystem::doneCondition.wait(lock);
+    }
+}
+
+JobGroup::~JobGroup()
+{
+    Wait();
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using std::cerr;
+using std::endl;
+using std::vector;
+using std::deque;
+
+class JobGroup;
+
+/*
+    General purpose worker threads for CPU work that isn't texture decoding
+    (TextureLoader has its own), like importing models.
+
+    Jobs are queued in a JobGroup and waited on through it. The waiting
+    thread runs the group's queued jobs itself until it's done, so a job
+    can start and wait on more jobs (a model import fanning out its meshes)
+    without running out of threads. Only its own jobs, so a short wait on
+    the GL thread never picks up a whole model import. Without Init every
+    job runs on the thread that waits.
+*/
+class JobSystem
+{
+public:
+
+    // threadCount 0 picks one less than the number of cores
+    static void Init(uint32_t threadCount = 0);
+    static bool IsRunning() { return running; }
+    static uint32_t GetThreadCount() { return (uint32_t)workers.size(); }
+
+    // Calls job(i) for every i in [0, count) spread over the threads, and returns once they are all done
+    static void ParallelFor(size_t count, const std::function<void(size_t)>& job);
+
+    // Joins the workers. Every group has to be waited on before
+    static void Shutdown();
+
+private:
+
+    friend class JobGroup;
+
+    struct Job
+    {
+        std::function<void()> function;
+        JobGroup* group;
+    };
+
+    static bool running;
+    static vector<std::thread> workers;
+
+    static std::mutex queueMutex;
+    static std::condition_variable queueCondition;
+    static std::condition_variable doneCondition;
+    static deque<Job> jobQueue;
+
+    // Takes the job out of the queue and runs it with the lock released. The lock is held on entry and on return
+    static void RunJob(std::unique_lock<std::mutex>& lock, deque<Job>::iterator queued);
+
+    static void WorkerLoop();
+};
+
+// Jobs that are waited on together
+class JobGroup
+{
+public:
+
+    JobGroup();
+
+    void Run(std::function<void()> job);
+    void Wait();
+
+    ~JobGroup();
+
+private:
+
+    friend class JobSystem;
+
+    JobGroup(const JobGroup&) = delete;
+    JobGroup& operator=(const JobGroup&) = delete;
+
+    // Guarded by JobSystem::queueMutex
+    size_t pendingCount;
+};
@@ -0,0 +1,402 @@
+#include "Json.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+const JsonValue JsonValue::nullValue;
+
+// Deep enough for any glTF, shallow enough to never run out of stack
+static const uint32_t JSON_MAX_DEPTH = 256;
+
+JsonValue::JsonValue()
+{
+    type = JSON_NULL;
+    boolean = false;
+    number = 0.0;
+}
+
+const JsonValue& JsonValue::operator[](const char* key) const
+{
+    if (type != JSON_OBJECT) return nullValue;
+
+    for (const auto& member : members)
+    {
+        if (member.first == key) return member.second;
+    }
+
+    return nullValue;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const
+{
+    if (type != JSON_ARRAY || index >= items.size()) return nullValue;
+
+    return items[index];
+}
+
+int64_t JsonValue::AsInt(int64_t fallback) const
+{
+    // 2^63 is exact in a double, and the comparisons are false for NaN
+    if (type != JSON_NUMBER || !(number >= -9223372036854775808.0 && number < 9223372036854775808.0)) return fallback;
+    if (floor(number) != number) return fallback;
+
+    return (int64_t)number;
+}
+
+// Recursive descent over the text, it doesn't have to be null terminated
+class JsonParser
+{
+public:
+
+    JsonParser(const char* text, size_t length) : text(text), length(length), offset(0) {}
+
+    bool ParseDocument(JsonValue& root, string& error)
+    {
+        bool parsed = ParseValue(root, 0);
+
+        SkipWhitespace();
+
+        if (parsed && offset != length)
+        {
+            failure = "unexpected data after the document";
+            parsed = false;
+        }
+
+        if (!parsed) error = failure + " at byte " + std::to_string(offset);
+
+        return parsed;
+    }
+
+private:
+
+    const char* text;
+    size_t length;
+    size_t offset;
+    string failure;
+
+    bool Fail(const char* message)
+    {
+        failure = message;
+        return false;
+    }
+
+    void SkipWhitespace()
+    {
+        while (offset < length && (text[offset] == ' ' || text[offset] == '\t' || text[offset] == '\n' || text[offset] == '\r')) offset++;
+    }
+
+    bool Match(const char* word)
+    {
+        size_t wordLength = strlen(word);
+        if (length - offset < wordLength || memcmp(text + offset, word, wordLength) != 0) return false;
+
+        offset += wordLength;
+        return true;
+    }
+
+    bool ParseValue(JsonValue& value, uint32_t depth)
+    {
+        if (depth > JSON_MAX_DEPTH) return Fail("nested too deep");
+
+        SkipWhitespace();
+        if (offset >= length) return Fail("unexpected end");
+
+        char first = text[offset];
+
+        if (first == '{') return ParseObject(value, depth);
+        if (first == '[') return ParseArray(value, depth);
+
+        if (first == '"')
+        {
+            value.type = JsonValue::JSON_STRING;
+            return ParseString(value.text);
+        }
+
+        if (Match("true") || Match("false"))
+        {
+            value.type = JsonValue::JSON_BOOL;
+            value.boolean = text[offset - 1] == 'e' && text[offset - 2] == 'u';
+            return true;
+        }
+
+        if (Match("null"))
+        {
+            value.type = JsonValue::JSON_NULL;
+            return true;
+        }
+
+        return ParseNumber(value);
+    }
+
+    bool ParseObject(JsonValue& value, uint32_t depth)
+    {
+        value.type = JsonValue::JSON_OBJECT;
+        offset++;
+
+        SkipWhitespace();
+        if (offset < length && text[offset] == '}') { offset++; return true; }
+
+        while (true)
+        {
+            SkipWhitespace();
+            if (offset >= length || text[offset] != '"') return Fail("expected a member name");
+
+            value.members.emplace_back();
+            if (!ParseString(value.members.back().first)) return false;
+
+            SkipWhitespace();
+            if (offset >= length || text[offset] != ':') return Fail("expected ':'");
+            offset++;
+
+            if (!ParseValue(value.members.back().second, depth + 1)) return false;
+
+            SkipWhitespace();
+            if (offset >= length) return Fail("unexpected end");
+
+            if (text[offset] == ',') { offset++; continue; }
+            if (text[offset] == '}') { offset++; return true; }
+
+            return Fail("expected ',' or '}'");
+        }
+    }
+
+    bool ParseArray(JsonValue& value, uint32_t depth)
+    {
+        value.type = JsonValue::JSON_ARRAY;
+        offset++;
+
+        SkipWhitespace();
+        if (offset < length && text[offset] == ']') { offset++; return true; }
+
+        while (true)
+        {
+            value.items.emplace_back();
+            if (!ParseValue(value.items.back(), depth + 1)) return false;
+
+            SkipWhitespace();
+            if (offset >= length) return Fail("unexpected end");
+
+            if (text[offset] == ',') { offset++; continue; }
+            if (text[offset] == ']') { offset++; return true; }
+
+            return Fail("expected ',' or ']'");
+        }
+    }
+
+    bool ParseHex4(uint32_t& codePoint)
+    {
+        if (length - offset < 4) return Fail("short \\u escape");
+
+        codePoint = 0;
+
+        for (size_t i = 0; i < 4; i++)
+        {
+            char digit = text[offset++];
+            codePoint <<= 4;
+
+            if (digit >= '0' && digit <= '9') codePoint |= digit - '0';
+            else if (digit >= 'a' && digit <= 'f') codePoint |= digit - 'a' + 10;
+            else if (digit >= 'A' && digit <= 'F') codePoint |= digit - 'A' + 10;
+            else return Fail("bad \\u escape");
+        }
+
+        return true;
+    }
+
+    static void AppendUTF8(string& output, uint32_t codePoint)
+    {
+        if (codePoint < 0x80)
+        {
+            output += (char)codePoint;
+        }
+        else if (codePoint < 0x800)
+        {
+            output += (char)(0xC0 | (codePoint >> 6));
+            output += (char)(0x80 | (codePoint & 0x3F));
+        }
+        else if (codePoint < 0x10000)
+        {
+            output += (char)(0xE0 | (codePoint >> 12));
+            output += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+            output += (char)(0x80 | (codePoint & 0x3F));
+        }
+        else
+        {
+            output += (char)(0xF0 | (codePoint >> 18));
+            output += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+            output += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+            output += (char)(0x80 | (codePoint & 0x3F));
+        }
+    }
+
+    bool ParseString(string& output)
+    {
+        // Opening quote
+        offset++;
+
+        while (offset < length)
+        {
+            char character = text[offset++];
+
+            if (character == '"') return true;
+
+            if (character != '\\')
+            {
+                output += character;
+                continue;
+            }
+
+            if (offset >= length) break;
+
+            char escape = text[offset++];
+
+            switch (escape)
+            {
+            case '"':  output += '"'; break;
+            case '\\': output += '\\'; break;
+            case '/':  output += '/'; break;
+            case 'b':  output += '\b'; break;
+            case 'f':  output += '\f'; break;
+            case 'n':  output += '\n'; break;
+            case 'r':  output += '\r'; break;
+            case 't':  output += '\t'; break;
+
+            case 'u':
+            {
+                uint32_t codePoint = 0;
+                if (!ParseHex4(codePoint)) return false;
+
+                // Characters outside the BMP come as a surrogate pair
+                if (codePoint >= 0xD800 && codePoint <= 0xDBFF && Match("\\u"))
+                {
+                    uint32_t low = 0;
+                    if (!ParseHex4(low)) return false;
+
+                    if (low >= 0xDC00 && low <= 0xDFFF) codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                }
+
+                AppendUTF8(output, codePoint);
+                break;
+            }
+
+            default:
+                return Fail("bad escape");
+            }
+        }
+
+        return Fail("unterminated string");
+    }
+
+    bool IsDigit(size_t at) const
+    {
+        return at < length && text[at] >= '0' && text[at] <= '9';
+    }
+
+    // By hand, strtod reads the decimal point of the current locale
+    bool ParseNumber(JsonValue& value)
+    {
+        bool negative = offset < length && text[offset] == '-';
+        if (negative) offset++;
+
+        if (!IsDigit(offset)) return Fail("expected a value");
+        if (text[offset] == '0' && IsDigit(offset + 1)) return Fail("bad number");
+
+        // Up to 19 digits fit, the rest only move the exponent
+        uint64_t mantissa = 0;
+        uint32_t mantissaDigits = 0;
+        int32_t exponent = 0;
+
+        while (IsDigit(offset))
+        {
+            if (mantissaDigits < 19)
+            {
+                mantissa = mantissa * 10 + (uint64_t)(text[offset] - '0');
+                if (mantissa > 0) mantissaDigits++;
+            }
+            else
+            {
+                exponent++;
+            }
+
+            offset++;
+        }
+
+        if (offset < length && text[offset] == '.')
+        {
+            offset++;
+            if (!IsDigit(offset)) return Fail("bad number");
+
+            while (IsDigit(offset))
+            {
+                if (mantissaDigits < 19)
+                {
+                    mantissa = mantissa * 10 + (uint64_t)(text[offset] - '0');
+                    if (mantissa > 0) mantissaDigits++;
+                    exponent--;
+                }
+
+                offset++;
+            }
+        }
+
+        if (offset < length && (text[offset] == 'e' || text[offset] == 'E'))
+        {
+            offset++;
+
+            bool negativeExponent = offset < length && text[offset] == '-';
+            if (offset < length && (text[offset] == '-' || text[offset] == '+')) offset++;
+
+            if (!IsDigit(offset)) return Fail("bad number");
+
+            int32_t written = 0;
+
+            while (IsDigit(offset))
+            {
+                if (written < 100000) written = written * 10 + (text[offset] - '0');
+                offset++;
+            }
+
+            exponent += negativeExponent ? -written : written;
+        }
+
+        value.number = MakeDouble(mantissa, exponent);
+        if (negative) value.number = -value.number;
+
+        value.type = JsonValue::JSON_NUMBER;
+        return true;
+    }
+
+    static double MakeDouble(uint64_t mantissa, int32_t exponent)
+    {
+        static const double powers[] =
+        {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        if (mantissa == 0) return 0.0;
+
+        // Both exact in a double, so one multiply or divide rounds right. That's every number a glTF exporter writes
+        if (mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22)
+        {
+            return exponent < 0 ? (double)mantissa / powers[-exponent] : (double)mantissa * powers[exponent];
+        }
+
+        // The rest goes to strtod as digits and an exponent. Without a decimal point the locale doesn't matter,
+        // and it rounds right next to DBL_MIN too, where scaling by a power of ten underflows
+        char digits[48];
+        snprintf(digits, sizeof(digits), "%llue%d", (unsigned long long)mantissa, (int)exponent);
+
+        return strtod(digits, nullptr);
+    }
+};
+
+bool JsonValue::Parse(const char* text, size_t length, JsonValue& root, string& error)
+{
+    root = JsonValue();
+
+    JsonParser parser(text, length);
+    return parser.ParseDocument(root, error);
+}
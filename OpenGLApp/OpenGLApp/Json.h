@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <utility>
+
+using std::string;
+using std::vector;
+
+/*
+    Small read only JSON document, enough for glTF.
+
+    Lookups of missing members or items give a shared null value instead
+    of failing, so paths like node["pbrMetallicRoughness"]["baseColorTexture"]
+    can be chained and checked once at the end.
+*/
+class JsonValue
+{
+public:
+
+    enum JsonType
+    {
+        JSON_NULL,
+        JSON_BOOL,
+        JSON_NUMBER,
+        JSON_STRING,
+        JSON_ARRAY,
+        JSON_OBJECT
+    };
+
+    JsonValue();
+
+    // The whole text has to be one value. error says where it stopped otherwise
+    static bool Parse(const char* text, size_t length, JsonValue& root, string& error);
+
+    JsonType GetType() const { return type; }
+    bool IsNull() const { return type == JSON_NULL; }
+    bool IsNumber() const { return type == JSON_NUMBER; }
+    bool IsString() const { return type == JSON_STRING; }
+    bool IsArray() const { return type == JSON_ARRAY; }
+    bool IsObject() const { return type == JSON_OBJECT; }
+
+    const JsonValue& operator[](const char* key) const;
+    const JsonValue& operator[](size_t index) const;
+
+    // Items of an array or members of an object
+    size_t Size() const { return type == JSON_OBJECT ? members.size() : items.size(); }
+    bool Has(const char* key) const { return !(*this)[key].IsNull(); }
+
+    double AsNumber(double fallback = 0.0) const { return type == JSON_NUMBER ? number : fallback; }
+    int64_t AsInt(int64_t fallback = 0) const;      // Also the fallback for fractions and numbers past int64
+    bool AsBool(bool fallback = false) const { return type == JSON_BOOL ? boolean : fallback; }
+
+    // Empty for anything that isn't a string
+    const string& AsString() const { return text; }
+
+private:
+
+    friend class JsonParser;
+
+    JsonType type;
+    bool boolean;
+    double number;
+    string text;
+    vector<JsonValue> items;
+    vector<std::pair<string, JsonValue>> members;
+
+    static const JsonValue nullValue;
+};
@@ -0,0 +1,103 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+    data = nullptr;
+    size = 0;
+
+#ifdef _WIN32
+    fileHandle = INVALID_HANDLE_VALUE;
+    mappingHandle = nullptr;
+#else
+    fileDescriptor = -1;
+#endif
+}
+
+bool MappedFile::Open(const string& fileLocation)
+{
+    Close();
+
+#ifdef _WIN32
+    fileHandle = CreateFileA(fileLocation.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+
+    // Empty files can't be mapped
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+    {
+        Close();
+        return false;
+    }
+
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (mappingHandle)
+    {
+        data = (const uint8_t*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    }
+
+    size = (size_t)fileSize.QuadPart;
+#else
+    fileDescriptor = open(fileLocation.c_str(), O_RDONLY);
+    if (fileDescriptor < 0) return false;
+
+    struct stat fileInfo;
+
+    // Empty files can't be mapped
+    if (fstat(fileDescriptor, &fileInfo) != 0 || fileInfo.st_size == 0)
+    {
+        Close();
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, (size_t)fileInfo.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    if (mapping != MAP_FAILED) data = (const uint8_t*)mapping;
+
+    size = (size_t)fileInfo.st_size;
+#endif
+
+    if (!data)
+    {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+
+    mappingHandle = nullptr;
+    fileHandle = INVALID_HANDLE_VALUE;
+#else
+    if (data) munmap((void*)data, size);
+    if (fileDescriptor >= 0) close(fileDescriptor);
+
+    fileDescriptor = -1;
+#endif
+
+    data = nullptr;
+    size = 0;
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+using std::string;
+
+// Read only memory mapping of a whole file. The pages are only read from disk when touched
+class MappedFile
+{
+public:
+
+    MappedFile();
+
+    bool Open(const string& fileLocation);
+    void Close();
+
+    bool IsOpen() const { return data != nullptr; }
+    const uint8_t* GetData() const { return data; }
+    size_t GetSize() const { return size; }
+
+    ~MappedFile();
+
+private:
+
+    // The mapping can't be shared between two owners
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data;
+    size_t size;
+
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#else
+    int fileDescriptor;
+#endif
+};
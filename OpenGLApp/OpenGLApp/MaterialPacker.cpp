@@ -0,0 +1,212 @@
+#include "MaterialPacker.h"
+#include "Texture.h"
+#include "Hash.h"
+
+#include <stdint.h>
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+using std::ofstream;
+using std::vector;
+
+std::mutex MaterialPacker::packMutex;
+std::condition_variable MaterialPacker::packCondition;
+std::unordered_set<string> MaterialPacker::packingPaths;
+
+string MaterialPacker::GetPackedPath(const MaterialMapPaths& paths)
+{
+    const string* sources[] = { &paths.occlusion, &paths.roughness, &paths.metalness, &paths.height };
+
+    // The separators keep "a" + "bc" from matching "ab" + "c"
+    uint64_t key = FNV_OFFSET_64;
+    string folder;
+
+    for (const string* source : sources)
+    {
+        key = HashFNV1a64(*source, key);
+        key = HashFNV1a64("|", 1, key);
+
+        if (folder.empty() && !source->empty())
+        {
+            size_t separator = source->find_last_of("/\\");
+            folder = (separator == string::npos) ? "." : source->substr(0, separator);
+        }
+    }
+
+    return folder + "/packed_" + HashToString(key) + ".tga";
+}
+
+bool MaterialPacker::IsUpToDate(const string& packedPath, const MaterialMapPaths& paths)
+{
+    uint64_t packedTime = 0, packedSize = 0;
+    if (!TextureCooker::GetSourceStamp(packedPath, packedTime, packedSize)) return false;
+
+    const string* sources[] = { &paths.occlusion, &paths.roughness, &paths.metalness, &paths.height };
+
+    for (const string* source : sources)
+    {
+        if (source->empty()) continue;
+
+        uint64_t sourceTime = 0, sourceSize = 0;
+
+        // A source that went away leaves the old packing in place
+        if (TextureCooker::GetSourceStamp(*source, sourceTime, sourceSize) && sourceTime > packedTime) return false;
+    }
+
+    return true;
+}
+
+string MaterialPacker::Pack(const MaterialMapPaths& paths)
+{
+    if (paths.IsEmpty()) return "";
+
+    string packedPath = GetPackedPath(paths);
+
+    // Models imported at the same time can have materials with the same maps. The first one
+    // writes the file, the others wait and then find it up to date instead of truncating it
+    {
+        std::unique_lock<std::mutex> lock(packMutex);
+        packCondition.wait(lock, [&packedPath]() { return packingPaths.find(packedPath) == packingPaths.end(); });
+
+        if (IsUpToDate(packedPath, paths)) return packedPath;
+
+        packingPaths.insert(packedPath);
+    }
+
+    bool packed = PackMaps(paths, packedPath);
+
+    {
+        std::lock_guard<std::mutex> lock(packMutex);
+        packingPaths.erase(packedPath);
+    }
+
+    packCondition.notify_all();
+
+    return packed ? packedPath : "";
+}
+
+bool MaterialPacker::PackMaps(const MaterialMapPaths& paths, const string& packedPath)
+{
+    struct SourceImage
+    {
+        const string* path;
+        int32_t channel;            // Channel of the resized RGBA copy the map is read from
+        int32_t width, height, channels;
+        unsigned char* pixels;
+    };
+
+    // Packed glTF maps (occlusion R, roughness G, metalness B) read from the
+    // matching channel, and grey images have the same value in all three
+    SourceImage sources[] =
+    {
+        { &paths.occlusion, 0, 0, 0, 0, nullptr },
+        { &paths.roughness, 1, 0, 0, 0, nullptr },
+        { &paths.metalness, 2, 0, 0, 0, nullptr },
+        { &paths.height,    0, 0, 0, 0, nullptr }
+    };
+
+    int32_t width = 0, height = 0;
+
+    for (SourceImage& source : sources)
+    {
+        if (source.path->empty()) continue;
+
+        source.pixels = Texture::DecodeFile(*source.path, false, source.width, source.height, source.channels);
+
+        if (!source.pixels)
+        {
+            cerr << "\n\nERROR: Failed to read the material map " << *source.path << ".\n" << endl;
+            continue;
+        }
+
+        width = std::max(width, source.width);
+        height = std::max(height, source.height);
+    }
+
+    if (width == 0 || height == 0) return false;
+
+    bool hasHeight = sources[3].pixels != nullptr;
+    int32_t packedChannels = hasHeight ? 4 : 3;
+
+    cerr << "\tPacking material maps into " << packedPath << " (" << width << "x" << height << ")..." << endl;
+
+    // Neutral values for the maps that aren't there
+    const uint8_t defaults[4] = { 255, 0, 0, 0 };
+    vector<uint8_t> packed((size_t)width * height * packedChannels);
+
+    for (int32_t channel = 0; channel < packedChannels; channel++)
+    {
+        for (size_t i = 0; i < (size_t)width * height; i++)
+        {
+            packed[i * packedChannels + channel] = defaults[channel];
+        }
+    }
+
+    vector<uint8_t> resized((size_t)width * height * 4);
+
+    for (int32_t target = 0; target < packedChannels; target++)
+    {
+        SourceImage& source = sources[target];
+        if (!source.pixels) continue;
+
+        TextureCooker::ResizeToRGBA(source.pixels, source.width, source.height, source.channels, width, height, resized.data());
+
+        for (size_t i = 0; i < (size_t)width * height; i++)
+        {
+            packed[i * packedChannels + target] = resized[i * 4 + source.channel];
+        }
+    }
+
+    for (SourceImage& source : sources)
+    {
+        if (source.pixels) stbi_image_free(source.pixels);
+    }
+
+    return WriteTGA(packedPath, packed.data(), width, height, packedChannels);
+}
+
+bool MaterialPacker::WriteTGA(const string& path, const uint8_t* pixels, int32_t width, int32_t height, int32_t channels)
+{
+    ofstream fileStream(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (!fileStream.is_open())
+    {
+        cerr << "\n\nERROR: Failed to write the packed material map " << path << ".\n" << endl;
+        return false;
+    }
+
+    // Uncompressed true colour, origin at the top left (descriptor bit 5)
+    uint8_t header[18] = {};
+    header[2] = 2;
+    header[12] = (uint8_t)(width & 0xFF);
+    header[13] = (uint8_t)(width >> 8);
+    header[14] = (uint8_t)(height & 0xFF);
+    header[15] = (uint8_t)(height >> 8);
+    header[16] = (uint8_t)(channels * 8);
+    header[17] = (uint8_t)(0x20 | (channels == 4 ? 8 : 0));
+
+    fileStream.write((const char*)header, sizeof(header));
+
+    // TGA stores BGR(A)
+    vector<uint8_t> row((size_t)width * channels);
+
+    for (int32_t y = 0; y < height; y++)
+    {
+        const uint8_t* source = pixels + (size_t)y * width * channels;
+
+        for (int32_t x = 0; x < width; x++)
+        {
+            row[x * channels + 0] = source[x * channels + 2];
+            row[x * channels + 1] = source[x * channels + 1];
+            row[x * channels + 2] = source[x * channels + 0];
+            if (channels == 4) row[x * channels + 3] = source[x * channels + 3];
+        }
+
+        fileStream.write((const char*)row.data(), row.size());
+    }
+
+    fileStream.close();
+
+    return !fileStream.fail();
+}
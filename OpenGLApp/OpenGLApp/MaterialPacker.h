@@ -0,0 +1,61 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_set>
+
+#include "Config.h"
+#include "TextureCooker.h"
+
+using std::cerr;
+using std::endl;
+using std::string;
+
+// Source maps of a material, empty when it doesn't have that one
+struct MaterialMapPaths
+{
+    string occlusion;
+    string roughness;
+    string metalness;
+    string height;
+
+    bool IsEmpty() const { return occlusion.empty() && roughness.empty() && metalness.empty() && height.empty(); }
+};
+
+/*
+    Import step for the scalar maps of a material.
+
+    Occlusion, roughness and metalness (and height, when there is one) are
+    packed into the channels of one image, R = occlusion, G = roughness,
+    B = metalness, A = height, so the shader does one fetch from one unit
+    instead of three or four. The packed image is written next to the
+    sources as an uncompressed TGA and goes through the usual cooking, so
+    it ends up as BC1 (BC3 with height) like any other texture.
+
+    Missing maps get the value that leaves the shading as it was:
+    occlusion 1, roughness 0, metalness 0, height 0.
+*/
+class MaterialPacker
+{
+public:
+
+    // Returns the packed image, written again when a source is newer. Empty if there is nothing to pack.
+    // Safe from several jobs, one packs a file while the others asking for it wait
+    static string Pack(const MaterialMapPaths& paths);
+
+private:
+
+    // Packed files being written right now
+    static std::mutex packMutex;
+    static std::condition_variable packCondition;
+    static std::unordered_set<string> packingPaths;
+
+    static string GetPackedPath(const MaterialMapPaths& paths);
+    static bool IsUpToDate(const string& packedPath, const MaterialMapPaths& paths);
+    static bool PackMaps(const MaterialMapPaths& paths, const string& packedPath);
+
+    // Top-left origin, the same row order stb_image decodes to
+    static bool WriteTGA(const string& path, const uint8_t* pixels, int32_t width, int32_t height, int32_t channels);
+};
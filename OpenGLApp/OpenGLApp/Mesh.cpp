@@ -6,11 +6,20 @@ Mesh::Mesh()
     VBO = 0;
     IBO = 0;
     indexCount = 0;
+    indexSize = sizeof(uint32_t);
+    indexType = GL_UNSIGNED_INT;
 }
 
-void Mesh::CreateMesh(GLfloat *vertices, uint32_t *indices, uint32_t numOfVertices, uint32_t numOfIndices)
+uint32_t Mesh::ChooseIndexSize(size_t vertexCount)
 {
-    indexCount = numOfVertices;
+    return (MESH_16BIT_INDICES && vertexCount <= 65536) ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+void Mesh::CreateMesh(const GLfloat *vertices, const void *indices, uint32_t numOfVertices, uint32_t numOfIndices, uint32_t bytesPerIndex)
+{
+    indexCount = numOfIndices;
+    indexSize = bytesPerIndex;
+    indexType = (indexSize == sizeof(uint16_t)) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
 
     // Allocates GPU memory space for 1 Vertex Array object (VAO)
     glGenVertexArrays(1, &VAO);
@@ -25,7 +34,7 @@ void Mesh::CreateMesh(GLfloat *vertices, uint32_t *indices, uint32_t numOfVertic
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
 
     // Transfer the indices data to the GPU memory
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices[0]) * numOfIndices, indices, GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)indexSize * numOfIndices, indices, GL_STATIC_DRAW);
 
     // Creates a Vertex Buffer Object (VBO) inside the VAO to store the vertex data
     glGenBuffers(1, &VBO);
@@ -74,7 +83,7 @@ void Mesh::RenderMesh()
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
 
     // Draw the triangle using OpenGL draw call
-    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, indexCount, indexType, 0);
 
     // Unbind the index buffer object
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
@@ -83,6 +92,20 @@ void Mesh::RenderMesh()
     glBindVertexArray(0);
 }
 
+void Mesh::RenderRanges(const GLsizei* counts, const void* const* offsets, GLsizei rangeCount)
+{
+    if (rangeCount == 0) return;
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+
+    // One call for every visible cluster of the mesh
+    glMultiDrawElements(GL_TRIANGLES, counts, indexType, offsets, rangeCount);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
 void Mesh::ClearMesh()
 {
     if( IBO != 0 )
@@ -3,20 +3,33 @@
 #include <iostream>
 #include <GL\glew.h>
 
+#include "Config.h"
+
 class Mesh
 {
 public:
 
     Mesh();
-    void CreateMesh( GLfloat* vertices, uint32_t* indices, uint32_t numOfVertices, uint32_t numOfIndices );
+    // numOfVertices counts floats, 8 per vertex. bytesPerIndex is 2 for uint16_t indices, 4 for uint32_t
+    void CreateMesh( const GLfloat* vertices, const void* indices, uint32_t numOfVertices, uint32_t numOfIndices, uint32_t bytesPerIndex = sizeof(uint32_t) );
     void RenderMesh();
+
+    // Draws only these parts of the index buffer, offsets are in bytes
+    void RenderRanges(const GLsizei* counts, const void* const* offsets, GLsizei rangeCount);
     void ClearMesh();
 
+    uint32_t GetIndexSize() { return indexSize; }
+
+    // 16 bits when every vertex of the mesh can be reached with them (and MESH_16BIT_INDICES is on)
+    static uint32_t ChooseIndexSize(size_t vertexCount);
+
     ~Mesh();
 
 private:
 
     GLuint VAO, VBO, IBO;
     GLsizei indexCount; 
+    uint32_t indexSize;
+    GLenum indexType;
 
 };
\ No newline at end of file
@@ -0,0 +1,444 @@
+#include "MeshCache.h"
+#include "TextureCooker.h"
+#include "Hash.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+
+#ifdef _WIN32
+#include <direct.h>
+#define MAKE_DIRECTORY(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define MAKE_DIRECTORY(path) mkdir(path, 0755)
+#endif
+
+using std::ofstream;
+
+// Written at the start of every cache file
+struct MeshCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t meshCount;
+    uint32_t materialCount;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+// In front of the vertices and indices of each mesh
+struct MeshCacheRecord
+{
+    uint32_t vertexFloatCount;
+    uint32_t indexCount;
+    uint32_t indexBytes;            // Size of the index data, encoded or not
+    uint32_t indexSize;             // 2 or 4 once decoded
+    uint32_t materialIndex;
+    float boundsCenter[3];
+    float boundsRadius;
+    uint32_t clusterCount;          // The clusters come right after the record
+};
+
+// Read in place from the mapping
+static_assert(sizeof(MeshCluster) == 40, "MeshCluster is stored as is in the mesh cache");
+
+static const uint32_t MESH_CACHE_MAGIC = 0x434D4F4D;    // "MOMC"
+static const uint32_t MESH_CACHE_VERSION = 4;          // 2: optimized triangle and vertex order, 3: culling clusters, 4: 16 bit indices
+static const uint32_t MESH_CACHE_ENCODED_INDICES = 1 << 0;
+
+// Everything after the materials starts 4 byte aligned, so the vertices can be read in place
+static size_t AlignTo4(size_t offset)
+{
+    return (offset + 3) & ~(size_t)3;
+}
+
+// indexSize is 2 or 4
+static uint32_t GetIndex(const uint8_t* indices, size_t i, uint32_t indexSize)
+{
+    if (indexSize == sizeof(uint16_t))
+    {
+        uint16_t index;
+        memcpy(&index, indices + i * sizeof(uint16_t), sizeof(uint16_t));
+        return index;
+    }
+
+    uint32_t index;
+    memcpy(&index, indices + i * sizeof(uint32_t), sizeof(uint32_t));
+    return index;
+}
+
+// A broken index would read past the end of the vertex buffer on the GPU
+static bool CheckIndices(const uint8_t* indices, uint32_t indexCount, uint32_t indexSize, size_t vertexCount)
+{
+    for (uint32_t i = 0; i < indexCount; i++)
+    {
+        if (GetIndex(indices, i, indexSize) >= vertexCount) return false;
+    }
+
+    return true;
+}
+
+static void SetIndex(uint8_t* indices, size_t i, uint32_t indexSize, uint32_t index)
+{
+    if (indexSize == sizeof(uint16_t))
+    {
+        uint16_t shortIndex = (uint16_t)index;
+        memcpy(indices + i * sizeof(uint16_t), &shortIndex, sizeof(uint16_t));
+        return;
+    }
+
+    memcpy(indices + i * sizeof(uint32_t), &index, sizeof(uint32_t));
+}
+
+// Zigzag delta from the previous index, 7 bits per byte. Neighbouring triangles share vertices, so most take one byte
+static void EncodeIndices(const uint8_t* indices, uint32_t indexCount, uint32_t indexSize, vector<uint8_t>& encoded)
+{
+    encoded.clear();
+    encoded.reserve(indexCount * 2);
+
+    int64_t previous = 0;
+
+    for (uint32_t i = 0; i < indexCount; i++)
+    {
+        uint32_t index = GetIndex(indices, i, indexSize);
+        int64_t delta = (int64_t)index - previous;
+        uint64_t value = (uint64_t)((delta << 1) ^ (delta >> 63));
+        previous = index;
+
+        do
+        {
+            uint8_t byte = (uint8_t)(value & 0x7F);
+            value >>= 7;
+            encoded.push_back(byte | (value ? 0x80 : 0));
+        } while (value);
+    }
+}
+
+static bool DecodeIndices(const uint8_t* encoded, size_t encodedSize, uint32_t indexCount, uint32_t indexSize, vector<uint8_t>& indices)
+{
+    indices.resize((size_t)indexCount * indexSize);
+    int64_t maxIndex = (indexSize == sizeof(uint16_t)) ? UINT16_MAX : UINT32_MAX;
+
+    size_t offset = 0;
+    int64_t previous = 0;
+
+    for (uint32_t i = 0; i < indexCount; i++)
+    {
+        uint64_t value = 0;
+        uint32_t shift = 0;
+        uint8_t byte = 0;
+
+        do
+        {
+            if (offset >= encodedSize || shift > 63) return false;
+
+            byte = encoded[offset++];
+            value |= (uint64_t)(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+
+        int64_t delta = (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+        previous += delta;
+
+        if (previous < 0 || previous > maxIndex) return false;
+        SetIndex(indices.data(), i, indexSize, (uint32_t)previous);
+    }
+
+    return offset == encodedSize;
+}
+
+// Bounds checked cursor over the mapped file
+struct CacheReader
+{
+    const uint8_t* data;
+    size_t size;
+    size_t offset;
+
+    const uint8_t* Take(size_t count)
+    {
+        if (count > size - offset) return nullptr;
+
+        const uint8_t* taken = data + offset;
+        offset += count;
+        return taken;
+    }
+
+    bool Read(void* destination, size_t count)
+    {
+        const uint8_t* source = Take(count);
+        if (!source) return false;
+
+        memcpy(destination, source, count);
+        return true;
+    }
+
+    bool ReadString(string& text)
+    {
+        uint32_t length = 0;
+        if (!Read(&length, sizeof(length))) return false;
+
+        const uint8_t* characters = Take(length);
+        if (!characters) return false;
+
+        text.assign((const char*)characters, length);
+        return true;
+    }
+
+    bool Align()
+    {
+        size_t aligned = AlignTo4(offset);
+        if (aligned > size) return false;
+
+        offset = aligned;
+        return true;
+    }
+};
+
+static void WriteString(ofstream& fileStream, const string& text)
+{
+    uint32_t length = (uint32_t)text.size();
+    fileStream.write((const char*)&length, sizeof(length));
+    fileStream.write(text.data(), length);
+}
+
+static void WritePadding(ofstream& fileStream)
+{
+    const char zeros[4] = {};
+    size_t offset = (size_t)fileStream.tellp();
+    fileStream.write(zeros, AlignTo4(offset) - offset);
+}
+
+uint64_t MeshCache::GetKey(const string& fileLocation, const string& objName, uint32_t importFlags)
+{
+    uint64_t modifiedTime = 0, fileSize = 0;
+    TextureCooker::GetSourceStamp(fileLocation, modifiedTime, fileSize);
+
+    uint64_t key = HashFNV1a64(fileLocation);
+    key = HashFNV1a64("|", 1, key);
+    key = HashFNV1a64(objName, key);
+    key = HashFNV1a64("|", 1, key);
+
+    uint64_t values[] = { modifiedTime, fileSize, importFlags, MESH_CACHE_VERSION, MESH_OPTIMIZE ? 1u : 0u, MESH_CLUSTER_TRIANGLES, MESH_16BIT_INDICES ? 1u : 0u, GLTF_NATIVE_IMPORT ? 1u : 0u };
+    return HashFNV1a64(values, sizeof(values), key);
+}
+
+string MeshCache::GetCachePath(uint64_t key)
+{
+    return string(MESH_CACHE_DIR) + "/" + HashToString(key) + ".mesh";
+}
+
+MeshView MeshCache::GetView(const MeshData& mesh)
+{
+    MeshView view;
+    view.vertices = mesh.vertices.data();
+    view.vertexFloatCount = (uint32_t)mesh.vertices.size();
+    view.indices = mesh.indices.data();
+    view.indexCount = mesh.indexCount;
+    view.indexSize = mesh.indexSize;
+    view.materialIndex = mesh.materialIndex;
+    view.boundsCenter = mesh.boundsCenter;
+    view.boundsRadius = mesh.boundsRadius;
+    view.clusters = mesh.clusters.data();
+    view.clusterCount = (uint32_t)mesh.clusters.size();
+
+    return view;
+}
+
+void MeshCache::SetIndices(MeshData& mesh, const vector<uint32_t>& indices)
+{
+    mesh.indexCount = (uint32_t)indices.size();
+    mesh.indexSize = Mesh::ChooseIndexSize(mesh.vertices.size() / 8);
+    mesh.indices.resize((size_t)mesh.indexCount * mesh.indexSize);
+
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        SetIndex(mesh.indices.data(), i, mesh.indexSize, indices[i]);
+    }
+}
+
+bool MeshCache::Save(uint64_t key, const ModelData& model)
+{
+    // Fails harmlessly when it already exists
+    MAKE_DIRECTORY(MESH_CACHE_DIR);
+
+    string path = GetCachePath(key);
+    ofstream fileStream(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (!fileStream.is_open())
+    {
+        cerr << "\n\nERROR: Failed to write the mesh cache " << path << ".\n" << endl;
+        return false;
+    }
+
+    MeshCacheHeader header = {};
+    header.magic = MESH_CACHE_MAGIC;
+    header.version = MESH_CACHE_VERSION;
+    header.key = key;
+    header.meshCount = (uint32_t)model.meshes.size();
+    header.materialCount = (uint32_t)model.materials.size();
+    header.flags = MESH_CACHE_COMPRESS_INDICES ? MESH_CACHE_ENCODED_INDICES : 0;
+
+    fileStream.write((const char*)&header, sizeof(header));
+
+    for (const MaterialData& material : model.materials)
+    {
+        const string* paths[] = { &material.albedo, &material.normal, &material.maps.occlusion,
+                                  &material.maps.roughness, &material.maps.metalness, &material.maps.height };
+
+        for (const string* path : paths) WriteString(fileStream, *path);
+    }
+
+    WritePadding(fileStream);
+
+    vector<uint8_t> encoded;
+
+    for (const MeshData& mesh : model.meshes)
+    {
+        if (MESH_CACHE_COMPRESS_INDICES) EncodeIndices(mesh.indices.data(), mesh.indexCount, mesh.indexSize, encoded);
+
+        MeshCacheRecord record;
+        record.vertexFloatCount = (uint32_t)mesh.vertices.size();
+        record.indexCount = mesh.indexCount;
+        record.indexBytes = (uint32_t)(MESH_CACHE_COMPRESS_INDICES ? encoded.size() : mesh.indices.size());
+        record.indexSize = mesh.indexSize;
+        record.materialIndex = mesh.materialIndex;
+        record.boundsCenter[0] = mesh.boundsCenter.x;
+        record.boundsCenter[1] = mesh.boundsCenter.y;
+        record.boundsCenter[2] = mesh.boundsCenter.z;
+        record.boundsRadius = mesh.boundsRadius;
+        record.clusterCount = (uint32_t)mesh.clusters.size();
+
+        fileStream.write((const char*)&record, sizeof(record));
+        fileStream.write((const char*)mesh.clusters.data(), mesh.clusters.size() * sizeof(MeshCluster));
+        fileStream.write((const char*)mesh.vertices.data(), mesh.vertices.size() * sizeof(GLfloat));
+
+        if (MESH_CACHE_COMPRESS_INDICES) fileStream.write((const char*)encoded.data(), encoded.size());
+        else fileStream.write((const char*)mesh.indices.data(), mesh.indices.size());
+
+        WritePadding(fileStream);
+    }
+
+    fileStream.close();
+
+    if (fileStream.fail())
+    {
+        cerr << "\n\nERROR: Failed to write the mesh cache " << path << ".\n" << endl;
+        remove(path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool CachedModel::Open(uint64_t key)
+{
+    Close();
+
+    string path = MeshCache::GetCachePath(key);
+    if (!file.Open(path)) return false;
+
+    CacheReader reader = { file.GetData(), file.GetSize(), 0 };
+
+    MeshCacheHeader header = {};
+
+    bool valid = reader.Read(&header, sizeof(header)) &&
+                 header.magic == MESH_CACHE_MAGIC &&
+                 header.version == MESH_CACHE_VERSION &&
+                 header.key == key;
+
+    if (valid)
+    {
+        materials.resize(header.materialCount);
+
+        for (MaterialData& material : materials)
+        {
+            string* paths[] = { &material.albedo, &material.normal, &material.maps.occlusion,
+                                &material.maps.roughness, &material.maps.metalness, &material.maps.height };
+
+            for (string* materialPath : paths)
+            {
+                valid = valid && reader.ReadString(*materialPath);
+            }
+        }
+
+        valid = valid && reader.Align();
+    }
+
+    bool encodedIndices = (header.flags & MESH_CACHE_ENCODED_INDICES) != 0;
+
+    for (uint32_t i = 0; valid && i < header.meshCount; i++)
+    {
+        MeshCacheRecord record;
+        if (!reader.Read(&record, sizeof(record))) { valid = false; break; }
+
+        if (record.indexSize != sizeof(uint16_t) && record.indexSize != sizeof(uint32_t)) { valid = false; break; }
+        if (record.vertexFloatCount % 8 != 0) { valid = false; break; }       // Whole vertices only
+
+        const uint8_t* clusterData = reader.Take((size_t)record.clusterCount * sizeof(MeshCluster));
+        const uint8_t* vertexData = reader.Take((size_t)record.vertexFloatCount * sizeof(GLfloat));
+        const uint8_t* indexData = reader.Take(record.indexBytes);
+
+        if (!clusterData || !vertexData || !indexData || !reader.Align()) { valid = false; break; }
+
+        // The culling draws these ranges straight from the index buffer
+        const MeshCluster* clusters = (const MeshCluster*)clusterData;
+
+        for (uint32_t c = 0; c < record.clusterCount; c++)
+        {
+            if (clusters[c].indexOffset > record.indexCount || clusters[c].indexCount > record.indexCount - clusters[c].indexOffset) valid = false;
+        }
+
+        if (!valid) break;
+
+        MeshView view;
+        view.vertices = (const GLfloat*)vertexData;
+        view.vertexFloatCount = record.vertexFloatCount;
+        view.indexCount = record.indexCount;
+        view.indexSize = record.indexSize;
+        view.materialIndex = record.materialIndex;
+        view.boundsCenter = glm::vec3(record.boundsCenter[0], record.boundsCenter[1], record.boundsCenter[2]);
+        view.boundsRadius = record.boundsRadius;
+        view.clusters = clusters;
+        view.clusterCount = record.clusterCount;
+
+        if (encodedIndices)
+        {
+            decodedIndices.emplace_back();
+
+            if (!DecodeIndices(indexData, record.indexBytes, record.indexCount, record.indexSize, decodedIndices.back())) { valid = false; break; }
+
+            view.indices = decodedIndices.back().data();
+        }
+        else
+        {
+            if (record.indexBytes != (size_t)record.indexCount * record.indexSize) { valid = false; break; }
+
+            // Aligned by the writer, used in place
+            view.indices = indexData;
+        }
+
+        if (!CheckIndices((const uint8_t*)view.indices, view.indexCount, view.indexSize, view.vertexFloatCount / 8)) { valid = false; break; }
+
+        meshes.push_back(view);
+    }
+
+    if (!valid)
+    {
+        cerr << "Mesh cache: ignoring invalid file " << path << endl;
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void CachedModel::Close()
+{
+    meshes.clear();
+    materials.clear();
+    decodedIndices.clear();
+    file.Close();
+}
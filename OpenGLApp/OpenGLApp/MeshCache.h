@@ -0,0 +1,111 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+
+#include "Config.h"
+#include "AssetPack.h"
+#include "MaterialPacker.h"
+#include "MeshOptimizer.h"
+#include "Mesh.h"
+
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+
+// Texture files of a material, empty when it doesn't have that one
+struct MaterialData
+{
+    string albedo;
+    string normal;
+    MaterialMapPaths maps;
+};
+
+// A mesh as Assimp imported it, 8 floats per vertex (position, uv, normal)
+struct MeshData
+{
+    vector<GLfloat> vertices;
+    vector<uint8_t> indices;            // indexCount indices of indexSize bytes (Mesh::ChooseIndexSize)
+    uint32_t indexCount;
+    uint32_t indexSize;
+    uint32_t materialIndex;
+    glm::vec3 boundsCenter;
+    float boundsRadius;
+    vector<MeshCluster> clusters;       // Cover the indices in order, empty when clustering is off
+};
+
+struct ModelData
+{
+    vector<MeshData> meshes;
+    vector<MaterialData> materials;
+};
+
+// What Mesh::CreateMesh needs, pointing into a MeshData or into the mapped cache file
+struct MeshView
+{
+    const GLfloat* vertices;
+    uint32_t vertexFloatCount;
+    const void* indices;
+    uint32_t indexCount;
+    uint32_t indexSize;
+    uint32_t materialIndex;
+    glm::vec3 boundsCenter;
+    float boundsRadius;
+    const MeshCluster* clusters;
+    uint32_t clusterCount;
+};
+
+/*
+    On-disk cache of imported models (MeshCache/<key>.mesh).
+
+    The key hashes the source path, its size and modification time, the
+    Assimp import flags and the format version, so an edited model or a
+    different import just misses and goes through Assimp again. Files
+    are memory mapped (or come from the asset pack, which is the same
+    thing) and the vertices go from the mapping straight into
+    the GL buffers, the indices are delta + varint encoded when
+    MESH_CACHE_COMPRESS_INDICES is on. The culling clusters are read in
+    place too. Meshes with few enough vertices keep 16 bit indices all
+    the way to the GL buffer.
+*/
+class MeshCache
+{
+public:
+
+    // objName is part of the key because the texture paths are built from it
+    static uint64_t GetKey(const string& fileLocation, const string& objName, uint32_t importFlags);
+
+    static bool Save(uint64_t key, const ModelData& model);
+
+    static MeshView GetView(const MeshData& mesh);
+
+    // Stores the indices at the width the mesh's vertex count allows. Set the vertices first
+    static void SetIndices(MeshData& mesh, const vector<uint32_t>& indices);
+
+    static string GetCachePath(uint64_t key);
+};
+
+// A cache file open for reading. The mesh views stay valid until it's closed
+class CachedModel
+{
+public:
+
+    // False when there is no valid file for the key
+    bool Open(uint64_t key);
+    void Close();
+
+    const vector<MeshView>& GetMeshes() const { return meshes; }
+    const vector<MaterialData>& GetMaterials() const { return materials; }
+
+private:
+
+    AssetFile file;
+    vector<MeshView> meshes;
+    vector<MaterialData> materials;
+    vector<vector<uint8_t>> decodedIndices;
+};
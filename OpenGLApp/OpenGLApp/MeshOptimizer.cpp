@@ -0,0 +1,421 @@
+#include "MeshOptimizer.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <math.h>
+#include <float.h>
+
+#include <glm\glm.hpp>
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+    VertexCacheStats stats = { 0.0f, 0.0f };
+    if (indices.empty() || vertexCount == 0) return stats;
+
+    // Time each vertex went into the FIFO, it's still there while fewer than cacheSize came after it
+    vector<uint64_t> insertedAt(vertexCount, 0);
+    vector<uint8_t> used(vertexCount, 0);
+    uint64_t missCount = 0;
+    size_t usedCount = 0;
+
+    for (uint32_t index : indices)
+    {
+        if (!used[index])
+        {
+            used[index] = 1;
+            usedCount++;
+        }
+
+        if (insertedAt[index] == 0 || missCount - insertedAt[index] >= cacheSize)
+        {
+            missCount++;
+            insertedAt[index] = missCount;
+        }
+    }
+
+    stats.acmr = (float)missCount / (float)(indices.size() / 3);
+    stats.atvr = (float)missCount / (float)usedCount;
+
+    return stats;
+}
+
+void MeshOptimizer::Optimize(vector<GLfloat>& vertices, vector<uint32_t>& indices, uint32_t stride)
+{
+    if (indices.size() < 3 || indices.size() % 3 != 0 || stride < 3) return;
+
+    size_t vertexCount = vertices.size() / stride;
+
+    vector<uint32_t> reordered, clusterStarts;
+    OptimizeVertexCache(indices, vertexCount, MESH_VERTEX_CACHE_SIZE, reordered, clusterStarts);
+
+    OptimizeOverdraw(vertices, stride, reordered, clusterStarts);
+    OptimizeVertexFetch(vertices, stride, reordered);
+
+    indices.swap(reordered);
+}
+
+void MeshOptimizer::BuildTriangleAdjacency(const vector<uint32_t>& indices, size_t vertexCount, vector<uint32_t>& offsets, vector<uint32_t>& adjacency)
+{
+    size_t triangleCount = indices.size() / 3;
+
+    // Triangles around each vertex, packed one vertex after the other
+    offsets.assign(vertexCount + 1, 0);
+    for (uint32_t index : indices) offsets[index + 1]++;
+    for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] += offsets[v];
+
+    adjacency.resize(indices.size());
+    vector<uint32_t> fillOffsets(offsets.begin(), offsets.end() - 1);
+
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        for (size_t k = 0; k < 3; k++) adjacency[fillOffsets[indices[t * 3 + k]]++] = (uint32_t)t;
+    }
+}
+
+void MeshOptimizer::OptimizeVertexCache(const vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize,
+                                        vector<uint32_t>& result, vector<uint32_t>& clusterStarts)
+{
+    size_t triangleCount = indices.size() / 3;
+
+    vector<uint32_t> adjacencyOffsets, adjacency;
+    BuildTriangleAdjacency(indices, vertexCount, adjacencyOffsets, adjacency);
+
+    // Triangles not emitted yet around each vertex
+    vector<uint32_t> liveCount(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) liveCount[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+
+    // Time stamps start past the cache size, so nothing is in the cache at first
+    vector<uint32_t> cacheTime(vertexCount, 0);
+    vector<uint8_t> emitted(triangleCount, 0);
+    vector<uint32_t> deadEnds;
+    vector<uint32_t> candidates;
+    uint32_t timeStamp = cacheSize + 1;
+    size_t cursor = 0;
+
+    result.clear();
+    result.reserve(indices.size());
+
+    clusterStarts.clear();
+    clusterStarts.push_back(0);
+
+    int64_t fanning = 0;
+
+    while (fanning >= 0)
+    {
+        candidates.clear();
+
+        // Every triangle left around the fanning vertex
+        for (uint32_t a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++)
+        {
+            uint32_t triangle = adjacency[a];
+            if (emitted[triangle]) continue;
+
+            for (size_t k = 0; k < 3; k++)
+            {
+                uint32_t vertex = indices[triangle * 3 + k];
+
+                result.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                liveCount[vertex]--;
+
+                if (timeStamp - cacheTime[vertex] > cacheSize)
+                {
+                    cacheTime[vertex] = timeStamp;
+                    timeStamp++;
+                }
+            }
+
+            emitted[triangle] = 1;
+        }
+
+        // The next fan is around the candidate that stays in the cache the longest, if it can finish there
+        int64_t next = -1;
+        int64_t bestPriority = -1;
+
+        for (uint32_t vertex : candidates)
+        {
+            if (liveCount[vertex] == 0) continue;
+
+            int64_t priority = 0;
+            if (timeStamp - cacheTime[vertex] + 2 * liveCount[vertex] <= cacheSize) priority = timeStamp - cacheTime[vertex];
+
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                next = vertex;
+            }
+        }
+
+        if (next >= 0)
+        {
+            fanning = next;
+            continue;
+        }
+
+        // Dead end, the fans restart from a recent vertex or the next unfinished one
+        fanning = -1;
+
+        while (!deadEnds.empty() && fanning < 0)
+        {
+            uint32_t vertex = deadEnds.back();
+            deadEnds.pop_back();
+
+            if (liveCount[vertex] > 0) fanning = vertex;
+        }
+
+        while (cursor < vertexCount && fanning < 0)
+        {
+            if (liveCount[cursor] > 0) fanning = (int64_t)cursor;
+            cursor++;
+        }
+
+        // Cache reuse breaks here anyway, so the overdraw pass is free to move what comes next.
+        // Tiny clusters are merged, reordering them would cost more cache misses than it saves
+        uint32_t emittedTriangles = (uint32_t)(result.size() / 3);
+
+        if (fanning >= 0 && emittedTriangles - clusterStarts.back() >= MESH_OVERDRAW_CLUSTER_TRIANGLES)
+        {
+            clusterStarts.push_back(emittedTriangles);
+        }
+    }
+}
+
+void MeshOptimizer::OptimizeOverdraw(const vector<GLfloat>& vertices, uint32_t stride, vector<uint32_t>& indices, const vector<uint32_t>& clusterStarts)
+{
+    size_t triangleCount = indices.size() / 3;
+    size_t clusterCount = clusterStarts.size();
+
+    if (clusterCount < 2) return;
+
+    struct Cluster
+    {
+        uint32_t firstTriangle, endTriangle;
+        glm::vec3 centroid;         // Area weighted
+        glm::vec3 normal;           // Sum of the unnormalized face normals
+        float area;
+        float sortKey;
+    };
+
+    vector<Cluster> clusters(clusterCount);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        Cluster& cluster = clusters[c];
+        cluster.firstTriangle = clusterStarts[c];
+        cluster.endTriangle = (c + 1 < clusterCount) ? clusterStarts[c + 1] : (uint32_t)triangleCount;
+        cluster.centroid = glm::vec3(0.0f);
+        cluster.normal = glm::vec3(0.0f);
+        cluster.area = 0.0f;
+
+        for (uint32_t t = cluster.firstTriangle; t < cluster.endTriangle; t++)
+        {
+            const GLfloat* p0 = &vertices[(size_t)indices[t * 3 + 0] * stride];
+            const GLfloat* p1 = &vertices[(size_t)indices[t * 3 + 1] * stride];
+            const GLfloat* p2 = &vertices[(size_t)indices[t * 3 + 2] * stride];
+
+            glm::vec3 a(p0[0], p0[1], p0[2]), b(p1[0], p1[1], p1[2]), d(p2[0], p2[1], p2[2]);
+            glm::vec3 faceNormal = glm::cross(b - a, d - a);
+            float area = glm::length(faceNormal) * 0.5f;
+
+            cluster.normal += faceNormal;
+            cluster.centroid += (a + b + d) * (area / 3.0f);
+            cluster.area += area;
+        }
+
+        meshCentroid += cluster.centroid;
+        meshArea += cluster.area;
+
+        if (cluster.area > 0.0f) cluster.centroid /= cluster.area;
+    }
+
+    if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+    // Clusters far out along their own normal are the ones that hide the others, they go first
+    for (Cluster& cluster : clusters)
+    {
+        float normalLength = glm::length(cluster.normal);
+        cluster.sortKey = (normalLength > 0.0f) ? glm::dot(cluster.centroid - meshCentroid, cluster.normal / normalLength) : 0.0f;
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+    vector<uint32_t> sorted;
+    sorted.reserve(indices.size());
+
+    for (const Cluster& cluster : clusters)
+    {
+        sorted.insert(sorted.end(), indices.begin() + cluster.firstTriangle * 3, indices.begin() + cluster.endTriangle * 3);
+    }
+
+    indices.swap(sorted);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(vector<GLfloat>& vertices, uint32_t stride, vector<uint32_t>& indices)
+{
+    size_t vertexCount = vertices.size() / stride;
+    vector<uint32_t> remap(vertexCount, UINT32_MAX);
+    uint32_t nextVertex = 0;
+
+    for (uint32_t& index : indices)
+    {
+        if (remap[index] == UINT32_MAX) remap[index] = nextVertex++;
+        index = remap[index];
+    }
+
+    vector<GLfloat> reordered((size_t)nextVertex * stride);
+
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        if (remap[v] == UINT32_MAX) continue;
+
+        memcpy(&reordered[(size_t)remap[v] * stride], &vertices[v * stride], stride * sizeof(GLfloat));
+    }
+
+    vertices.swap(reordered);
+}
+
+void MeshOptimizer::BuildClusters(const vector<GLfloat>& vertices, uint32_t stride, vector<uint32_t>& indices, uint32_t maxTriangles,
+                                  vector<MeshCluster>& clusters)
+{
+    clusters.clear();
+    if (indices.size() < 3 || indices.size() % 3 != 0 || stride < 3 || maxTriangles == 0) return;
+
+    size_t vertexCount = vertices.size() / stride;
+    size_t triangleCount = indices.size() / 3;
+
+    vector<uint32_t> adjacencyOffsets, adjacency;
+    BuildTriangleAdjacency(indices, vertexCount, adjacencyOffsets, adjacency);
+
+    vector<uint8_t> assigned(triangleCount, 0);
+    vector<uint32_t> queuedIn(triangleCount, UINT32_MAX);
+    vector<uint32_t> queue, members;
+    size_t nextSeed = 0;
+
+    vector<uint32_t> clustered;
+    clustered.reserve(indices.size());
+
+    while (true)
+    {
+        while (nextSeed < triangleCount && assigned[nextSeed]) nextSeed++;
+        if (nextSeed == triangleCount) break;
+
+        uint32_t clusterIndex = (uint32_t)clusters.size();
+        size_t queueHead = 0;
+        queue.clear();
+        members.clear();
+
+        // Grows over shared vertices, breadth first so it stays round. A piece that runs out
+        // carries on from the next triangle in order, which is close by after the cache pass
+        while (members.size() < maxTriangles)
+        {
+            uint32_t triangle;
+
+            if (queueHead < queue.size())
+            {
+                triangle = queue[queueHead++];
+                if (assigned[triangle]) continue;
+            }
+            else
+            {
+                while (nextSeed < triangleCount && assigned[nextSeed]) nextSeed++;
+                if (nextSeed == triangleCount) break;
+
+                triangle = (uint32_t)nextSeed;
+            }
+
+            assigned[triangle] = 1;
+            members.push_back(triangle);
+
+            for (size_t k = 0; k < 3; k++)
+            {
+                uint32_t vertex = indices[triangle * 3 + k];
+
+                for (uint32_t a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; a++)
+                {
+                    uint32_t neighbour = adjacency[a];
+                    if (assigned[neighbour] || queuedIn[neighbour] == clusterIndex) continue;
+
+                    queuedIn[neighbour] = clusterIndex;
+                    queue.push_back(neighbour);
+                }
+            }
+        }
+
+        // The cache order inside the cluster stays as it was
+        std::sort(members.begin(), members.end());
+
+        MeshCluster cluster;
+        cluster.indexOffset = (uint32_t)clustered.size();
+        cluster.indexCount = (uint32_t)members.size() * 3;
+
+        for (uint32_t triangle : members)
+        {
+            clustered.insert(clustered.end(), indices.begin() + triangle * 3, indices.begin() + triangle * 3 + 3);
+        }
+
+        ComputeClusterBounds(vertices, stride, clustered, cluster);
+        clusters.push_back(cluster);
+    }
+
+    indices.swap(clustered);
+}
+
+void MeshOptimizer::ComputeClusterBounds(const vector<GLfloat>& vertices, uint32_t stride, const vector<uint32_t>& indices, MeshCluster& cluster)
+{
+    uint32_t first = cluster.indexOffset, end = cluster.indexOffset + cluster.indexCount;
+
+    glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+
+    for (uint32_t i = first; i < end; i++)
+    {
+        const GLfloat* p = &vertices[(size_t)indices[i] * stride];
+        boundsMin = glm::min(boundsMin, glm::vec3(p[0], p[1], p[2]));
+        boundsMax = glm::max(boundsMax, glm::vec3(p[0], p[1], p[2]));
+    }
+
+    // Box center, with the radius to the farthest vertex (tighter than half the diagonal)
+    cluster.center = (boundsMin + boundsMax) * 0.5f;
+    cluster.radius = 0.0f;
+
+    for (uint32_t i = first; i < end; i++)
+    {
+        const GLfloat* p = &vertices[(size_t)indices[i] * stride];
+        cluster.radius = glm::max(cluster.radius, glm::length(glm::vec3(p[0], p[1], p[2]) - cluster.center));
+    }
+
+    // Average facing of the triangles, by winding so it works without the normals
+    vector<glm::vec3> faceNormals;
+    faceNormals.reserve(cluster.indexCount / 3);
+
+    glm::vec3 axis(0.0f);
+
+    for (uint32_t i = first; i + 2 < end; i += 3)
+    {
+        const GLfloat* p0 = &vertices[(size_t)indices[i + 0] * stride];
+        const GLfloat* p1 = &vertices[(size_t)indices[i + 1] * stride];
+        const GLfloat* p2 = &vertices[(size_t)indices[i + 2] * stride];
+
+        glm::vec3 a(p0[0], p0[1], p0[2]), b(p1[0], p1[1], p1[2]), d(p2[0], p2[1], p2[2]);
+        glm::vec3 faceNormal = glm::cross(b - a, d - a);
+        float length = glm::length(faceNormal);
+
+        // Degenerate triangles never draw anything, they don't widen the cone
+        if (length <= 0.0f) continue;
+
+        faceNormals.push_back(faceNormal / length);
+        axis += faceNormals.back();
+    }
+
+    float axisLength = glm::length(axis);
+    cluster.coneAxis = (axisLength > 0.0f) ? axis / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+
+    float minDot = (axisLength > 0.0f) ? 1.0f : -1.0f;
+    for (const glm::vec3& faceNormal : faceNormals) minDot = glm::min(minDot, glm::dot(faceNormal, cluster.coneAxis));
+
+    // Sine of the cone's half angle. Cones of 90 degrees or more always have a triangle facing the viewer
+    cluster.coneCutoff = (minDot > 0.0f) ? sqrtf(1.0f - minDot * minDot) : 1.0f;
+}
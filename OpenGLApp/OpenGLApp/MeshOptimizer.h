@@ -0,0 +1,78 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+
+#include "Config.h"
+
+using std::cerr;
+using std::endl;
+using std::vector;
+
+// Vertices shaded per triangle (ACMR) and per vertex (ATVR), through a FIFO cache
+struct VertexCacheStats
+{
+    float acmr;
+    float atvr;
+};
+
+// A run of triangles that is culled as a whole, with what the culling needs (model space)
+struct MeshCluster
+{
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    glm::vec3 center;           // Bounding sphere
+    float radius;
+    glm::vec3 coneAxis;         // Average facing of the triangles
+    float coneCutoff;           // Sine of the cone's half angle, 1 when it can't be back facing as a whole
+};
+
+/*
+    Import time reordering of triangle lists, run on every mesh before it
+    goes into the mesh cache (so every pass, shadows included, draws the
+    optimized order):
+
+    - Tipsify (Sander et al. 2007) reorders the triangles so vertices
+      are reused while they are still in the post-transform cache.
+    - The clusters Tipsify leaves between its dead ends are sorted so
+      the ones facing out of the mesh draw first and cover the rest,
+      which cuts overdraw without touching the order inside a cluster.
+    - The vertices are renumbered in the order the triangles first use
+      them, so the vertex fetch walks the buffer forward.
+
+    BuildClusters then cuts the result into small clusters for CullView,
+    each one a contiguous index range.
+*/
+class MeshOptimizer
+{
+public:
+
+    static VertexCacheStats AnalyzeVertexCache(const vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize);
+
+    // stride is in floats, the position has to be the first three. Only for triangle lists
+    static void Optimize(vector<GLfloat>& vertices, vector<uint32_t>& indices, uint32_t stride);
+
+    // Regroups the triangles into clusters of up to maxTriangles neighbouring triangles, in index order
+    static void BuildClusters(const vector<GLfloat>& vertices, uint32_t stride, vector<uint32_t>& indices, uint32_t maxTriangles,
+                              vector<MeshCluster>& clusters);
+
+private:
+
+    // Triangles around each vertex v are adjacency[offsets[v]] to adjacency[offsets[v + 1]]
+    static void BuildTriangleAdjacency(const vector<uint32_t>& indices, size_t vertexCount, vector<uint32_t>& offsets, vector<uint32_t>& adjacency);
+
+    // clusterStarts gets the first triangle of each cluster
+    static void OptimizeVertexCache(const vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize,
+                                    vector<uint32_t>& result, vector<uint32_t>& clusterStarts);
+
+    static void OptimizeOverdraw(const vector<GLfloat>& vertices, uint32_t stride, vector<uint32_t>& indices, const vector<uint32_t>& clusterStarts);
+
+    // Drops the vertices no triangle uses
+    static void OptimizeVertexFetch(vector<GLfloat>& vertices, uint32_t stride, vector<uint32_t>& indices);
+
+    // Sphere and normal cone of the triangles in the cluster's index range
+    static void ComputeClusterBounds(const vector<GLfloat>& vertices, uint32_t stride, const vector<uint32_t>& indices, MeshCluster& cluster);
+};
@@ -1,6 +1,14 @@
 #include "Model.h"
 #include "Utils.h"
 
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <math.h>
+#include <float.h>
+#include <sstream>
+#include <atomic>
+
 Model::Model()
 {
     albedoMap = -1;
@@ -8,60 +16,142 @@ Model::Model()
     metallicMap = -1;
     roughnessMap = -1;
     AOMap = -1;
+
+    drawBuffer = nullptr;
 }
 
+// Same flags for every model, they are part of the mesh cache key
+static const uint32_t MODEL_IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices | aiProcess_CalcTangentSpace;
+
 void Model::LoadModel(const string& fileName, const string& objName)
 {
     cerr << "\nLoading model [" << objName << "]..." << endl;
 
-    Assimp::Importer importer;
-    const aiScene *scene = importer.ReadFile(fileName, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices | aiProcess_CalcTangentSpace);
+    LoadModel(fileName, objName, false);
+}
+
+void Model::LoadModel(const string &fileName, const string &objName, bool invertedTexture)
+{
+    if (ImportModel(fileName, objName, invertedTexture)) FinishLoading();
+}
 
-    if (!scene)
+bool Model::ImportModel(const string& fileName, const string& objName, bool invertedTexture)
+{
+    std::shared_ptr<ModelImport> modelImport = std::make_shared<ModelImport>();
+    modelImport->invertedTexture = invertedTexture;
+    modelImport->materialsLoaded = false;
+    modelImport->nextMesh = 0;
+
+    uint64_t cacheKey = MeshCache::GetKey(fileName, objName, MODEL_IMPORT_FLAGS);
+
+    // Cached models skip Assimp, the vertices go from the mapped file to the GL buffers
+    if (modelImport->cachedModel.Open(cacheKey))
     {
-        cerr << "\n\nERROR: Failed to load ASSIMP Scene at " << fileName << ". " << importer.GetErrorString() << ".\n" << endl;
-        return;
+        cerr << "Mesh cache: " << fileName << " (" << modelImport->cachedModel.GetMeshes().size() << " meshes)" << endl;
+
+        modelImport->meshes = modelImport->cachedModel.GetMeshes();
+        modelImport->materials = &modelImport->cachedModel.GetMaterials();
+    }
+    else
+    {
+        ModelData& modelData = modelImport->modelData;
+
+        // glTF has its own reader, Assimp still takes everything else and what the reader can't do
+        bool imported = GLTF_NATIVE_IMPORT && GltfImporter::IsGltf(fileName) && ImportGltf(fileName, objName, modelData);
+
+        if (!imported && !ImportAssimp(fileName, objName, modelData)) return false;
+
+        // Still usable this run if the folder is read only
+        MeshCache::Save(cacheKey, modelData);
+
+        for (const MeshData& mesh : modelData.meshes) modelImport->meshes.push_back(MeshCache::GetView(mesh));
+        modelImport->materials = &modelData.materials;
+    }
+
+    const vector<MaterialData>& materials = *modelImport->materials;
+    modelImport->packedMaps.resize(materials.size());
+
+    // Materials with the same maps share the packed file, only the first one writes it
+    std::map<std::tuple<string, string, string, string>, size_t> firstMaterials;
+    vector<size_t> packedFrom(materials.size());
+
+    for (size_t i = 0; i < materials.size(); i++)
+    {
+        const MaterialMapPaths& maps = materials[i].maps;
+        packedFrom[i] = firstMaterials.emplace(std::make_tuple(maps.occlusion, maps.roughness, maps.metalness, maps.height), i).first->second;
+    }
+
+    // Packing decodes and resizes whole images, so it's spread out too
+    JobSystem::ParallelFor(materials.size(), [&](size_t i)
+    {
+        if (packedFrom[i] == i) modelImport->packedMaps[i] = MaterialPacker::Pack(materials[i].maps);
+    });
+
+    for (size_t i = 0; i < materials.size(); i++)
+    {
+        modelImport->packedMaps[i] = modelImport->packedMaps[packedFrom[i]];
     }
 
-    LoadNode(scene->mRootNode, scene);
-    LoadMaterials(scene, objName, false);
+    pendingImport = modelImport;
+
+    return true;
 }
 
-void Model::LoadModel(const string &fileName, const string &objName, bool invertedTexture)
+uint32_t Model::FinishLoading(uint32_t maxMeshes)
 {
-    Assimp::Importer importer;
-    const aiScene *scene = importer.ReadFile(fileName, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices | aiProcess_CalcTangentSpace);
-    // const aiScene *scene = importer.ReadFile(fileName, aiProcess_Triangulate );
+    if (!pendingImport) return 0;
 
-    if( !scene )
+    // Materials first, so the meshes already in can be drawn while the rest uploads
+    if (!pendingImport->materialsLoaded)
     {
-        cerr << "\n\nERROR: Failed to load ASSIMP Scene at " << fileName << ". " << importer.GetErrorString() << ".\n" << endl;
-        return;
+        LoadMaterials(*pendingImport->materials, pendingImport->packedMaps, pendingImport->invertedTexture);
+        pendingImport->materialsLoaded = true;
     }
 
-    LoadNode(scene->mRootNode, scene);
-    LoadMaterials(scene, objName, invertedTexture);
+    uint32_t uploadedCount = 0;
+
+    while (pendingImport->nextMesh < pendingImport->meshes.size() && uploadedCount < maxMeshes)
+    {
+        CreateMesh(pendingImport->meshes[pendingImport->nextMesh++]);
+        uploadedCount++;
+    }
+
+    // Closes the cache file, the GL buffers have their own copy
+    if (pendingImport->nextMesh == pendingImport->meshes.size()) pendingImport = nullptr;
+
+    return uploadedCount;
 }
 
-void Model::RenderModel()
+void Model::RenderModel(int32_t cullView)
 {
+    if (UsesMaterialDraws() && drawBuffer && !materialDraws.empty())
+    {
+        RenderMaterialDraws(cullView);
+        return;
+    }
+
     for (size_t i = 0; i < meshList.size(); i++)
     {
+        if (!IsMeshVisible((uint32_t)i, cullView)) continue;
+
         uint32_t materialIndex = meshToTex[i];
 
-        if (materialIndex < textureList.size() && textureList[materialIndex])
-        {
-            textureList[materialIndex]->UseTexture();
-        }
+        TextureHandle& albedoTexture = (materialIndex < textureList.size() && textureList[materialIndex]) ? textureList[materialIndex] : plainAlbedoMap;
+        if (albedoTexture) albedoTexture->UseTexture();
 
-        if (normalMap != -1 && normalList[materialIndex])
+        if (normalMap != -1)
         {
-            normalList[materialIndex]->UseGL_TEXTURE(3);
+            TextureHandle& normalTexture = (materialIndex < normalList.size() && normalList[materialIndex]) ? normalList[materialIndex] : flatNormalMap;
+            if (normalTexture) normalTexture->UseGL_TEXTURE(3);
             // glActiveTexture(GL_TEXTURE3);
             // glBindTexture(GL_TEXTURE_2D, normalMap);
             //glUniform1i(normalMap, 2); // O Normal Map está na unidade de textura 1
         }
-        meshList[i]->RenderMesh();
+
+        TextureHandle& materialTexture = (materialIndex < materialList.size() && materialList[materialIndex]) ? materialList[materialIndex] : neutralMaterialMap;
+        if (materialTexture) materialTexture->UseGL_TEXTURE(MATERIAL_MAP_UNIT);
+
+        DrawMesh((uint32_t)i, cullView);
     }
 }
 
@@ -76,157 +166,658 @@ void Model::ClearModel()
         }
     }
 
+    for (size_t i = 0; i < textureArrays.size(); i++)
+    {
+        delete textureArrays[i];
+    }
+
+    textureArrays.clear();
+
+    // Their space in the page table and their cached pages go to the next textures
+    for (size_t i = 0; i < virtualTextures.size(); i++)
+    {
+        if (virtualTextures[i] >= 0) VirtualTexture::RemoveTexture(virtualTextures[i]);
+    }
+
+    virtualTextures.clear();
+    materialLayers.clear();
+    materialDraws.clear();
+    drawOrder.clear();
+    drawBuffer = nullptr;
+    pendingImport = nullptr;
+
+    // The registry frees the GL textures once no other model uses them
+    textureList.clear();
+    normalList.clear();
+    materialList.clear();
+    plainAlbedoMap = nullptr;
+    flatNormalMap = nullptr;
+    neutralMaterialMap = nullptr;
+    meshList.clear();
+    meshToTex.clear();
+    meshBounds.clear();
+    meshClusters.clear();
+    visibleRanges.clear();
+
+    // And forgets the ones that went, so unloading whole scenes doesn't leave their paths behind
+    TextureRegistry::PurgeExpired();
+}
+
+void Model::BuildTextureArrays()
+{
+    if (textureList.empty()) return;
+
+    // Virtual textures draw per material too, with or without arrays
+    MaterialLayers noLayers = { -1, -1, -1, -1, -1, -1 };
+    materialLayers.assign(textureList.size(), noLayers);
+
+    drawOrder.resize(meshList.size());
+    for (uint32_t i = 0; i < drawOrder.size(); i++) drawOrder[i] = i;
+
+    if (!TextureArray::IsSupported())
+    {
+        cerr << "Texture arrays need GL 4.3 or ARB_copy_image, binding textures per mesh." << endl;
+        return;
+    }
+
+    GroupIntoArrays(textureList, SLOT_ALBEDO);
+    GroupIntoArrays(normalList, SLOT_NORMAL);
+    GroupIntoArrays(materialList, SLOT_MATERIAL);
+
+    // Sorted by array first, so each array is bound once
+    std::stable_sort(drawOrder.begin(), drawOrder.end(), [this](uint32_t a, uint32_t b)
+    {
+        const MaterialLayers& layersA = materialLayers[meshToTex[a]];
+        const MaterialLayers& layersB = materialLayers[meshToTex[b]];
+
+        return std::make_tuple(layersA.albedoArray, layersA.normalArray, layersA.materialArray, meshToTex[a]) <
+               std::make_tuple(layersB.albedoArray, layersB.normalArray, layersB.materialArray, meshToTex[b]);
+    });
+
+    cerr << "Texture arrays: " << textureList.size() << " materials in " << textureArrays.size() << " arrays" << endl;
+
+    // The arrays have their own copy, the registry frees the originals if nobody else uses them
     for (size_t i = 0; i < textureList.size(); i++)
     {
-       if (textureList[i])
-       {
-           delete textureList[i];
-           textureList[i] = nullptr;
-       }
+        if (materialLayers[i].albedoArray >= 0) textureList[i] = nullptr;
+        if (materialLayers[i].normalArray >= 0) normalList[i] = nullptr;
+        if (materialLayers[i].materialArray >= 0) materialList[i] = nullptr;
     }
 }
 
+void Model::GroupIntoArrays(const vector<TextureHandle>& textures, TextureSlot slot)
+{
+    // Size, format and mip count have to match to share an array
+    using ArrayKey = std::tuple<GLenum, int32_t, int32_t, int32_t>;
+    std::map<ArrayKey, vector<size_t>> groups;
+
+    for (size_t i = 0; i < textures.size(); i++)
+    {
+        // Streamed textures change their levels at runtime, they keep their own texture
+        if (!textures[i] || textures[i]->GetLevelCount() == 0 || textures[i]->IsStreamed()) continue;
+
+        ArrayKey key(textures[i]->GetInternalFormat(), textures[i]->GetWidth(), textures[i]->GetHeight(), textures[i]->GetLevelCount());
+        groups[key].push_back(i);
+    }
+
+    for (auto& group : groups)
+    {
+        // Materials sharing a texture share the layer too
+        std::map<Texture*, int32_t> layers;
+
+        for (size_t material : group.second)
+        {
+            if (layers.find(textures[material].get()) == layers.end())
+            {
+                int32_t layer = (int32_t)layers.size();
+                layers[textures[material].get()] = layer;
+            }
+        }
+
+        const ArrayKey& key = group.first;
+        TextureArray* textureArray = new TextureArray();
+
+        if (!textureArray->CreateArray(std::get<0>(key), std::get<1>(key), std::get<2>(key), std::get<3>(key), (int32_t)layers.size()))
+        {
+            delete textureArray;
+            continue;
+        }
+
+        for (auto& layer : layers)
+        {
+            textureArray->CopyLayer(layer.first->GetTextureID(), layer.second);
+        }
+
+        int32_t arrayIndex = (int32_t)textureArrays.size();
+        textureArrays.push_back(textureArray);
+
+        for (size_t material : group.second)
+        {
+            int32_t layer = layers[textures[material].get()];
+
+            switch (slot)
+            {
+            case SLOT_ALBEDO:
+                materialLayers[material].albedoArray = arrayIndex;
+                materialLayers[material].albedoLayer = layer;
+                break;
+
+            case SLOT_NORMAL:
+                materialLayers[material].normalArray = arrayIndex;
+                materialLayers[material].normalLayer = layer;
+                break;
+
+            case SLOT_MATERIAL:
+                materialLayers[material].materialArray = arrayIndex;
+                materialLayers[material].materialLayer = layer;
+                break;
+            }
+        }
+    }
+}
 
-void Model::LoadNode(aiNode* node, const aiScene* scene)
+void Model::AddDraws(PerDrawBuffer& perDrawBuffer, const glm::mat4& model, const glm::mat4& viewProjection)
 {
-    for( size_t i = 0; i < node->mNumMeshes; i++ )
+    if (!UsesMaterialDraws() || materialLayers.empty()) return;
+
+    drawBuffer = &perDrawBuffer;
+    materialDraws.resize(materialLayers.size());
+
+    for (size_t i = 0; i < materialLayers.size(); i++)
     {
-        LoadMesh(scene->mMeshes[node->mMeshes[i]], scene);
+        glm::ivec4 textureLayers(materialLayers[i].albedoLayer, materialLayers[i].normalLayer, materialLayers[i].materialLayer, -1);
+        glm::vec4 virtualRegion = VirtualTexture::GetRegion(i < virtualTextures.size() ? virtualTextures[i] : -1);
+
+        materialDraws[i] = perDrawBuffer.AddDraw(model, viewProjection, textureLayers, virtualRegion);
     }
+}
 
-    for( size_t i = 0; i < node->mNumChildren; i++ )
+void Model::UpdateStreaming(const glm::mat4& model, const glm::vec3& cameraPosition, float fovY, int32_t screenHeight)
+{
+    if (!TextureStreamer::IsRunning()) return;
+
+    // Biggest axis scale, so the sphere still covers the mesh
+    float scale = glm::max(glm::length(glm::vec3(model[0])), glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    float pixelsPerUnit = screenHeight / (2.0f * tanf(fovY * 0.5f));
+
+    for (size_t i = 0; i < meshList.size(); i++)
     {
-        LoadNode(node->mChildren[i], scene);
+        uint32_t material = meshToTex[i];
+
+        Texture* textures[] =
+        {
+            material < textureList.size() ? textureList[material].get() : nullptr,
+            material < normalList.size() ? normalList[material].get() : nullptr,
+            material < materialList.size() ? materialList[material].get() : nullptr
+        };
+
+        glm::vec3 center = glm::vec3(model * glm::vec4(meshBounds[i].center, 1.0f));
+        float radius = meshBounds[i].radius * scale;
+
+        // Inside the sphere counts as full screen
+        float distance = glm::max(glm::length(center - cameraPosition) - radius, 0.001f);
+        float screenSize = glm::max(2.0f * radius * pixelsPerUnit / distance, 1.0f);
+
+        for (Texture* texture : textures)
+        {
+            if (!texture || !texture->IsStreamed()) continue;
+
+            // Roughly one texel per pixel across the mesh
+            float texelSize = (float)glm::max(texture->GetWidth(), texture->GetHeight());
+            int32_t level = (int32_t)floorf(log2f(glm::max(texelSize / screenSize, 1.0f)));
+
+            TextureStreamer::RequestLevel(texture, level);
+        }
     }
 }
 
-void Model::LoadMesh(aiMesh* mesh, const aiScene* scene)
+void Model::RenderMaterialDraws(int32_t cullView)
 {
-    vector<GLfloat> vertices;
-    vector<uint32_t> indices;
+    int32_t boundAlbedoArray = -1, boundNormalArray = -1, boundMaterialArray = -1;
+    int32_t boundMaterial = -1;
+
+    for (uint32_t meshIndex : drawOrder)
+    {
+        if (!IsMeshVisible(meshIndex, cullView)) continue;
+
+        int32_t materialIndex = (int32_t)meshToTex[meshIndex];
+        const MaterialLayers& layers = materialLayers[materialIndex];
+
+        // Textures that aren't in an array (streamed, unique size...) are still bound per material
+        if (materialIndex != boundMaterial)
+        {
+            if (textureList[materialIndex]) textureList[materialIndex]->UseTexture();
+            else if (layers.albedoArray < 0 && virtualTextures[materialIndex] < 0 && plainAlbedoMap) plainAlbedoMap->UseTexture();
+
+            if (normalMap != -1)
+            {
+                // A material without a normal layer samples unit 3 too
+                if (normalList[materialIndex]) normalList[materialIndex]->UseGL_TEXTURE(3);
+                else if (layers.normalArray < 0 && flatNormalMap) flatNormalMap->UseGL_TEXTURE(3);
+            }
+
+            if (materialList[materialIndex]) materialList[materialIndex]->UseGL_TEXTURE(MATERIAL_MAP_UNIT);
+        }
+
+        if (layers.albedoArray >= 0 && layers.albedoArray != boundAlbedoArray)
+        {
+            textureArrays[layers.albedoArray]->UseArray(ALBEDO_ARRAY_UNIT);
+            boundAlbedoArray = layers.albedoArray;
+        }
+
+        if (layers.normalArray >= 0 && layers.normalArray != boundNormalArray)
+        {
+            textureArrays[layers.normalArray]->UseArray(NORMAL_ARRAY_UNIT);
+            boundNormalArray = layers.normalArray;
+        }
+
+        if (layers.materialArray >= 0 && layers.materialArray != boundMaterialArray)
+        {
+            textureArrays[layers.materialArray]->UseArray(MATERIAL_ARRAY_UNIT);
+            boundMaterialArray = layers.materialArray;
+        }
+
+        // Only the layers change between materials, the textures stay bound
+        if (materialIndex != boundMaterial)
+        {
+            // No room for it in the per-draw buffer this frame
+            if (!drawBuffer->BindDraw(materialDraws[materialIndex])) continue;
+            boundMaterial = materialIndex;
+        }
 
-    for( size_t i = 0; i < mesh->mNumVertices; i++ )
+        DrawMesh(meshIndex, cullView);
+    }
+}
+
+void Model::CullClusters(const glm::mat4& model, const vector<CullView>& views)
+{
+    visibleRanges.resize(views.size());
+    for (vector<DrawRanges>& viewRanges : visibleRanges) viewRanges.resize(meshList.size());
+
+    // Biggest axis scale, so the spheres still cover the clusters
+    float scale = glm::max(glm::length(glm::vec3(model[0])), glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(model)));
+
+    // Each job owns one mesh in every view, nothing is shared
+    JobSystem::ParallelFor(meshList.size(), [&](size_t i)
     {
-        // Adds the vertices coordinates 
-        vertices.insert(vertices.end(), {mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z});
+        glm::vec3 meshCenter = glm::vec3(model * glm::vec4(meshBounds[i].center, 1.0f));
+        float meshRadius = meshBounds[i].radius * scale;
+
+        const vector<MeshCluster>& clusters = meshClusters[i];
+        uintptr_t indexSize = meshList[i]->GetIndexSize();
+        bool anyVisible = false;
 
-        // Check if the Texture exists
-        if( mesh->mTextureCoords[0] )
+        for (size_t v = 0; v < views.size(); v++)
         {
-            vertices.insert(vertices.end(), {mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y});
-        } else 
+            DrawRanges& ranges = visibleRanges[v][i];
+            ranges.counts.clear();
+            ranges.offsets.clear();
+            ranges.visibleClusters = 0;
+
+            ranges.visible = views[v].IsSphereVisible(meshCenter, meshRadius);
+            ranges.wholeMesh = ranges.visible && clusters.empty();
+            anyVisible = anyVisible || ranges.visible;
+        }
+
+        if (!anyVisible || clusters.empty()) return;
+
+        for (const MeshCluster& cluster : clusters)
         {
-            vertices.insert(vertices.end(), {0.0f, 0.0f});    
+            glm::vec3 center = glm::vec3(model * glm::vec4(cluster.center, 1.0f));
+            float radius = cluster.radius * scale;
+            glm::vec3 axis = glm::normalize(normalMatrix * cluster.coneAxis);
+
+            for (size_t v = 0; v < views.size(); v++)
+            {
+                DrawRanges& ranges = visibleRanges[v][i];
+
+                if (!ranges.visible || !views[v].IsSphereVisible(center, radius) ||
+                    !views[v].IsConeVisible(center, radius, axis, cluster.coneCutoff)) continue;
+
+                ranges.visibleClusters++;
+
+                // Clusters are stored in order, so neighbours that both pass are one draw
+                uintptr_t offset = (uintptr_t)cluster.indexOffset * indexSize;
+
+                if (!ranges.counts.empty() && (uintptr_t)ranges.offsets.back() + ranges.counts.back() * indexSize == offset)
+                {
+                    ranges.counts.back() += cluster.indexCount;
+                }
+                else
+                {
+                    ranges.counts.push_back(cluster.indexCount);
+                    ranges.offsets.push_back((const void*)offset);
+                }
+            }
         }
+    });
+}
+
+uint32_t Model::GetClusterCount()
+{
+    uint32_t clusterCount = 0;
+    for (const vector<MeshCluster>& clusters : meshClusters) clusterCount += (uint32_t)clusters.size();
+
+    return clusterCount;
+}
+
+uint32_t Model::GetVisibleClusterCount(uint32_t cullView)
+{
+    if (cullView >= visibleRanges.size()) return GetClusterCount();
+
+    uint32_t clusterCount = 0;
+    for (const DrawRanges& ranges : visibleRanges[cullView]) clusterCount += ranges.visibleClusters;
+
+    return clusterCount;
+}
+
+bool Model::IsMeshVisible(uint32_t meshIndex, int32_t cullView)
+{
+    // Not culled for that view (yet), everything draws
+    if (cullView < 0 || (size_t)cullView >= visibleRanges.size() || meshIndex >= visibleRanges[cullView].size()) return true;
+
+    const DrawRanges& ranges = visibleRanges[cullView][meshIndex];
+    return ranges.wholeMesh || !ranges.counts.empty();
+}
+
+void Model::DrawMesh(uint32_t meshIndex, int32_t cullView)
+{
+    if (cullView < 0 || (size_t)cullView >= visibleRanges.size() || meshIndex >= visibleRanges[cullView].size() ||
+        visibleRanges[cullView][meshIndex].wholeMesh)
+    {
+        meshList[meshIndex]->RenderMesh();
+        return;
+    }
 
-        // Gets the Normals
-        // Minus because they are not negative in the FRAG SHADER as normaly are
-        vertices.insert(vertices.end(), {-mesh->mNormals[i].x, -mesh->mNormals[i].y, -mesh->mNormals[i].z});
+    const DrawRanges& ranges = visibleRanges[cullView][meshIndex];
+    meshList[meshIndex]->RenderRanges(ranges.counts.data(), ranges.offsets.data(), (GLsizei)ranges.counts.size());
+}
+
+bool Model::ImportAssimp(const string& fileName, const string& objName, ModelData& modelData)
+{
+    // One importer per import, Assimp is fine with that on different threads
+    Assimp::Importer importer;
+    const aiScene *scene = importer.ReadFile(fileName, MODEL_IMPORT_FLAGS);
+    // const aiScene *scene = importer.ReadFile(fileName, aiProcess_Triangulate );
+
+    if( !scene )
+    {
+        cerr << "\n\nERROR: Failed to load ASSIMP Scene at " << fileName << ". " << importer.GetErrorString() << ".\n" << endl;
+        return false;
     }
 
-    // Getting the indices
-    for( size_t i = 0; i < mesh->mNumFaces; i++ )
+    vector<aiMesh*> sceneMeshes;
+    LoadNode(scene->mRootNode, scene, sceneMeshes);
+
+    // The meshes don't depend on each other, so they are converted on every core
+    modelData.meshes.resize(sceneMeshes.size());
+
+    JobSystem::ParallelFor(sceneMeshes.size(), [&](size_t i)
+    {
+        LoadMesh(sceneMeshes[i], modelData.meshes[i]);
+    });
+
+    ImportMaterials(scene, objName, modelData);
+
+    return true;
+}
+
+bool Model::ImportGltf(const string& fileName, const string& objName, ModelData& modelData)
+{
+    GltfImporter gltf;
+    if (!gltf.Open(fileName)) return false;
+
+    cerr << "glTF: " << fileName << " (" << gltf.GetMeshCount() << " meshes)" << endl;
+
+    modelData.meshes.resize(gltf.GetMeshCount());
+    std::atomic<bool> failed(false);
+
+    // Straight from the mapped buffers, each mesh on its own core like the Assimp path
+    JobSystem::ParallelFor(gltf.GetMeshCount(), [&](size_t i)
     {
-        aiFace face = mesh->mFaces[i];
-        for( size_t j = 0; j < face.mNumIndices; j++ )
+        MeshData& meshData = modelData.meshes[i];
+        vector<uint32_t> indices;
+        glm::vec3 boundsMin, boundsMax;
+
+        if (!gltf.ConvertMesh(i, meshData.vertices, indices, boundsMin, boundsMax))
         {
-            indices.push_back(face.mIndices[j]);
+            failed = true;
+            return;
         }
+
+        meshData.materialIndex = gltf.GetMaterialIndex(i);
+        BuildMesh(gltf.GetMeshName(i), indices, boundsMin, boundsMax, meshData);
+    });
+
+    if (failed)
+    {
+        modelData = ModelData();
+        return false;
+    }
+
+    gltf.GetMaterials(objName, modelData.materials);
+
+    return true;
+}
+
+void Model::LoadNode(aiNode* node, const aiScene* scene, vector<aiMesh*>& sceneMeshes)
+{
+    for( size_t i = 0; i < node->mNumMeshes; i++ )
+    {
+        sceneMeshes.push_back(scene->mMeshes[node->mMeshes[i]]);
+    }
+
+    for( size_t i = 0; i < node->mNumChildren; i++ )
+    {
+        LoadNode(node->mChildren[i], scene, sceneMeshes);
+    }
+}
+
+void Model::LoadMesh(const aiMesh* mesh, MeshData& meshData)
+{
+    vector<GLfloat>& vertices = meshData.vertices;
+
+    // Full width while the optimizer works on them, narrowed at the end
+    vector<uint32_t> indices;
+
+    // Written once in their final layout, this array is what the cache and the GL buffer get
+    vertices.resize((size_t)mesh->mNumVertices * VertexConverter::VERTEX_FLOATS);
+
+    glm::vec3 boundsMin, boundsMax;
+    VertexConverter::ConvertVertices(mesh, vertices.data(), boundsMin, boundsMax);
+
+    VertexConverter::ConvertIndices(mesh, indices);
+
+    meshData.materialIndex = mesh->mMaterialIndex;
+    BuildMesh(mesh->mName.C_Str(), indices, boundsMin, boundsMax, meshData);
+}
+
+void Model::BuildMesh(const string& name, vector<uint32_t>& indices, const glm::vec3& boundsMin, const glm::vec3& boundsMax, MeshData& meshData)
+{
+    vector<GLfloat>& vertices = meshData.vertices;
+    size_t vertexCount = vertices.size() / 8;
+
+    // Triangle order for the post-transform cache and overdraw, vertex order for the fetch
+    if ((MESH_OPTIMIZE || MESH_CLUSTER_TRIANGLES > 0) && indices.size() % 3 == 0)
+    {
+        VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(indices, vertexCount, MESH_VERTEX_CACHE_SIZE);
+
+        if (MESH_OPTIMIZE) MeshOptimizer::Optimize(vertices, indices, 8);
+
+        // Regrouped after, the clusters keep the cache order inside them
+        MeshOptimizer::BuildClusters(vertices, 8, indices, MESH_CLUSTER_TRIANGLES, meshData.clusters);
+
+        VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size() / 8, MESH_VERTEX_CACHE_SIZE);
+
+        // One write per line, the meshes are converted on several threads
+        std::ostringstream report;
+        report.precision(3);
+        report << "\tMesh " << name << ": " << indices.size() / 3 << " triangles in " << meshData.clusters.size() << " clusters, "
+               << (Mesh::ChooseIndexSize(vertices.size() / 8) == sizeof(uint16_t) ? "16" : "32") << " bit indices, ACMR "
+               << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << "\n";
+        cerr << report.str();
     }
 
+    MeshCache::SetIndices(meshData, indices);
+
+    meshData.boundsCenter = vertexCount ? (boundsMin + boundsMax) * 0.5f : glm::vec3(0.0f);
+    meshData.boundsRadius = vertexCount ? glm::length(boundsMax - boundsMin) * 0.5f : 0.0f;
+}
+
+void Model::CreateMesh(const MeshView& mesh)
+{
     Mesh* newMesh = new Mesh();
-    newMesh->CreateMesh( &vertices[0], &indices[0], vertices.size(), indices.size() );
+    newMesh->CreateMesh(mesh.vertices, mesh.indices, mesh.vertexFloatCount, mesh.indexCount, mesh.indexSize);
     meshList.push_back(newMesh);
-    meshToTex.push_back(mesh->mMaterialIndex);
+    meshToTex.push_back(mesh.materialIndex);
+
+    MeshBounds bounds;
+    bounds.center = mesh.boundsCenter;
+    bounds.radius = mesh.boundsRadius;
+    meshBounds.push_back(bounds);
+
+    meshClusters.emplace_back(mesh.clusters, mesh.clusters + mesh.clusterCount);
 }
 
+void Model::ImportMaterials(const aiScene* scene, const string& objName, ModelData& modelData)
+{
+    modelData.materials.resize(scene->mNumMaterials);
+
+    for (size_t i = 0; i < scene->mNumMaterials; i++)
+    {
+        aiMaterial* material = scene->mMaterials[i];
+        MaterialData& materialData = modelData.materials[i];
+
+        materialData.albedo = GetTexturePath(material, aiTextureType_DIFFUSE, objName);
+        materialData.normal = GetTexturePath(material, aiTextureType_NORMALS, objName);
 
+        materialData.maps.occlusion = GetTexturePath(material, aiTextureType_AMBIENT_OCCLUSION, objName);
+        materialData.maps.roughness = GetTexturePath(material, aiTextureType_DIFFUSE_ROUGHNESS, objName);
+        materialData.maps.metalness = GetTexturePath(material, aiTextureType_METALNESS, objName);
+        materialData.maps.height = GetTexturePath(material, aiTextureType_DISPLACEMENT, objName);
 
-void Model::LoadMaterials(const aiScene* scene, const string &objName, bool invertedTexture)
+        // OBJ files only have map_Ka for the occlusion
+        if (materialData.maps.occlusion.empty()) materialData.maps.occlusion = GetTexturePath(material, aiTextureType_LIGHTMAP, objName);
+    }
+}
+
+void Model::LoadMaterials(const vector<MaterialData>& materials, const vector<string>& packedMaps, bool invertedTexture)
 {
     cerr << "----------------------------------" << endl;
 
     //textureList.resize(scene->mNumMaterials);
     //textureList.resize(aiTextureType_UNKNOWN);
 
-    textureList.resize(scene->mNumMaterials);
-    normalList.resize(scene->mNumMaterials);
+    size_t materialCount = materials.size();
 
-    for (size_t i = 0; i < scene->mNumMaterials; i++)
+    textureList.resize(materialCount);
+    normalList.resize(materialCount);
+    materialList.resize(materialCount);
+    virtualTextures.assign(materialCount, -1);
+
+    plainAlbedoMap = TextureRegistry::LoadSolid(255, 255, 255, 255);
+
+    // Pointing straight up, (0.5, 0.5) in the two channels the shader reads
+    flatNormalMap = TextureRegistry::LoadSolid(128, 128, 255, 255);
+
+    // White occlusion, no roughness, no metal, so the shading stays as it was
+    neutralMaterialMap = TextureRegistry::LoadSolid(255, 0, 0, 0);
+
+    for (size_t i = 0; i < materialCount; i++)
     {
-        aiMaterial *material = scene->mMaterials[i];
+        const MaterialData& material = materials[i];
 
         textureList[i] = nullptr;
         normalList[i] = nullptr;
+        materialList[i] = nullptr;
 
-        if (material->GetTextureCount(aiTextureType_DIFFUSE))
+        if (!material.albedo.empty())
         {
-            aiString path;
-            if (material->GetTexture(aiTextureType_DIFFUSE, 0, &path) == AI_SUCCESS)
-            {
-                // Fixes the path if it is relative
-                int32_t idx = string(path.data).rfind("\\");
-                string fileName = string(path.data).substr(idx + 1);
+            const string& texPath = material.albedo;
+            string fileName = texPath.substr(texPath.rfind("/") + 1);
 
-                string texPath = string("Assets/Models/Textures/") + objName + string("/") + fileName;
+            // Gettin the file extension
+            int32_t extIndex = string(fileName).rfind(".");
+            string fileExtension = string(fileName).substr(extIndex + 1);
 
-                // Gettin the file extension
-                int32_t extIndex = string(fileName).rfind(".");
-                string fileExtension = string(fileName).substr(extIndex + 1);
+            cerr << "Loading DIFFUSE " << fileExtension << " texture: " << fileName << " [" << i << " of " << materialCount - 1 << "]..." << endl;
 
-                textureList[i] = new Texture(texPath.c_str());
-                // Texture *newTexture = new Texture(texPath.c_str());
-                // textureList.push_back(newTexture);
+            // Materials sharing a file share the texture
+            uint32_t flags = (invertedTexture ? TEXTURE_FLIP_VERTICAL : 0) | (TextureStreamer::IsRunning() ? TEXTURE_STREAMED : 0);
 
-                cerr << "Loading DIFFUSE " << fileExtension << " texture: " << fileName << " [" << i << " of " << scene->mNumMaterials - 1 << "]..." << endl;
-
-                albedoMap = textureList[i]->LoadTextureID(invertedTexture);
-                // albedoMap = newTexture->LoadTextureID(invertedTexture);
+            // Virtual textures only bring in the pages on screen, for big material sets
+            if (VirtualTexture::IsRunning())
+            {
+                virtualTextures[i] = VirtualTexture::AddTexture(texPath, flags);
+            }
 
-                if (albedoMap == -1)
-                {
-                    cerr << "\n\nERROR: Failed to load DIFFUSE Texture " << fileName << ".\n"
-                         << endl;
-                    delete textureList[i];
-                    textureList[i] = nullptr;
-                } 
+            if (virtualTextures[i] < 0)
+            {
+                textureList[i] = TextureRegistry::Load(texPath, flags);
+            }
 
+            if (textureList[i])
+            {
+                albedoMap = textureList[i]->GetTextureID();
             }
+            else if (virtualTextures[i] < 0)
+            {
+                cerr << "\n\nERROR: Failed to load DIFFUSE Texture " << fileName << ".\n"
+                     << endl;
+            } 
         }
 
-        if (material->GetTextureCount(aiTextureType_NORMALS)) // NORMAL
+        if (!material.normal.empty()) // NORMAL
         {
-            aiString path;
-            if (material->GetTexture(aiTextureType_NORMALS, 0, &path) == AI_SUCCESS)
-            {
-                // Fixes the path if it is relative
-                int32_t idx = string(path.data).rfind("\\");
-                string fileName = string(path.data).substr(idx + 1);
+            const string& texPath = material.normal;
+            string fileName = texPath.substr(texPath.rfind("/") + 1);
 
-                string texPath = string("Assets/Models/Textures/") + objName + string("/") + fileName;
+            // Gettin the file extension
+            int32_t extIndex = string(fileName).rfind(".");
+            string fileExtension = string(fileName).substr(extIndex + 1);
 
-                // Gettin the file extension
-                int32_t extIndex = string(fileName).rfind(".");
-                string fileExtension = string(fileName).substr(extIndex + 1);
+            cerr << "Loading HEIGHT(NORMAL) " << fileExtension << " texture: " << fileName << " [" << aiTextureType_NORMALS << " of " << materialCount - 1 << "]..." << endl;
+
+            uint32_t flags = TEXTURE_NORMAL_MAP | (invertedTexture ? TEXTURE_FLIP_VERTICAL : 0) | (TextureStreamer::IsRunning() ? TEXTURE_STREAMED : 0);
+            normalList[i] = TextureRegistry::Load(texPath, flags);
+
+            if (normalList[i])
+            {
+                normalMap = normalList[i]->GetTextureID();
+            }
+            else
+            {
+                cerr << "\n\nERROR: Failed to load NORMAL Texture " << fileName << ".\n"
+                     << endl;
+            } 
+        }     
 
-                normalList[i] = new Texture(texPath.c_str());
-                // Texture *newTexture = new Texture(texPath.c_str());
-                // normalList.push_back(newTexture);
+        // Occlusion, roughness, metalness and height in one texture, one fetch in the shader
+        const string& packedPath = packedMaps[i];
 
-                cerr << "Loading HEIGHT(NORMAL) " << fileExtension << " texture: " << fileName << " [" << aiTextureType_NORMALS << " of " << scene->mNumMaterials - 1 << "]..." << endl;
+        if (!packedPath.empty())
+        {
+            cerr << "Loading MATERIAL texture: " << packedPath << " [" << i << " of " << materialCount - 1 << "]..." << endl;
 
-                normalMap = normalList[i]->LoadTextureID(invertedTexture);
-                // normalMap = newTexture->LoadTextureID(invertedTexture);
+            uint32_t flags = (invertedTexture ? TEXTURE_FLIP_VERTICAL : 0) | (TextureStreamer::IsRunning() ? TEXTURE_STREAMED : 0);
+            materialList[i] = TextureRegistry::Load(packedPath, flags);
 
-                if (normalMap == -1)
-                {
-                    cerr << "\n\nERROR: Failed to load NORMAL Texture " << fileName << ".\n"
-                         << endl;
-                    delete normalList[aiTextureType_NORMALS];
-                    normalList[aiTextureType_NORMALS] = nullptr;
-                } 
+            if (!materialList[i])
+            {
+                cerr << "\n\nERROR: Failed to load MATERIAL Texture " << packedPath << ".\n"
+                     << endl;
             }
-        }     
+        }
+
+        if (materialList[i])
+        {
+            AOMap = roughnessMap = metallicMap = materialList[i]->GetTextureID();
+        }
+        else
+        {
+            materialList[i] = neutralMaterialMap;
+        }
 
         // Sets the texture to a plain white if not found
         // if (!textureList[i])
@@ -236,6 +827,8 @@ void Model::LoadMaterials(const aiScene* scene, const string &objName, bool inve
         // }
     }
 
+    cerr << "Texture registry: " << TextureRegistry::GetLiveCount() << " textures loaded." << endl;
+
     // cerr << "\tAlbedo map loc: " << albedoMap << endl
     //      << "\tNormal map loc: " << normalMap << endl
     //      << "\tMetaless map loc: " << metallicMap << endl
@@ -244,6 +837,18 @@ void Model::LoadMaterials(const aiScene* scene, const string &objName, bool inve
          
 }
 
+string Model::GetTexturePath(aiMaterial* material, aiTextureType type, const string& objName)
+{
+    aiString path;
+    if (material->GetTextureCount(type) == 0 || material->GetTexture(type, 0, &path) != AI_SUCCESS) return "";
+
+    // Fixes the path if it is relative
+    int32_t idx = string(path.data).rfind("\\");
+    string fileName = string(path.data).substr(idx + 1);
+
+    return string("Assets/Models/Textures/") + objName + string("/") + fileName;
+}
+
 Model::~Model()
 {
 }
\ No newline at end of file
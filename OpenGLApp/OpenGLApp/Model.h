@@ -4,6 +4,8 @@
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <algorithm>
+#include <memory>
 
 #include <assimp\Importer.hpp>
 #include <assimp\scene.h>
@@ -11,6 +13,18 @@
 
 #include "Mesh.h"
 #include "Texture.h"
+#include "TextureArray.h"
+#include "TextureRegistry.h"
+#include "TextureStreamer.h"
+#include "VirtualTexture.h"
+#include "MaterialPacker.h"
+#include "MeshCache.h"
+#include "JobSystem.h"
+#include "MeshOptimizer.h"
+#include "PerDrawBuffer.h"
+#include "CullView.h"
+#include "VertexConverter.h"
+#include "GltfImporter.h"
 
 using std::cerr;
 using std::cout;
@@ -27,24 +41,141 @@ public:
 
     void LoadModel(const string& fileName, const string& objName, bool invertedTexture);
     void LoadModel(const string &fileName, const string &objName);
-    void RenderModel();
+
+    // Reads the mesh cache or runs Assimp, converts the meshes and packs the material maps. No GL, fine on a job thread
+    bool ImportModel(const string& fileName, const string& objName, bool invertedTexture);
+
+    // Requests the textures of the last import and makes the GL buffers of up to maxMeshes meshes,
+    // returns how many it made. Call again until HasPendingImport is false. GL thread
+    uint32_t FinishLoading(uint32_t maxMeshes = UINT32_MAX);
+    bool HasPendingImport() { return pendingImport != nullptr; }
+
+    // cullView is an index into the views of the last CullClusters, -1 draws every mesh whole
+    void RenderModel(int32_t cullView = -1);
     void ClearModel();
 
+    bool HasNormalMaps() { return normalMap != -1; }
+
+    // Copies the textures into arrays grouped by size and format. Call once they are all loaded
+    void BuildTextureArrays();
+    bool UsesTextureArrays() { return !textureArrays.empty(); }
+    bool UsesVirtualTextures() { return std::any_of(virtualTextures.begin(), virtualTextures.end(), [](int32_t id) { return id >= 0; }); }
+
+    // One per-draw entry per material with its layers and virtual region, every frame. Does nothing without either
+    void AddDraws(PerDrawBuffer& perDrawBuffer, const glm::mat4& model, const glm::mat4& viewProjection);
+
+    // Asks the texture streamer for the mip levels each mesh needs at its size on screen
+    void UpdateStreaming(const glm::mat4& model, const glm::vec3& cameraPosition, float fovY, int32_t screenHeight);
+
+    // Keeps the clusters each view sees, for the RenderModel calls of this frame. Spread over the job threads
+    void CullClusters(const glm::mat4& model, const vector<CullView>& views);
+
+    uint32_t GetClusterCount();
+    uint32_t GetVisibleClusterCount(uint32_t cullView);
+
     ~Model();
 
     int32_t albedoMap, normalMap, metallicMap, roughnessMap, AOMap;
 
 private:
 
-    void LoadNode(aiNode* node, const aiScene* scene);
-    void LoadMesh(aiMesh* mesh, const aiScene* scene);
-    void LoadMaterials(const aiScene* scene, const string &objName, bool invertedTexture);
+    // Assimp import, the result is what goes into the mesh cache
+    bool ImportAssimp(const string& fileName, const string& objName, ModelData& modelData);
+    void LoadNode(aiNode* node, const aiScene* scene, vector<aiMesh*>& sceneMeshes);
+    void LoadMesh(const aiMesh* mesh, MeshData& meshData);
+    void ImportMaterials(const aiScene* scene, const string& objName, ModelData& modelData);
+
+    // glTF files read without Assimp (GltfImporter), false leaves modelData empty for the Assimp path
+    bool ImportGltf(const string& fileName, const string& objName, ModelData& modelData);
+
+    // Optimization, clusters and narrowed indices of converted vertices, whichever importer made them
+    void BuildMesh(const string& name, vector<uint32_t>& indices, const glm::vec3& boundsMin, const glm::vec3& boundsMax, MeshData& meshData);
+
+    void CreateMesh(const MeshView& mesh);
+    void LoadMaterials(const vector<MaterialData>& materials, const vector<string>& packedMaps, bool invertedTexture);
+
+    // What ImportModel leaves for FinishLoading
+    struct ModelImport
+    {
+        CachedModel cachedModel;            // When the cache had the model
+        ModelData modelData;                // When Assimp imported it
+        vector<MeshView> meshes;
+        const vector<MaterialData>* materials;
+        vector<string> packedMaps;          // MaterialPacker output of each material
+        bool invertedTexture;
+
+        // FinishLoading progress
+        bool materialsLoaded;
+        size_t nextMesh;
+    };
+
+    // Shared, so models can still be copied around
+    std::shared_ptr<ModelImport> pendingImport;
     void LoadTextureOfType(aiMaterial *material, aiTextureType type, const string &objName, bool invertedTexture);
+
+    // Where the first texture of that type is, empty if the material doesn't have one
+    string GetTexturePath(aiMaterial* material, aiTextureType type, const string& objName);
     MaterialTextureMap materialTexturesMap;
 
+    // Array and layer of each material, -1 if it has no texture of that kind
+    struct MaterialLayers
+    {
+        int32_t albedoArray, albedoLayer;
+        int32_t normalArray, normalLayer;
+        int32_t materialArray, materialLayer;
+    };
+
+    enum TextureSlot
+    {
+        SLOT_ALBEDO,
+        SLOT_NORMAL,
+        SLOT_MATERIAL
+    };
+
+    void GroupIntoArrays(const vector<TextureHandle>& textures, TextureSlot slot);
+    bool UsesMaterialDraws() { return UsesTextureArrays() || UsesVirtualTextures(); }
+    void RenderMaterialDraws(int32_t cullView);
+
+    vector<TextureArray*>   textureArrays;
+    vector<int32_t>         virtualTextures;    // Albedo of each material in VirtualTexture, -1 when it's a regular texture
+    vector<MaterialLayers>  materialLayers;
+    vector<uint32_t>        materialDraws;
+    vector<uint32_t>        drawOrder;      // Mesh indices sorted so the arrays change as little as possible
+    PerDrawBuffer*          drawBuffer;
+
+    // Bounding sphere of each mesh in model space, for the streaming estimate
+    struct MeshBounds
+    {
+        glm::vec3 center;
+        float radius;
+    };
+
+    vector<MeshBounds>  meshBounds;
+
+    // Index ranges of one mesh a view sees, neighbouring clusters merged into one range
+    struct DrawRanges
+    {
+        vector<GLsizei> counts;
+        vector<const void*> offsets;    // In bytes
+        uint32_t visibleClusters;
+        bool visible;                   // The mesh's sphere passed
+        bool wholeMesh;                 // Visible and without clusters
+    };
+
+    vector<vector<MeshCluster>> meshClusters;
+    vector<vector<DrawRanges>>  visibleRanges;  // [view][mesh] of the last CullClusters
+
+    bool IsMeshVisible(uint32_t meshIndex, int32_t cullView);
+    void DrawMesh(uint32_t meshIndex, int32_t cullView);
+
     vector<Mesh*>       meshList;
-    vector<Texture*>    textureList;
-    vector<Texture*>    normalList;
+    vector<TextureHandle> textureList;
+    vector<TextureHandle> normalList;
+    vector<TextureHandle> materialList;     // Occlusion, roughness, metalness and height packed by MaterialPacker
+
+    // Bound for a material without that texture, or the one of the last material would show through.
+    // Virtual albedos are only on the per-draw path, the per-mesh one draws them white while the model loads
+    TextureHandle       plainAlbedoMap, flatNormalMap, neutralMaterialMap;
     vector<GLuint>      texType;        // Type of texture for PBR
     vector<uint32_t>    meshToTex;
 };
@@ -0,0 +1,167 @@
+#include "ModelLoader.h"
+
+std::mutex ModelLoader::requestMutex;
+vector<ModelLoader::ModelRequest> ModelLoader::requests;
+JobGroup* ModelLoader::importJobs = nullptr;
+std::chrono::steady_clock::time_point ModelLoader::startTime;
+bool ModelLoader::reportedDone = false;
+
+void ModelLoader::Request(Model* model, const string& fileName, const string& objName, bool invertedTexture)
+{
+    size_t requestIndex = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+
+        if (requests.empty()) startTime = std::chrono::steady_clock::now();
+
+        ModelRequest request = { model, objName, false, false, false, false };
+        requestIndex = requests.size();
+        requests.push_back(request);
+        reportedDone = false;
+    }
+
+    cerr << "\nLoading model [" << objName << "] in the background..." << endl;
+
+    auto import = [=]
+    {
+        bool imported = model->ImportModel(fileName, objName, invertedTexture);
+
+        // The lock also hands the import over to the GL thread
+        std::lock_guard<std::mutex> lock(requestMutex);
+        requests[requestIndex].imported = true;
+        requests[requestIndex].failed = !imported;
+    };
+
+    // Without workers a queued job would only run at Shutdown
+    if (!JobSystem::IsRunning())
+    {
+        import();
+        return;
+    }
+
+    // Allocated, the group has to outlive every job but not the job system's statics
+    if (!importJobs) importJobs = new JobGroup();
+
+    importJobs->Run(import);
+}
+
+double ModelLoader::GetElapsedSeconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void ModelLoader::Update(uint32_t maxMeshes)
+{
+    std::unique_lock<std::mutex> lock(requestMutex);
+
+    for (ModelRequest& request : requests)
+    {
+        if (!request.imported || request.ready) continue;
+
+        // The model isn't touched by its job anymore, the lock isn't needed for the GL work
+        lock.unlock();
+
+        if (request.failed)
+        {
+            request.ready = true;
+        }
+        else if (!request.uploaded)
+        {
+            maxMeshes -= request.model->FinishLoading(maxMeshes);
+            request.uploaded = !request.model->HasPendingImport();
+        }
+        else if (TextureLoader::GetPendingCount() == 0)
+        {
+            // The arrays copy from the uploaded textures, so everything has to be in first
+            request.model->BuildTextureArrays();
+            request.ready = true;
+
+            cerr << "Model [" << request.objName << "] ready after " << GetElapsedSeconds() << " s" << endl;
+        }
+
+        lock.lock();
+
+        if (maxMeshes == 0) break;
+    }
+
+    if (!reportedDone && !requests.empty())
+    {
+        bool done = true;
+        for (const ModelRequest& request : requests) done = done && request.ready;
+
+        if (done)
+        {
+            reportedDone = true;
+            cerr << "\nLoading complete in " << GetElapsedSeconds() << " s\n" << endl;
+        }
+    }
+}
+
+LoadingProgress ModelLoader::GetProgress()
+{
+    LoadingProgress progress = {};
+
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+
+        progress.modelCount = (uint32_t)requests.size();
+
+        for (const ModelRequest& request : requests)
+        {
+            if (request.imported) progress.importedCount++;
+            if (request.ready) progress.readyCount++;
+            if (request.failed) progress.failedCount++;
+        }
+    }
+
+    progress.pendingTextures = TextureLoader::GetPendingCount();
+
+    // Imports take most of the time, uploads and arrays the rest
+    float modelSteps = (float)(progress.importedCount + progress.readyCount);
+    float totalSteps = (float)progress.modelCount * 2.0f;
+
+    progress.fraction = totalSteps > 0.0f ? modelSteps / totalSteps : 1.0f;
+    if (progress.pendingTextures > 0) progress.fraction = glm::min(progress.fraction, 0.99f);
+
+    return progress;
+}
+
+string ModelLoader::GetStatus()
+{
+    LoadingProgress progress = GetProgress();
+
+    if (progress.readyCount == progress.modelCount && progress.pendingTextures == 0) return "";
+
+    string status = "Loading " + std::to_string((int32_t)(progress.fraction * 100.0f)) + "% (" +
+                    std::to_string(progress.readyCount) + "/" + std::to_string(progress.modelCount) + " models";
+
+    if (progress.pendingTextures > 0) status += ", " + std::to_string(progress.pendingTextures) + " textures";
+
+    return status + ")";
+}
+
+bool ModelLoader::IsDone()
+{
+    std::lock_guard<std::mutex> lock(requestMutex);
+
+    for (const ModelRequest& request : requests)
+    {
+        if (!request.ready) return false;
+    }
+
+    return true;
+}
+
+void ModelLoader::Shutdown()
+{
+    if (importJobs)
+    {
+        importJobs->Wait();
+        delete importJobs;
+        importJobs = nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(requestMutex);
+    requests.clear();
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+
+#include "Config.h"
+#include "Model.h"
+#include "JobSystem.h"
+#include "TextureLoader.h"
+
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+
+struct LoadingProgress
+{
+    uint32_t modelCount;
+    uint32_t importedCount;         // Off the job threads, uploading or done
+    uint32_t readyCount;            // Every mesh uploaded and the texture arrays built
+    uint32_t failedCount;
+    size_t pendingTextures;         // Still in TextureLoader
+    float fraction;                 // All of the above from 0 to 1
+};
+
+/*
+    Background model loading, so the render loop starts right away.
+
+    Request() imports the model on a job (mesh cache, GltfImporter or Assimp, the
+    optimization and the material packing all run there) and Update()
+    picks up the finished imports on the GL thread, a few meshes a frame.
+    Models draw whatever is uploaded so far with the texture loader's
+    placeholders, and build their texture arrays once the textures are in.
+*/
+class ModelLoader
+{
+public:
+
+    // The model has to stay where it is until it's ready or Shutdown returns
+    static void Request(Model* model, const string& fileName, const string& objName, bool invertedTexture);
+
+    // Uploads up to maxMeshes meshes of the imported models. Once per frame, GL thread
+    static void Update(uint32_t maxMeshes);
+
+    static LoadingProgress GetProgress();
+
+    // One line for the window title, empty once everything is loaded
+    static string GetStatus();
+
+    static bool IsDone();
+
+    // Waits for the imports still running. Before JobSystem::Shutdown and before the models go away
+    static void Shutdown();
+
+private:
+
+    struct ModelRequest
+    {
+        Model* model;
+        string objName;
+        bool imported;              // Set by the import job, guarded by requestMutex
+        bool failed;
+        bool uploaded;              // Only touched on the GL thread
+        bool ready;
+    };
+
+    static std::mutex requestMutex;
+    static vector<ModelRequest> requests;
+    static JobGroup* importJobs;
+    static std::chrono::steady_clock::time_point startTime;
+    static bool reportedDone;
+
+    // Since the first request
+    static double GetElapsedSeconds();
+};
@@ -0,0 +1,196 @@
+#include "PerDrawBuffer.h"
+
+#include <string.h>
+
+PerDrawBuffer::PerDrawBuffer()
+{
+    UBO = 0;
+    maxDrawCount = 0;
+    drawCount = 0;
+    overflowReported = false;
+    drawStride = 0;
+    sliceSize = 0;
+    frameSlice = 0;
+    persistent = false;
+    mappedData = nullptr;
+
+    for (size_t i = 0; i < PER_DRAW_FRAMES; i++)
+    {
+        sliceFences[i] = 0;
+    }
+}
+
+bool PerDrawBuffer::Init(uint32_t maxDraws)
+{
+    maxDrawCount = maxDraws;
+
+    // Every draw starts at an offset the driver accepts for glBindBufferRange
+    GLint offsetAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+
+    drawStride = ((sizeof(PerDrawData) + offsetAlignment - 1) / offsetAlignment) * offsetAlignment;
+    sliceSize = drawStride * maxDrawCount;
+
+    glGenBuffers(1, &UBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+
+    persistent = GLEW_ARB_buffer_storage ? true : false;
+
+    if (persistent)
+    {
+        // One slice per frame in flight, mapped for the whole life of the buffer
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, sliceSize * PER_DRAW_FRAMES, nullptr, flags);
+        mappedData = (uint8_t*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, sliceSize * PER_DRAW_FRAMES, flags);
+
+        if (!mappedData)
+        {
+            cerr << "\n\nERROR: Failed to map the per-draw buffer, falling back to orphaning.\n" << endl;
+
+            // Immutable storage can't be respecified, so start over with a new buffer
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            glDeleteBuffers(1, &UBO);
+            glGenBuffers(1, &UBO);
+            glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+            persistent = false;
+        }
+    }
+
+    if (!persistent)
+    {
+        // A single slice, the driver renames the storage each time it gets orphaned
+        glBufferData(GL_UNIFORM_BUFFER, sliceSize, nullptr, GL_STREAM_DRAW);
+        stagingData.resize(sliceSize);
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    cerr << "Per-draw buffer: " << maxDrawCount << " draws x " << drawStride << " bytes ("
+         << (persistent ? "persistent mapping" : "orphaning") << ")" << endl;
+
+    return true;
+}
+
+uint8_t* PerDrawBuffer::GetSliceData()
+{
+    if (persistent)
+    {
+        return mappedData + sliceSize * frameSlice;
+    }
+
+    return stagingData.data();
+}
+
+void PerDrawBuffer::BeginFrame()
+{
+    drawCount = 0;
+
+    if (!persistent) return;
+
+    frameSlice = (frameSlice + 1) % PER_DRAW_FRAMES;
+
+    // The GPU may still be reading this slice from a few frames ago
+    if (sliceFences[frameSlice])
+    {
+        GLenum result = glClientWaitSync(sliceFences[frameSlice], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+
+        if (result == GL_WAIT_FAILED)
+        {
+            cerr << "\n\nERROR: Failed to wait for the per-draw buffer fence.\n" << endl;
+        }
+
+        glDeleteSync(sliceFences[frameSlice]);
+        sliceFences[frameSlice] = 0;
+    }
+}
+
+uint32_t PerDrawBuffer::AddDraw(const glm::mat4& model, const glm::mat4& viewProjection, const glm::ivec4& textureLayers,
+                                const glm::vec4& virtualRegion)
+{
+    if (drawCount >= maxDrawCount)
+    {
+        // Once, it would happen every frame after
+        if (!overflowReported)
+        {
+            cerr << "\n\nERROR: Too many draws for the per-draw buffer (" << maxDrawCount << "), the rest are skipped. Raise MAX_DRAWS_PER_FRAME.\n" << endl;
+            overflowReported = true;
+        }
+
+        return PER_DRAW_NONE;
+    }
+
+    PerDrawData data;
+    data.model = model;
+    data.normalMatrix = glm::mat4(glm::mat3(glm::transpose(glm::inverse(model))));
+    data.mvp = viewProjection * model;
+    data.textureLayers = textureLayers;
+    data.virtualRegion = virtualRegion;
+
+    memcpy(GetSliceData() + drawStride * drawCount, &data, sizeof(PerDrawData));
+
+    return drawCount++;
+}
+
+void PerDrawBuffer::Upload()
+{
+    // The persistent mapping is coherent, nothing to do
+    if (persistent || drawCount == 0) return;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+
+    // Orphans the old storage so we don't wait for draws still using it
+    glBufferData(GL_UNIFORM_BUFFER, sliceSize, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, drawStride * drawCount, stagingData.data());
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+bool PerDrawBuffer::BindDraw(uint32_t drawIndex)
+{
+    if (drawIndex >= drawCount) return false;
+
+    GLintptr offset = (persistent ? sliceSize * frameSlice : 0) + drawStride * drawIndex;
+    glBindBufferRange(GL_UNIFORM_BUFFER, PER_DRAW_BINDING, UBO, offset, sizeof(PerDrawData));
+    return true;
+}
+
+void PerDrawBuffer::EndFrame()
+{
+    if (!persistent) return;
+
+    sliceFences[frameSlice] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void PerDrawBuffer::ClearBuffer()
+{
+    for (size_t i = 0; i < PER_DRAW_FRAMES; i++)
+    {
+        if (sliceFences[i])
+        {
+            glDeleteSync(sliceFences[i]);
+            sliceFences[i] = 0;
+        }
+    }
+
+    if (UBO != 0)
+    {
+        if (persistent)
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+
+        glDeleteBuffers(1, &UBO);
+        UBO = 0;
+    }
+
+    mappedData = nullptr;
+    stagingData.clear();
+    drawCount = 0;
+}
+
+PerDrawBuffer::~PerDrawBuffer()
+{
+    ClearBuffer();
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+
+#include "Config.h"
+
+using std::cerr;
+using std::endl;
+using std::vector;
+
+// Layout of the PerDraw uniform block (std140)
+struct PerDrawData
+{
+    glm::mat4 model;
+    glm::mat4 normalMatrix;     // mat3(transpose(inverse(model))) padded to a mat4
+    glm::mat4 mvp;              // Projection * View * Model of the camera
+    glm::ivec4 textureLayers;   // x = albedo layer, y = normal layer, -1 when not drawn from texture arrays
+    glm::vec4 virtualRegion;    // Albedo region in the virtual texture (VirtualTexture::GetRegion), -1 without one
+};
+
+// Returned by AddDraw when the frame has no room left, BindDraw refuses it
+constexpr uint32_t PER_DRAW_NONE = 0xFFFFFFFF;
+
+/*
+    Ring of per-draw uniform blocks, one slice per frame in flight.
+
+    The CPU fills every draw of the frame once (AddDraw), and each draw
+    only binds its range of the buffer (BindDraw). Uses a persistently
+    mapped buffer when ARB_buffer_storage is there, orphaning otherwise.
+*/
+class PerDrawBuffer
+{
+public:
+
+    PerDrawBuffer();
+
+    bool Init(uint32_t maxDraws);
+
+    // Waits for the GPU to release this frame's slice and resets the draw count
+    void BeginFrame();
+
+    // Writes the matrices of one draw and returns its index in this frame, PER_DRAW_NONE when it's full
+    uint32_t AddDraw(const glm::mat4& model, const glm::mat4& viewProjection, const glm::ivec4& textureLayers = glm::ivec4(-1),
+                     const glm::vec4& virtualRegion = glm::vec4(-1.0f));
+
+    // Makes the draws of this frame visible to the GPU. Call before the first pass
+    void Upload();
+
+    // False for PER_DRAW_NONE, the draw should be skipped
+    bool BindDraw(uint32_t drawIndex);
+
+    // Fences the slice after the last pass that reads it
+    void EndFrame();
+
+    void ClearBuffer();
+
+    ~PerDrawBuffer();
+
+private:
+
+    GLuint UBO;
+
+    uint32_t maxDrawCount, drawCount;
+    bool overflowReported;
+    GLsizeiptr drawStride, sliceSize;
+
+    uint32_t frameSlice;
+    GLsync sliceFences[PER_DRAW_FRAMES];
+
+    bool persistent;
+    uint8_t* mappedData;
+
+    // Used when the buffer can't be mapped persistently
+    vector<uint8_t> stagingData;
+
+    uint8_t* GetSliceData();
+};
@@ -0,0 +1,482 @@
+#include "PostProcessing.h"
+
+#include <string.h>
+
+static constexpr UniformID UNIFORM_INPUT_TEXTURE("inputTexture");
+static constexpr UniformID UNIFORM_BLEND_TEXTURE("blendTexture");
+static constexpr UniformID UNIFORM_TEXEL_SIZE("texelSize");
+static constexpr UniformID UNIFORM_UV_SCALE("uvScale");
+static constexpr UniformID UNIFORM_UV_CLAMP("uvClamp");
+static constexpr UniformID UNIFORM_SHARPNESS("sharpness");
+static constexpr UniformID UNIFORM_EXPOSURE("exposure");
+static constexpr UniformID UNIFORM_TONE_MAP_MODE("toneMapMode");
+static constexpr UniformID UNIFORM_GAMMA("gamma");
+static constexpr UniformID UNIFORM_SATURATION("saturation");
+static constexpr UniformID UNIFORM_CONTRAST("contrast");
+static constexpr UniformID UNIFORM_TINT("tint");
+static constexpr UniformID UNIFORM_VIGNETTE_STRENGTH("vignetteStrength");
+static constexpr UniformID UNIFORM_VIGNETTE_RADIUS("vignetteRadius");
+
+// Fragment shaders of the antialiasing passes
+static const char* FXAA_SHADER = "Shaders/fxaa.frag";
+static const char* SMAA_EDGES_SHADER = "Shaders/smaa_edges.frag";
+static const char* SMAA_WEIGHTS_SHADER = "Shaders/smaa_weights.frag";
+static const char* SMAA_BLEND_SHADER = "Shaders/smaa_blend.frag";
+
+// Where the generated code goes in the fused shader template
+static const char* POST_UNIFORMS_MARKER = "// POST_UNIFORMS";
+static const char* POST_EFFECTS_MARKER = "// POST_EFFECTS";
+
+// GLSL of a per-pixel effect, working on vec4 colour at TexCoords. Screen space effects use ScreenCoords,
+// TexCoords only covers part of the input when the scene is drawn at a lower resolution
+struct FusedSnippet
+{
+    const char* name;
+    const char* uniforms;
+    const char* code;
+};
+
+static const FusedSnippet FUSED_SNIPPETS[] =
+{
+    // POST_EXPOSURE
+    {
+        "Exposure",
+        "uniform float exposure;\n",
+        "colour.rgb *= exposure;\n"
+    },
+
+    // POST_TONE_MAP
+    {
+        "ToneMap",
+        "uniform int toneMapMode;\n",
+        "if (toneMapMode == 1) colour.rgb = colour.rgb / (colour.rgb + vec3(1.0));\n"
+        "else if (toneMapMode == 2) colour.rgb = vec3(1.0) - exp(-colour.rgb);\n"
+    },
+
+    // POST_COLOR_GRADING
+    {
+        "ColorGrading",
+        "uniform float saturation;\nuniform float contrast;\nuniform vec3 tint;\n",
+        "float luma = dot(colour.rgb, vec3(0.2126, 0.7152, 0.0722));\n"
+        "colour.rgb = mix(vec3(luma), colour.rgb, saturation);\n"
+        "colour.rgb = max((colour.rgb - 0.5) * contrast + 0.5, 0.0) * tint;\n"
+    },
+
+    // POST_VIGNETTE
+    {
+        "Vignette",
+        "uniform float vignetteStrength;\nuniform float vignetteRadius;\n",
+        "float vignetteDistance = length(ScreenCoords - 0.5) * 1.41421356;\n"
+        "colour.rgb *= 1.0 - vignetteStrength * smoothstep(vignetteRadius, 1.0, vignetteDistance);\n"
+    },
+
+    // POST_GAMMA
+    {
+        "Gamma",
+        "uniform float gamma;\n",
+        "colour.rgb = pow(colour.rgb, vec3(1.0 / gamma));\n"
+    }
+};
+
+static_assert(sizeof(FUSED_SNIPPETS) / sizeof(FUSED_SNIPPETS[0]) == POST_FULLSCREEN, "One snippet per per-pixel effect");
+
+const char* GetAntiAliasingName(AntiAliasingMode mode)
+{
+    switch (mode)
+    {
+    case AA_NONE: return "None";
+    case AA_FXAA: return "FXAA";
+    case AA_SMAA: return "SMAA 1x";
+    case AA_MSAA_2X: return "MSAA 2x";
+    case AA_MSAA_4X: return "MSAA 4x";
+    default: return "Unknown";
+    }
+}
+
+uint32_t GetAntiAliasingSamples(AntiAliasingMode mode)
+{
+    if (mode == AA_MSAA_2X) return 2;
+    if (mode == AA_MSAA_4X) return 4;
+
+    return 1;
+}
+
+static string ReplaceMarker(const string& source, const char* marker, const string& code)
+{
+    size_t position = source.find(marker);
+    if (position == string::npos)
+    {
+        cerr << "\n\nERROR: Post-processing template has no " << marker << ".\n" << endl;
+        return source;
+    }
+
+    return source.substr(0, position) + code + source.substr(position + strlen(marker));
+}
+
+RenderTargetPool::RenderTargetPool()
+{
+}
+
+RenderTarget* RenderTargetPool::Acquire(uint32_t width, uint32_t height, GLenum internalFormat)
+{
+    for (RenderTarget* target : targets)
+    {
+        if (!target->inUse && target->width == width && target->height == height && target->internalFormat == internalFormat)
+        {
+            target->inUse = true;
+            return target;
+        }
+    }
+
+    // Only the upload format of the empty image, nothing is uploaded
+    bool floatFormat = internalFormat != GL_RGBA8;
+    GLenum format = internalFormat == GL_R11F_G11F_B10F ? GL_RGB : GL_RGBA;
+
+    RenderTarget* target = new RenderTarget();
+    target->width = width;
+    target->height = height;
+    target->internalFormat = internalFormat;
+    target->inUse = true;
+
+    glGenTextures(1, &target->texture);
+    glBindTexture(GL_TEXTURE_2D, target->texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, floatFormat ? GL_FLOAT : GL_UNSIGNED_BYTE, nullptr);
+
+    // Linear, so passes can take filtered taps between texels
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenFramebuffers(1, &target->FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, target->FBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target->texture, 0);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+    if( status != GL_FRAMEBUFFER_COMPLETE )
+    {
+        cerr << "\nERROR: Post-processing Framebuffer Error. " << status << ".\n" << endl;
+    }
+
+    targets.push_back(target);
+
+    return target;
+}
+
+void RenderTargetPool::Release(RenderTarget* target)
+{
+    if (target) target->inUse = false;
+}
+
+void RenderTargetPool::DeleteTarget(RenderTarget* target)
+{
+    glDeleteFramebuffers(1, &target->FBO);
+    glDeleteTextures(1, &target->texture);
+    delete target;
+}
+
+void RenderTargetPool::Trim()
+{
+    vector<RenderTarget*> kept;
+
+    for (RenderTarget* target : targets)
+    {
+        if (target->inUse) kept.push_back(target);
+        else DeleteTarget(target);
+    }
+
+    targets = kept;
+}
+
+void RenderTargetPool::ClearPool()
+{
+    for (RenderTarget* target : targets)
+    {
+        DeleteTarget(target);
+    }
+
+    targets.clear();
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+    ClearPool();
+}
+
+PostProcessStack::PostProcessStack()
+{
+    passesDirty = true;
+    builtAntiAliasing = AA_NONE;
+    upscaleShader = nullptr;
+    targetSize = glm::uvec2(0);
+    triangleVAO = 0;
+}
+
+void PostProcessStack::Init(const char* vertexLocation, const char* fusedTemplateLocation)
+{
+    vertexSource = Shader::ReadFile(vertexLocation);
+    fusedTemplate = Shader::ReadFile(fusedTemplateLocation);
+
+    // Core profile still wants a VAO bound to draw, even without attributes
+    glGenVertexArrays(1, &triangleVAO);
+}
+
+void PostProcessStack::AddEffect(PostEffectType type)
+{
+    effects.push_back(type);
+    passesDirty = true;
+}
+
+void PostProcessStack::SetUpscalePass(const char* fragmentLocation)
+{
+    upscaleShader = GetFullscreenShader(fragmentLocation);
+}
+
+void PostProcessStack::BuildPasses()
+{
+    passes.clear();
+
+    vector<PostEffectType> fusedEffects;
+
+    // Gamma corrected from the pass that has the gamma on
+    bool ldr = false;
+    bool fusedGamma = false;
+
+    for (PostEffectType effect : effects)
+    {
+        if (effect < POST_FULLSCREEN)
+        {
+            fusedEffects.push_back(effect);
+            if (effect == POST_GAMMA) fusedGamma = true;
+            continue;
+        }
+
+        // A fullscreen effect ends the run of per-pixel ones before it
+        if (!fusedEffects.empty())
+        {
+            ldr = ldr || fusedGamma;
+            passes.push_back({ GetFusedShader(fusedEffects), true, ldr, 1, 0 });
+            fusedEffects.clear();
+        }
+
+        if (effect == POST_ANTI_ALIASING)
+        {
+            AddAntiAliasingPasses(ldr);
+        }
+    }
+
+    // Also the copy to the screen when the chain is empty
+    if (!fusedEffects.empty() || passes.empty())
+    {
+        ldr = ldr || fusedGamma;
+        passes.push_back({ GetFusedShader(fusedEffects), true, ldr, 1, 0 });
+    }
+
+    passesDirty = false;
+    builtAntiAliasing = settings.antiAliasing;
+
+    // The new passes may want other formats, the old targets would only sit in the pool
+    targetPool.Trim();
+}
+
+void PostProcessStack::AddAntiAliasingPasses(bool ldr)
+{
+    if (settings.antiAliasing == AA_FXAA)
+    {
+        passes.push_back({ GetFullscreenShader(FXAA_SHADER), false, ldr, 1, 0 });
+    }
+    else if (settings.antiAliasing == AA_SMAA)
+    {
+        // Edges and weights are 8 bit whatever the colour is, the blend reads the colour from before the edges
+        passes.push_back({ GetFullscreenShader(SMAA_EDGES_SHADER), false, true, 1, 0 });
+        passes.push_back({ GetFullscreenShader(SMAA_WEIGHTS_SHADER), false, true, 1, 0 });
+        passes.push_back({ GetFullscreenShader(SMAA_BLEND_SHADER), false, ldr, 3, 1 });
+    }
+}
+
+Shader* PostProcessStack::GetFusedShader(const vector<PostEffectType>& fusedEffects)
+{
+    string key = "fused";
+    for (PostEffectType type : fusedEffects) key += string(":") + FUSED_SNIPPETS[type].name;
+
+    auto found = shaders.find(key);
+    if (found != shaders.end()) return found->second;
+
+    string uniforms, code;
+    bool declared[POST_FULLSCREEN] = {};
+
+    for (PostEffectType type : fusedEffects)
+    {
+        const FusedSnippet& snippet = FUSED_SNIPPETS[type];
+
+        if (!declared[type]) uniforms += snippet.uniforms;
+        declared[type] = true;
+
+        // Own scope, so the same effect can be in the run twice
+        code += string("    // ") + snippet.name + "\n    {\n        " + snippet.code + "    }\n";
+    }
+
+    string fragmentCode = ReplaceMarker(ReplaceMarker(fusedTemplate, POST_UNIFORMS_MARKER, uniforms), POST_EFFECTS_MARKER, code);
+
+    cerr << "Compiling post-processing pass [" << key << "]..." << endl;
+
+    Shader* shader = new Shader();
+    shader->CreateFromString(vertexSource.c_str(), fragmentCode.c_str());
+
+    shaders[key] = shader;
+    return shader;
+}
+
+Shader* PostProcessStack::GetFullscreenShader(const string& fragmentLocation)
+{
+    auto found = shaders.find(fragmentLocation);
+    if (found != shaders.end()) return found->second;
+
+    string fragmentCode = Shader::ReadFile(fragmentLocation.c_str());
+
+    Shader* shader = new Shader();
+    shader->CreateFromString(vertexSource.c_str(), fragmentCode.c_str());
+
+    shaders[fragmentLocation] = shader;
+    return shader;
+}
+
+void PostProcessStack::SetUniforms(Shader* shader, glm::uvec2 textureSize, glm::uvec2 renderSize)
+{
+    glm::vec2 texelSize = 1.0f / glm::vec2(textureSize);
+
+    shader->setInt(UNIFORM_INPUT_TEXTURE, 0);
+    shader->setInt(UNIFORM_BLEND_TEXTURE, 1);
+    shader->setVec2(UNIFORM_TEXEL_SIZE, texelSize);
+
+    // Only the corner the scene was drawn in is read, half a texel in from its edge
+    shader->setVec2(UNIFORM_UV_SCALE, glm::vec2(renderSize) * texelSize);
+    shader->setVec2(UNIFORM_UV_CLAMP, (glm::vec2(renderSize) - 0.5f) * texelSize);
+    shader->setFloat(UNIFORM_SHARPNESS, settings.sharpness);
+
+    shader->setFloat(UNIFORM_EXPOSURE, settings.exposure);
+    shader->setInt(UNIFORM_TONE_MAP_MODE, (int)settings.toneMapMode);
+    shader->setFloat(UNIFORM_GAMMA, settings.gamma);
+    shader->setFloat(UNIFORM_SATURATION, settings.saturation);
+    shader->setFloat(UNIFORM_CONTRAST, settings.contrast);
+    shader->setVec3(UNIFORM_TINT, settings.tint);
+    shader->setFloat(UNIFORM_VIGNETTE_STRENGTH, settings.vignetteStrength);
+    shader->setFloat(UNIFORM_VIGNETTE_RADIUS, settings.vignetteRadius);
+}
+
+void PostProcessStack::Render(GLuint sourceTexture, glm::uvec2 textureSize, glm::uvec2 renderSize, glm::uvec2 outputSize)
+{
+    if (passesDirty || builtAntiAliasing != settings.antiAliasing) BuildPasses();
+
+    // Targets are made at the source size, after a resize the old ones are never picked again
+    if (textureSize != targetSize)
+    {
+        targetPool.Trim();
+        targetSize = textureSize;
+    }
+
+    // The chain runs at the render size, the upscale only when that's smaller than the output
+    vector<PostPass> framePasses = passes;
+
+    if (upscaleShader != nullptr && renderSize != outputSize)
+    {
+        framePasses.push_back({ upscaleShader, false, passes.back().ldr, 1, 0 });
+    }
+
+    size_t passCount = framePasses.size();
+
+    // Output 0 is the source, output i + 1 is written by pass i. Each is kept until its last reader ran
+    vector<RenderTarget*> outputs(passCount + 1, nullptr);
+    vector<size_t> lastReader(passCount + 1, 0);
+
+    for (size_t i = 0; i < passCount; i++)
+    {
+        // Until a later pass reads it, an output nothing reads goes back right away
+        lastReader[i + 1] = i;
+        lastReader[i + 1 - framePasses[i].inputBack] = i;
+        if (framePasses[i].blendInputBack) lastReader[i + 1 - framePasses[i].blendInputBack] = i;
+    }
+
+    GLenum hdrFormat = HDR_HALF_FLOAT ? GL_RGBA16F : GL_R11F_G11F_B10F;
+
+    GLint outputFBO = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &outputFBO);
+
+    // Every pixel is written, nothing to clear or depth test
+    glDisable(GL_DEPTH_TEST);
+    glBindVertexArray(triangleVAO);
+    glActiveTexture(GL_TEXTURE0);
+
+    for (size_t i = 0; i < passCount; i++)
+    {
+        const PostPass& pass = framePasses[i];
+
+        // The last pass writes the output, the others a pooled target the next ones read.
+        // Targets are full size so a new scale never reallocates them
+        bool lastPass = i + 1 == passCount;
+        RenderTarget* target = lastPass ? nullptr : targetPool.Acquire(textureSize.x, textureSize.y, pass.ldr ? GL_RGBA8 : hdrFormat);
+        glm::uvec2 viewport = lastPass ? outputSize : renderSize;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, target ? target->FBO : (GLuint)outputFBO);
+        glViewport(0, 0, viewport.x, viewport.y);
+
+        pass.shader->UseShader();
+        SetUniforms(pass.shader, textureSize, renderSize);
+
+        if (pass.blendInputBack)
+        {
+            RenderTarget* blendInput = outputs[i + 1 - pass.blendInputBack];
+
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, blendInput ? blendInput->texture : sourceTexture);
+            glActiveTexture(GL_TEXTURE0);
+        }
+
+        RenderTarget* input = outputs[i + 1 - pass.inputBack];
+
+        glBindTexture(GL_TEXTURE_2D, input ? input->texture : sourceTexture);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        outputs[i + 1] = target;
+
+        // Free for the passes after, once nothing later reads them
+        for (size_t j = 0; j <= i + 1; j++)
+        {
+            if (outputs[j] && lastReader[j] == i)
+            {
+                targetPool.Release(outputs[j]);
+                outputs[j] = nullptr;
+            }
+        }
+    }
+
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void PostProcessStack::Clear()
+{
+    for (auto& shader : shaders)
+    {
+        delete shader.second;
+    }
+
+    shaders.clear();
+    passes.clear();
+    passesDirty = true;
+    upscaleShader = nullptr;
+
+    targetPool.ClearPool();
+
+    if( triangleVAO )
+    {
+        glDeleteVertexArrays(1, &triangleVAO);
+        triangleVAO = 0;
+    }
+}
+
+PostProcessStack::~PostProcessStack()
+{
+    Clear();
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+
+#include "Config.h"
+#include "Shader.h"
+
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+
+// Curve of the tone map effect, the toneMapMode uniform of the fused shader
+enum ToneMapMode
+{
+    TONEMAP_NONE = 0,
+    TONEMAP_REINHARD = 1,
+    TONEMAP_EXPOSURE = 2        // 1 - exp(-colour), after the exposure effect scaled it
+};
+
+enum PostEffectType
+{
+    // Per pixel, adjacent ones are fused into one generated shader
+    POST_EXPOSURE,
+    POST_TONE_MAP,
+    POST_COLOR_GRADING,
+    POST_VIGNETTE,
+    POST_GAMMA,
+
+    // First of the effects with fullscreen passes of their own, they can read any texel of their input
+    POST_FULLSCREEN,
+
+    // FXAA or SMAA passes, picked from settings.antiAliasing. Goes after the gamma, on the LDR image
+    POST_ANTI_ALIASING
+};
+
+// Picked at runtime. The MSAA ones are done by the HDR target, the others by the stack
+enum AntiAliasingMode
+{
+    AA_NONE,
+    AA_FXAA,
+    AA_SMAA,            // SMAA 1x: edges, blending weights and neighbourhood blending
+    AA_MSAA_2X,
+    AA_MSAA_4X,
+    AA_MODE_COUNT
+};
+
+const char* GetAntiAliasingName(AntiAliasingMode mode);
+
+// Samples of the HDR target for the mode, 1 when it isn't MSAA
+uint32_t GetAntiAliasingSamples(AntiAliasingMode mode);
+
+// Uniforms of every effect, set on each pass. The ones a pass doesn't use are skipped
+struct PostSettings
+{
+    float exposure = 1.0f;
+    uint32_t toneMapMode = TONEMAP_REINHARD;
+    float gamma = 2.2f;
+
+    float saturation = 1.0f;
+    float contrast = 1.0f;
+    glm::vec3 tint = glm::vec3(1.0f);
+
+    float vignetteStrength = 0.0f;
+    float vignetteRadius = 0.75f;        // Distance from the centre where it starts, 1 is the corner
+
+    float sharpness = UPSCALE_SHARPNESS;
+
+    AntiAliasingMode antiAliasing = (AntiAliasingMode)ANTI_ALIASING;
+};
+
+struct RenderTarget
+{
+    GLuint FBO;
+    GLuint texture;
+    uint32_t width, height;
+    GLenum internalFormat;
+    bool inUse;
+};
+
+/*
+    Colour targets shared by the passes of the post-processing chain.
+
+    A pass asks for a target of its size and format and gives it back once
+    the passes after it have read it, so a chain of any length ping-pongs
+    between a few textures. Targets are made the first time a size is asked
+    for and kept.
+*/
+class RenderTargetPool
+{
+public:
+
+    RenderTargetPool();
+
+    // GL_RGBA8 for the passes after the gamma, the HDR format before it
+    RenderTarget* Acquire(uint32_t width, uint32_t height, GLenum internalFormat);
+    void Release(RenderTarget* target);
+
+    // Deletes the targets that aren't in use, for when the size or the passes change
+    void Trim();
+
+    void ClearPool();
+
+    ~RenderTargetPool();
+
+private:
+
+    RenderTargetPool(const RenderTargetPool&) = delete;
+    RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+    static void DeleteTarget(RenderTarget* target);
+
+    vector<RenderTarget*> targets;
+};
+
+/*
+    Ordered list of screen effects between the HDR target and the screen.
+
+    Runs of per-pixel effects (exposure, tone map, color grading, vignette,
+    gamma) are fused: their snippets go into one fragment shader generated
+    from post-processing.frag, so they cost a single fullscreen triangle.
+    Fullscreen effects that read neighbouring texels get a pass of their
+    own, and the intermediate results live in the RenderTargetPool. The
+    antialiasing effect turns into the FXAA pass or the three SMAA ones
+    when the passes are built, again when settings.antiAliasing changes.
+    With dynamic resolution the chain runs at the render size and a last
+    pass upscales and sharpens it to the window.
+*/
+class PostProcessStack
+{
+public:
+
+    PostProcessStack();
+
+    void Init(const char* vertexLocation, const char* fusedTemplateLocation);
+
+    void AddEffect(PostEffectType type);
+
+    // Last pass when the scene was drawn smaller than the output (DynamicResolution)
+    void SetUpscalePass(const char* fragmentLocation);
+
+    // Draws the chain into the framebuffer that is bound when it's called. The source is textureSize
+    // with the scene in its renderSize corner, the output outputSize
+    void Render(GLuint sourceTexture, glm::uvec2 textureSize, glm::uvec2 renderSize, glm::uvec2 outputSize);
+
+    PostSettings settings;
+
+    // Frees the shaders, targets and VAO, the effect list stays
+    void Clear();
+
+    ~PostProcessStack();
+
+private:
+
+    PostProcessStack(const PostProcessStack&) = delete;
+    PostProcessStack& operator=(const PostProcessStack&) = delete;
+
+    struct PostPass
+    {
+        Shader* shader;
+        bool fused;
+        bool ldr;                   // Writes gamma corrected colour, into a GL_RGBA8 target
+        uint32_t inputBack;         // inputTexture is the output of this many passes back, 1 the previous one
+        uint32_t blendInputBack;    // blendTexture the same way, 0 when the pass has none
+    };
+
+    string vertexSource;
+    string fusedTemplate;
+
+    vector<PostEffectType> effects;
+    vector<PostPass> passes;
+    bool passesDirty;
+    AntiAliasingMode builtAntiAliasing;
+    Shader* upscaleShader;
+
+    // Fused shaders by the effect list they were made from, fullscreen ones by file
+    std::unordered_map<string, Shader*> shaders;
+
+    RenderTargetPool targetPool;
+    glm::uvec2 targetSize;                  // Of the pooled targets, they go when the source size changes
+    GLuint triangleVAO;
+
+    void BuildPasses();
+    void AddAntiAliasingPasses(bool ldr);
+    Shader* GetFusedShader(const vector<PostEffectType>& fusedEffects);
+    Shader* GetFullscreenShader(const string& fragmentLocation);
+    void SetUniforms(Shader* shader, glm::uvec2 textureSize, glm::uvec2 renderSize);
+};
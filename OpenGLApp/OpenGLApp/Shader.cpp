@@ -1,11 +1,11 @@
 #include "Shader.h"
+#include "ShaderCache.h"
+#include "AssetPack.h"
 
 using std::cerr;
 using std::cout;
 using std::endl;
 using std::string;
-using std::ifstream;
-using std::getline;
 
 Shader::Shader()
 {
@@ -15,6 +15,11 @@ Shader::Shader()
 
     pointLightCount = 0;
     spotLightCount = 0;
+
+    compilePending = false;
+    linked = false;
+    cacheKey = 0;
+    pendingShaderCount = 0;
 }
 
 void Shader::CreateFromString(const char *vertexCode, const char *fragmentCode)
@@ -50,70 +55,154 @@ void Shader::CreateFromFile(const char *vertexLocation, const char *geometryLoca
 
 string Shader::ReadFile(const char* fileLocation)
 {
-    string content;
-    ifstream fileStream(fileLocation, std::ios::in);
+    // From the asset pack, or the loose file during development
+    AssetFile file;
 
-    if( !fileStream.is_open() )
+    if( !file.Open(fileLocation) )
     {
         cerr << "\n\nERROR: Failed to read " << fileLocation << ". \n" << endl;
         return "";
     }
 
-    string line = "";
-    while (!fileStream.eof())
-    {
-        getline(fileStream, line);
-        content.append(line + "\n");
-    }
-    
-    fileStream.close();
+    // The compiler doesn't mind the \r of Windows line endings
+    string content((const char*)file.GetData(), file.GetSize());
+    content += "\n";
+
     return content;
 }
 
+// Inserts the #define block right after the #version line, which has to stay first
+string Shader::InjectDefines(const string& shaderCode, const string& defines)
+{
+    if (defines.empty()) return shaderCode;
+
+    size_t versionPos = shaderCode.find("#version");
+    if (versionPos == string::npos) return defines + shaderCode;
+
+    size_t lineEnd = shaderCode.find('\n', versionPos);
+    if (lineEnd == string::npos) return shaderCode + "\n" + defines;
+
+    return shaderCode.substr(0, lineEnd + 1) + defines + shaderCode.substr(lineEnd + 1);
+}
+
 void Shader::CompileShader(const char *vertexCode, const char *fragmentCode)
 {
-// Create a new shader program and get its ID
-	shaderID = glCreateProgram();
+    CompileShader(vertexCode, nullptr, fragmentCode);
+}
 
-	// Check if the shader program was created successfully
+void Shader::CompileShader(const char *vertexCode, const char *geometryCode, const char *fragmentCode)
+{
+    // Create a new shader program and get its ID
+    shaderID = glCreateProgram();
+
+    // Check if the shader program was created successfully
     if (!shaderID)
     {
-		cerr << "\n\nERROR: Failed to create shader program.\n" << endl;
-		return;
-	}
+        cerr << "\n\nERROR: Failed to create shader program.\n" << endl;
+        return;
+    }
+
+    // Warm runs skip the compile and link entirely
+    cacheKey = ShaderCache::GetKey(vertexCode, geometryCode, fragmentCode);
 
-	// Attach and compile the vertex shader to the shader program
+    if (ShaderCache::LoadProgram(shaderID, cacheKey))
+    {
+        linked = true;
+        GetUniformLocations();
+        return;
+    }
+
+    // Attach and compile the vertex shader to the shader program
     AddShader(shaderID, vertexCode, GL_VERTEX_SHADER);
 
+    // Attach and compile the geometry shader to the shader program
+    if (geometryCode)
+    {
+        AddShader(shaderID, geometryCode, GL_GEOMETRY_SHADER);
+    }
+
     // Attach and compile the fragment shader to the shader program
     AddShader(shaderID, fragmentCode, GL_FRAGMENT_SHADER);
 
-  CompileProgram();
+    // Lets us read the linked binary back for the cache
+    if (ShaderCache::IsSupported())
+    {
+        glProgramParameteri(shaderID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // Queued behind the compiles, nothing waits for it until IsReady() or UseShader()
+    glLinkProgram(shaderID);
+    compilePending = true;
 }
 
-void Shader::CompileShader(const char *vertexCode, const char *geometryCode, const char *fragmentCode)
+void Shader::EnableParallelCompile()
 {
-  // Create a new shader program and get its ID
-  shaderID = glCreateProgram();
+    if (!GLEW_KHR_parallel_shader_compile) return;
 
-  // Check if the shader program was created successfully
-  if (!shaderID)
-  {
-        cerr << "\n\nERROR: Failed to create shader program.\n"
-             << endl;
-        return;
-  }
+    // 0xFFFFFFFF lets the driver pick the thread count
+    glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+}
 
-  // Attach and compile the vertex shader to the shader program
-  AddShader(shaderID, vertexCode, GL_VERTEX_SHADER);
+bool Shader::IsReady()
+{
+    if (!compilePending) return linked;
 
-  // Attach and compile the fragment shader to the shader program
-  AddShader(shaderID, geometryCode, GL_GEOMETRY_SHADER);
+    // Without the extension the first status query blocks, so it's the same as finishing now
+    if (GLEW_KHR_parallel_shader_compile)
+    {
+        GLint completed = 0;
+        glGetProgramiv(shaderID, GL_COMPLETION_STATUS_KHR, &completed);
 
-  // Attach and compile the fragment shader to the shader program
-  AddShader(shaderID, fragmentCode, GL_FRAGMENT_SHADER);
+        if (!completed) return false;
+    }
 
-  CompileProgram();
+    FinishCompile();
+    return linked;
+}
+
+void Shader::FinishCompile()
+{
+    if (!compilePending) return;
+    compilePending = false;
+
+    GLint result = 0;
+    GLchar eLog[1024] = {0};
+
+    // The link log alone doesn't say which stage broke
+    for (uint32_t i = 0; i < pendingShaderCount; i++)
+    {
+        glGetShaderiv(pendingShaders[i], GL_COMPILE_STATUS, &result);
+
+        if (!result)
+        {
+            const char* stageName = (pendingShaderTypes[i] == GL_VERTEX_SHADER) ? "vertex" :
+                                    (pendingShaderTypes[i] == GL_GEOMETRY_SHADER) ? "geometry" : "fragment";
+
+            glGetShaderInfoLog(pendingShaders[i], sizeof(eLog), NULL, eLog);
+            cerr << "\n\nERROR: Failed to compile the " << stageName << " shader: " << eLog << endl;
+        }
+    }
+
+    linked = CompileProgram();
+
+    if (linked)
+    {
+        ShaderCache::SaveProgram(shaderID, cacheKey);
+    }
+
+    // The program keeps its own copy of the binary
+    DeletePendingShaders();
+}
+
+void Shader::DeletePendingShaders()
+{
+    for (uint32_t i = 0; i < pendingShaderCount; i++)
+    {
+        if (shaderID != 0) glDetachShader(shaderID, pendingShaders[i]);
+        glDeleteShader(pendingShaders[i]);
+    }
+
+    pendingShaderCount = 0;
 }
 
 // Getting the uniforms
@@ -201,6 +290,24 @@ void Shader::SetNormalMap(GLuint textureUnit)
     glUniform1i(uniformNormalMap, textureUnit);
 }
 
+void Shader::SetTextureArrays(GLuint albedoUnit, GLuint normalUnit)
+{
+    glUniform1i(uniformAlbedoArray, albedoUnit);
+    glUniform1i(uniformNormalArray, normalUnit);
+}
+
+void Shader::SetVirtualTexture(GLuint tableUnit, GLuint cacheUnit)
+{
+    glUniform1i(uniformVirtualPageTable, tableUnit);
+    glUniform1i(uniformVirtualPageCache, cacheUnit);
+}
+
+void Shader::SetMaterialMaps(GLuint mapUnit, GLuint arrayUnit)
+{
+    glUniform1i(uniformMaterialMap, mapUnit);
+    glUniform1i(uniformMaterialArray, arrayUnit);
+}
+
 void Shader::SetDirectionalShadowMap(GLuint textureUnit)
 {
     glUniform1i(uniformDirectionalShadowMap, textureUnit);
@@ -219,71 +326,89 @@ void Shader::SetLightMatrices(vector<glm::mat4> lightMatrices)
     }
 }
 
-void Shader::setBool(const std::string &name, bool value) const
+GLint Shader::GetUniformLocation(UniformID name) const
 {
-    glUniform1i(glGetUniformLocation(shaderID, name.c_str()), (int)value);
+    return FindUniform(name.hash);
+}
+
+GLint Shader::FindUniform(uint32_t nameHash) const
+{
+    auto uniform = uniformTable.find(nameHash);
+    return (uniform != uniformTable.end()) ? uniform->second : -1;
+}
+
+void Shader::setBool(UniformID name, bool value) const
+{
+    glUniform1i(GetUniformLocation(name), (int)value);
 }
 // ------------------------------------------------------------------------
-void Shader::setInt(const std::string &name, int value) const
+void Shader::setInt(UniformID name, int value) const
 {
-    glUniform1i(glGetUniformLocation(shaderID, name.c_str()), value);
+    glUniform1i(GetUniformLocation(name), value);
 }
 // ------------------------------------------------------------------------
-void Shader::setFloat(const std::string &name, float value) const
+void Shader::setFloat(UniformID name, float value) const
 {
-    glUniform1f(glGetUniformLocation(shaderID, name.c_str()), value);
+    glUniform1f(GetUniformLocation(name), value);
 }
 // ------------------------------------------------------------------------
-void Shader::setVec2(const std::string &name, const glm::vec2 &value) const
+void Shader::setVec2(UniformID name, const glm::vec2 &value) const
 {
-    glUniform2fv(glGetUniformLocation(shaderID, name.c_str()), 1, &value[0]);
+    glUniform2fv(GetUniformLocation(name), 1, &value[0]);
 }
-void Shader::setVec2(const std::string &name, float x, float y) const
+void Shader::setVec2(UniformID name, float x, float y) const
 {
-    glUniform2f(glGetUniformLocation(shaderID, name.c_str()), x, y);
+    glUniform2f(GetUniformLocation(name), x, y);
 }
 // ------------------------------------------------------------------------
-void Shader::setVec3(const std::string &name, const glm::vec3 &value) const
+void Shader::setVec3(UniformID name, const glm::vec3 &value) const
 {
-    glUniform3fv(glGetUniformLocation(shaderID, name.c_str()), 1, &value[0]);
+    glUniform3fv(GetUniformLocation(name), 1, &value[0]);
 }
-void Shader::setVec3(const std::string &name, float x, float y, float z) const
+void Shader::setVec3(UniformID name, float x, float y, float z) const
 {
-    glUniform3f(glGetUniformLocation(shaderID, name.c_str()), x, y, z);
+    glUniform3f(GetUniformLocation(name), x, y, z);
 }
 // ------------------------------------------------------------------------
-void Shader::setVec4(const std::string &name, const glm::vec4 &value) const
+void Shader::setVec4(UniformID name, const glm::vec4 &value) const
 {
-    glUniform4fv(glGetUniformLocation(shaderID, name.c_str()), 1, &value[0]);
+    glUniform4fv(GetUniformLocation(name), 1, &value[0]);
 }
-void Shader::setVec4(const std::string &name, float x, float y, float z, float w)
+void Shader::setVec4(UniformID name, float x, float y, float z, float w)
 {
-    glUniform4f(glGetUniformLocation(shaderID, name.c_str()), x, y, z, w);
+    glUniform4f(GetUniformLocation(name), x, y, z, w);
 }
 // ------------------------------------------------------------------------
-void Shader::setMat2(const std::string &name, const glm::mat2 &mat) const
+void Shader::setMat2(UniformID name, const glm::mat2 &mat) const
 {
-    glUniformMatrix2fv(glGetUniformLocation(shaderID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix2fv(GetUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 // ------------------------------------------------------------------------
-void Shader::setMat3(const std::string &name, const glm::mat3 &mat) const
+void Shader::setMat3(UniformID name, const glm::mat3 &mat) const
 {
-    glUniformMatrix3fv(glGetUniformLocation(shaderID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix3fv(GetUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 // ------------------------------------------------------------------------
-void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const
+void Shader::setMat4(UniformID name, const glm::mat4 &mat) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(shaderID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::UseShader()
 {
+    // Programs that aren't ready yet are waited for here
+    FinishCompile();
+
     glUseProgram(shaderID);
 }
 
 // Deleting the program from the GPU
 void Shader::ClearShader()
 {
+    DeletePendingShaders();
+    compilePending = false;
+    linked = false;
+
     if( shaderID != 0 )
     {
         glDeleteProgram(shaderID);
@@ -292,6 +417,8 @@ void Shader::ClearShader()
 
     uniformModel = 0;
     uniformProjection = 0;
+
+    uniformTable.clear();
 }
 
 void Shader::AddShader(GLuint theProgram, const char *shaderCode, GLenum shaderType)
@@ -311,28 +438,20 @@ void Shader::AddShader(GLuint theProgram, const char *shaderCode, GLenum shaderT
     glShaderSource(theShader, 1, theCode, codeLength);
 
     // Compile the shader source code into a binary format that can be executed on the GPU
+    // The status is only checked in FinishCompile(), so the driver can work on the next shaders meanwhile
     glCompileShader(theShader);
 
-    GLint result = 0;
-    GLchar eLog[1024] = {0};
-
-    // Check if the shader compilation was successful
-    glGetShaderiv(theShader, GL_COMPILE_STATUS, &result);
-
-    if (!result)
-    {
-        // If compilation failed, get the error log and display it along with the shader type
-        glGetShaderInfoLog(theShader, sizeof(eLog), NULL, eLog);
-        cerr << "\n\nERROR: Failed to compile the " << ((shaderType == GL_VERTEX_SHADER) ? "vertex" : "fragment") << " shader: " << eLog << endl;
-        return;
-    }
-
-    // If the shader compilation was successful, attach the shader to the shader program
     glAttachShader(theProgram, theShader);
+
+    pendingShaders[pendingShaderCount] = theShader;
+    pendingShaderTypes[pendingShaderCount] = shaderType;
+    pendingShaderCount++;
 }
 
 void Shader::Validate()
 {
+    FinishCompile();
+
     GLint result = 0;
     GLchar eLog[1024] = {0};
 
@@ -349,14 +468,12 @@ void Shader::Validate()
     }
 }
 
-void Shader::CompileProgram()
+bool Shader::CompileProgram()
 {
     GLint result = 0;
     GLchar eLog[1024] = {0};
 
-    // Link the shader program to create the final executable in the GPU
-    glLinkProgram(shaderID);
-
+    // The link was already submitted in CompileShader()
     // Check if the linking was successful
     glGetProgramiv(shaderID, GL_LINK_STATUS, &result);
 
@@ -365,117 +482,150 @@ void Shader::CompileProgram()
         // If linking failed, get the error log and display it
         glGetProgramInfoLog(shaderID, sizeof(eLog), NULL, eLog);
         cerr << "\n\nERROR: Failed to link program: " << eLog << endl;
-        return;
+        return false;
     }
 
     // Shader compilation and linking successful
     // The shader program is now ready for use in rendering.
+    GetUniformLocations();
 
-    // Getting the values from the Shaders
-    uniformModel = glGetUniformLocation(shaderID, "model");
-    uniformProjection = glGetUniformLocation(shaderID, "projection");
-    uniformView = glGetUniformLocation(shaderID, "view");
-    uniformDirectionalLight.uniformColour = glGetUniformLocation(shaderID, "directionalLight.base.colour");
-    uniformDirectionalLight.uniformAmbientIntensity = glGetUniformLocation(shaderID, "directionalLight.base.ambientIntensity");
-    uniformDirectionalLight.uniformDirection = glGetUniformLocation(shaderID, "directionalLight.direction");
-    uniformDirectionalLight.uniformDiffuseIntensity = glGetUniformLocation(shaderID, "directionalLight.base.diffuseIntensity");
-    uniformSpecularIntensity = glGetUniformLocation(shaderID, "material.specularIntensity");
-    uniformShininess = glGetUniformLocation(shaderID, "material.shininess");
-    uniformEyePosition = glGetUniformLocation(shaderID, "eyePosition");
-
-    uniformPointLightCount = glGetUniformLocation(shaderID, "pointLightCount");
+    return true;
+}
 
-    // Getting the values from the Point Lights
-    for (size_t i = 0; i < MAX_POINT_LIGHTS; i++)
-    {
-        // \0 Grants that's it'll be aways a string
-        char locBuffer[100] = {'\0'};
+void Shader::BuildUniformTable()
+{
+    uniformTable.clear();
 
-        snprintf(locBuffer, sizeof(locBuffer), "pointLights[%zd].base.colour", i);
-        uniformPointLight[i].uniformColour = glGetUniformLocation(shaderID, locBuffer);
+    GLint uniformCount = 0, maxNameLength = 0;
+    glGetProgramiv(shaderID, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(shaderID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
 
-        snprintf(locBuffer, sizeof(locBuffer), "pointLights[%zd].base.ambientIntensity", i);
-        uniformPointLight[i].uniformAmbientIntensity = glGetUniformLocation(shaderID, locBuffer);
+    vector<GLchar> nameBuffer(maxNameLength + 16);
 
-        snprintf(locBuffer, sizeof(locBuffer), "pointLights[%zd].base.diffuseIntensity", i);
-        uniformPointLight[i].uniformDiffuseIntensity = glGetUniformLocation(shaderID, locBuffer);
+    // Only used to catch two names with the same hash
+    unordered_map<uint32_t, string> tableNames;
 
-        snprintf(locBuffer, sizeof(locBuffer), "pointLights[%zd].position", i);
-        uniformPointLight[i].uniformPosition = glGetUniformLocation(shaderID, locBuffer);
+    auto addUniform = [&](const string& name, GLint location)
+    {
+        uint32_t hash = HashUniform(name.c_str());
+        auto existing = tableNames.find(hash);
 
-        snprintf(locBuffer, sizeof(locBuffer), "pointLights[%zd].constant", i);
-        uniformPointLight[i].uniformConstant = glGetUniformLocation(shaderID, locBuffer);
+        if (existing != tableNames.end() && existing->second != name)
+        {
+            cerr << "\n\nERROR: Uniforms " << existing->second << " and " << name << " have the same hash.\n" << endl;
+            return;
+        }
 
-        snprintf(locBuffer, sizeof(locBuffer), "pointLights[%zd].linear", i);
-        uniformPointLight[i].uniformLinear = glGetUniformLocation(shaderID, locBuffer);
+        tableNames[hash] = name;
+        uniformTable[hash] = location;
+    };
 
-        snprintf(locBuffer, sizeof(locBuffer), "pointLights[%zd].exponent", i);
-        uniformPointLight[i].uniformExponent = glGetUniformLocation(shaderID, locBuffer);
+    for (GLint i = 0; i < uniformCount; i++)
+    {
+        GLsizei nameLength = 0;
+        GLint arraySize = 0;
+        GLenum type = 0;
+
+        glGetActiveUniform(shaderID, (GLuint)i, (GLsizei)nameBuffer.size(), &nameLength, &arraySize, &type, nameBuffer.data());
+        string name(nameBuffer.data(), nameLength);
+
+        // Members of uniform blocks (PerDraw) have no location
+        GLint location = glGetUniformLocation(shaderID, name.c_str());
+        if (location == -1) continue;
+
+        addUniform(name, location);
+
+        // Arrays of plain types come back once as "name[0]", so add "name" and every element
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+        {
+            string baseName = name.substr(0, name.size() - 3);
+            addUniform(baseName, location);
+
+            for (GLint element = 1; element < arraySize; element++)
+            {
+                string elementName = baseName + "[" + std::to_string(element) + "]";
+                addUniform(elementName, glGetUniformLocation(shaderID, elementName.c_str()));
+            }
+        }
     }
+}
 
-    uniformSpotLightCount = glGetUniformLocation(shaderID, "spotLightCount");
-
-    // Getting the values from the Spot Lights
-    for (size_t i = 0; i < MAX_SPOT_LIGHTS; i++)
+void Shader::GetUniformLocations()
+{
+    // Model matrices come from the per-draw ring buffer
+    GLuint perDrawBlock = glGetUniformBlockIndex(shaderID, "PerDraw");
+    if (perDrawBlock != GL_INVALID_INDEX)
     {
-        // \0 Grants that's it'll be aways a string
-        char locBuffer[100] = {'\0'};
-
-        snprintf(locBuffer, sizeof(locBuffer), "spotLights[%zd].base.base.colour", i);
-        uniformSpotLight[i].uniformColour = glGetUniformLocation(shaderID, locBuffer);
-
-        snprintf(locBuffer, sizeof(locBuffer), "spotLights[%zd].base.base.ambientIntensity", i);
-        uniformSpotLight[i].uniformAmbientIntensity = glGetUniformLocation(shaderID, locBuffer);
-
-        snprintf(locBuffer, sizeof(locBuffer), "spotLights[%zd].base.base.diffuseIntensity", i);
-        uniformSpotLight[i].uniformDiffuseIntensity = glGetUniformLocation(shaderID, locBuffer);
-
-        snprintf(locBuffer, sizeof(locBuffer), "spotLights[%zd].base.position", i);
-        uniformSpotLight[i].uniformPosition = glGetUniformLocation(shaderID, locBuffer);
-
-        snprintf(locBuffer, sizeof(locBuffer), "spotLights[%zd].base.constant", i);
-        uniformSpotLight[i].uniformConstant = glGetUniformLocation(shaderID, locBuffer);
-
-        snprintf(locBuffer, sizeof(locBuffer), "spotLights[%zd].base.linear", i);
-        uniformSpotLight[i].uniformLinear = glGetUniformLocation(shaderID, locBuffer);
+        glUniformBlockBinding(shaderID, perDrawBlock, PER_DRAW_BINDING);
+    }
 
-        snprintf(locBuffer, sizeof(locBuffer), "spotLights[%zd].base.exponent", i);
-        uniformSpotLight[i].uniformExponent = glGetUniformLocation(shaderID, locBuffer);
+    BuildUniformTable();
 
-        snprintf(locBuffer, sizeof(locBuffer), "spotLights[%zd].direction", i);
-        uniformSpotLight[i].uniformDirection = glGetUniformLocation(shaderID, locBuffer);
+    // Getting the values from the Shaders
+    uniformModel = GetUniformLocation("model");
+    uniformProjection = GetUniformLocation("projection");
+    uniformView = GetUniformLocation("view");
+    uniformDirectionalLight.uniformColour = GetUniformLocation("directionalLight.base.colour");
+    uniformDirectionalLight.uniformAmbientIntensity = GetUniformLocation("directionalLight.base.ambientIntensity");
+    uniformDirectionalLight.uniformDirection = GetUniformLocation("directionalLight.direction");
+    uniformDirectionalLight.uniformDiffuseIntensity = GetUniformLocation("directionalLight.base.diffuseIntensity");
+    uniformSpecularIntensity = GetUniformLocation("material.specularIntensity");
+    uniformShininess = GetUniformLocation("material.shininess");
+    uniformEyePosition = GetUniformLocation("eyePosition");
+
+    uniformPointLightCount = GetUniformLocation("pointLightCount");
 
-        snprintf(locBuffer, sizeof(locBuffer), "spotLights[%zd].edge", i);
-        uniformSpotLight[i].uniformEdge = glGetUniformLocation(shaderID, locBuffer);
+    // Getting the values from the Point Lights
+    for (uint32_t i = 0; i < MAX_POINT_LIGHTS; i++)
+    {
+        uniformPointLight[i].uniformColour = FindUniform(HashUniformArray("pointLights", i, ".base.colour"));
+        uniformPointLight[i].uniformAmbientIntensity = FindUniform(HashUniformArray("pointLights", i, ".base.ambientIntensity"));
+        uniformPointLight[i].uniformDiffuseIntensity = FindUniform(HashUniformArray("pointLights", i, ".base.diffuseIntensity"));
+        uniformPointLight[i].uniformPosition = FindUniform(HashUniformArray("pointLights", i, ".position"));
+        uniformPointLight[i].uniformConstant = FindUniform(HashUniformArray("pointLights", i, ".constant"));
+        uniformPointLight[i].uniformLinear = FindUniform(HashUniformArray("pointLights", i, ".linear"));
+        uniformPointLight[i].uniformExponent = FindUniform(HashUniformArray("pointLights", i, ".exponent"));
     }
 
-    uniformDirectionalLightTransform = glGetUniformLocation(shaderID, "directionalLightTransform");
-    uniformTexture = glGetUniformLocation(shaderID, "theTexture");
-    uniformNormalMap = glGetUniformLocation(shaderID, "normalMapTexture");
-    uniformDirectionalShadowMap = glGetUniformLocation(shaderID, "directionalShadowMap");
-
-    uniformOmniLightPos = glGetUniformLocation(shaderID, "lightPos");
-    uniformFarPlane = glGetUniformLocation(shaderID, "farPlane");
+    uniformSpotLightCount = GetUniformLocation("spotLightCount");
 
-    for (size_t matrixIndex = 0; matrixIndex < 6; matrixIndex++)
+    // Getting the values from the Spot Lights
+    for (uint32_t i = 0; i < MAX_SPOT_LIGHTS; i++)
     {
-        // \0 Grants that's it'll be aways a string
-        char locBuffer[100] = {'\0'};
-
-        snprintf(locBuffer, sizeof(locBuffer), "lightMatrices[%zd]", matrixIndex);
-        uniformLightMatrices[matrixIndex] = glGetUniformLocation(shaderID, locBuffer);
+        uniformSpotLight[i].uniformColour = FindUniform(HashUniformArray("spotLights", i, ".base.base.colour"));
+        uniformSpotLight[i].uniformAmbientIntensity = FindUniform(HashUniformArray("spotLights", i, ".base.base.ambientIntensity"));
+        uniformSpotLight[i].uniformDiffuseIntensity = FindUniform(HashUniformArray("spotLights", i, ".base.base.diffuseIntensity"));
+        uniformSpotLight[i].uniformPosition = FindUniform(HashUniformArray("spotLights", i, ".base.position"));
+        uniformSpotLight[i].uniformConstant = FindUniform(HashUniformArray("spotLights", i, ".base.constant"));
+        uniformSpotLight[i].uniformLinear = FindUniform(HashUniformArray("spotLights", i, ".base.linear"));
+        uniformSpotLight[i].uniformExponent = FindUniform(HashUniformArray("spotLights", i, ".base.exponent"));
+        uniformSpotLight[i].uniformDirection = FindUniform(HashUniformArray("spotLights", i, ".direction"));
+        uniformSpotLight[i].uniformEdge = FindUniform(HashUniformArray("spotLights", i, ".edge"));
     }
 
-    for (size_t matrixIndex = 0; matrixIndex < MAX_LIGHTS; matrixIndex++)
+    uniformDirectionalLightTransform = GetUniformLocation("directionalLightTransform");
+    uniformTexture = GetUniformLocation("theTexture");
+    uniformNormalMap = GetUniformLocation("normalMapTexture");
+    uniformAlbedoArray = GetUniformLocation("albedoArray");
+    uniformNormalArray = GetUniformLocation("normalArray");
+    uniformVirtualPageTable = GetUniformLocation("virtualPageTable");
+    uniformMaterialMap = GetUniformLocation("materialMapTexture");
+    uniformMaterialArray = GetUniformLocation("materialArray");
+    uniformVirtualPageCache = GetUniformLocation("virtualPageCache");
+    uniformDirectionalShadowMap = GetUniformLocation("directionalShadowMap");
+
+    uniformOmniLightPos = GetUniformLocation("lightPos");
+    uniformFarPlane = GetUniformLocation("farPlane");
+
+    for (uint32_t matrixIndex = 0; matrixIndex < 6; matrixIndex++)
     {
-        // \0 Grants that's it'll be aways a string
-        char locBuffer[100] = {'\0'};
-
-        snprintf(locBuffer, sizeof(locBuffer), "omniShadowMaps[%zd].shadowMap", matrixIndex);
-        uniformOmniShadowMap[matrixIndex].uniformShadowMap = glGetUniformLocation(shaderID, locBuffer);
+        uniformLightMatrices[matrixIndex] = FindUniform(HashUniformArray("lightMatrices", matrixIndex));
+    }
 
-        snprintf(locBuffer, sizeof(locBuffer), "omniShadowMaps[%zd].farPlane", matrixIndex);
-        uniformOmniShadowMap[matrixIndex].uniformFarPlane = glGetUniformLocation(shaderID, locBuffer);
+    for (uint32_t matrixIndex = 0; matrixIndex < MAX_LIGHTS; matrixIndex++)
+    {
+        uniformOmniShadowMap[matrixIndex].uniformShadowMap = FindUniform(HashUniformArray("omniShadowMaps", matrixIndex, ".shadowMap"));
+        uniformOmniShadowMap[matrixIndex].uniformFarPlane = FindUniform(HashUniformArray("omniShadowMaps", matrixIndex, ".farPlane"));
     }
 }
 
@@ -4,6 +4,7 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <unordered_map>
 
 #include <GL\glew.h>
 
@@ -11,11 +12,22 @@
 #include <glm\gtc\type_ptr.hpp>
 
 #include "Config.h"
+#include "Hash.h"
 #include "DirectionalLight.h"
 #include "PointLight.h"
 #include "SpotLight.h"
 
 using std::string;
+using std::unordered_map;
+
+// Hashed uniform name. Declare them constexpr to hash at compile time
+struct UniformID
+{
+    uint32_t hash;
+
+    constexpr UniformID(const char* name) : hash(HashUniform(name)) {}
+    UniformID(const string& name) : hash(HashUniform(name.c_str())) {}
+};
 
 class Shader
 {
@@ -29,7 +41,15 @@ public:
 
     void Validate();
 
-    string ReadFile(const char* fileLocation);
+    // Lets the driver compile on its own threads (KHR_parallel_shader_compile). Call once after glewInit
+    static void EnableParallelCompile();
+
+    // False while the driver is still compiling, or if the program failed. Only non-blocking with
+    // KHR_parallel_shader_compile, without it this finishes the compile and link right away
+    bool IsReady();
+
+    static string ReadFile(const char* fileLocation);
+    static string InjectDefines(const string& shaderCode, const string& defines);
 
     GLuint GetProjectionLocation();
     GLuint GetModelLocation();
@@ -49,22 +69,28 @@ public:
     void SetSpotLights(SpotLight *sLight, uint32_t lightCount, uint32_t textureUnit, uint32_t offset);
     void SetTexture(GLuint textureUnit);
     void SetNormalMap(GLuint textureUnit);
+    void SetTextureArrays(GLuint albedoUnit, GLuint normalUnit);
+    void SetVirtualTexture(GLuint tableUnit, GLuint cacheUnit);
+    void SetMaterialMaps(GLuint mapUnit, GLuint arrayUnit);
     void SetDirectionalShadowMap(GLuint textureUnit);
     void SetDirectionalLightTransform(glm::mat4* lTransform);
     void SetLightMatrices(vector<glm::mat4> lightMatrices);
 
-    void setBool(const std::string &name, bool value) const;
-    void setInt(const std::string &name, int value) const;
-    void setFloat(const std::string &name, float value) const;
-    void setVec2(const std::string &name, const glm::vec2 &value) const;
-    void setVec2(const std::string &name, float x, float y) const;
-    void setVec3(const std::string &name, const glm::vec3 &value) const;
-    void setVec3(const std::string &name, float x, float y, float z) const;
-    void setVec4(const std::string &name, const glm::vec4 &value) const;
-    void setVec4(const std::string &name, float x, float y, float z, float w);
-    void setMat2(const std::string &name, const glm::mat2 &mat) const;
-    void setMat3(const std::string &name, const glm::mat3 &mat) const;
-    void setMat4(const std::string &name, const glm::mat4 &mat) const;
+    // -1 if the uniform isn't active in this program, which glUniform* ignores
+    GLint GetUniformLocation(UniformID name) const;
+
+    void setBool(UniformID name, bool value) const;
+    void setInt(UniformID name, int value) const;
+    void setFloat(UniformID name, float value) const;
+    void setVec2(UniformID name, const glm::vec2 &value) const;
+    void setVec2(UniformID name, float x, float y) const;
+    void setVec3(UniformID name, const glm::vec3 &value) const;
+    void setVec3(UniformID name, float x, float y, float z) const;
+    void setVec4(UniformID name, const glm::vec4 &value) const;
+    void setVec4(UniformID name, float x, float y, float z, float w);
+    void setMat2(UniformID name, const glm::mat2 &mat) const;
+    void setMat3(UniformID name, const glm::mat3 &mat) const;
+    void setMat4(UniformID name, const glm::mat4 &mat) const;
 
     void UseShader();
     void ClearShader();
@@ -76,10 +102,16 @@ private:
     GLuint shaderID, uniformProjection, uniformModel, uniformView, 
     uniformEyePosition, uniformSpecularIntensity, uniformShininess,
     uniformDirectionalLightTransform, uniformDirectionalShadowMap,
-    uniformTexture, uniformOmniLightPos, uniformFarPlane, uniformNormalMap;
+    uniformTexture, uniformOmniLightPos, uniformFarPlane, uniformNormalMap,
+    uniformAlbedoArray, uniformNormalArray,
+    uniformVirtualPageTable, uniformVirtualPageCache,
+    uniformMaterialMap, uniformMaterialArray;
 
     GLuint uniformLightMatrices[6];
 
+    // Every active uniform of the program, filled once after linking
+    unordered_map<uint32_t, GLint> uniformTable;
+
     uint32_t pointLightCount;
     uint32_t spotLightCount;
 
@@ -130,10 +162,26 @@ private:
         GLuint uniformFarPlane;
     } uniformOmniShadowMap[MAX_LIGHTS];
 
+    // Compile and link are only submitted here, their status is read in FinishCompile()
+    bool compilePending;
+    bool linked;
+    uint64_t cacheKey;
+
+    GLuint pendingShaders[3];
+    GLenum pendingShaderTypes[3];
+    uint32_t pendingShaderCount;
+
     void CompileShader(const char *vertexCode, const char *fragmentCode);
-    void CompileShader(const char *vertexCode, const char *geometryLocation, const char *fragmentCode);
+    void CompileShader(const char *vertexCode, const char *geometryCode, const char *fragmentCode);
     void AddShader(GLuint theProgram, const char *shaderCode, GLenum shaderType);
 
-    void CompileProgram();
+    // Blocks until the driver is done, then checks the results
+    void FinishCompile();
+    void DeletePendingShaders();
+
+    bool CompileProgram();
+    void BuildUniformTable();
+    GLint FindUniform(uint32_t nameHash) const;
+    void GetUniformLocations();
 };
 
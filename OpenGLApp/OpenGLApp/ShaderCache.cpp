@@ -0,0 +1,163 @@
+#include "ShaderCache.h"
+
+#include <string.h>
+#include <fstream>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#define MAKE_DIRECTORY(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define MAKE_DIRECTORY(path) mkdir(path, 0755)
+#endif
+
+using std::vector;
+using std::ifstream;
+using std::ofstream;
+
+// Written in front of every cached binary
+struct ShaderCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t binaryLength;
+};
+
+static const uint32_t SHADER_CACHE_MAGIC = 0x4250494D; // "MIPB"
+static const uint32_t SHADER_CACHE_VERSION = 1;
+
+bool ShaderCache::IsSupported()
+{
+    if (!GLEW_ARB_get_program_binary && !GLEW_VERSION_4_1) return false;
+
+    // Some drivers expose the extension but no binary format
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+
+    return formatCount > 0;
+}
+
+uint64_t ShaderCache::GetKey(const char *vertexCode, const char *geometryCode, const char *fragmentCode)
+{
+    uint64_t key = FNV_OFFSET_64;
+
+    // Binaries are only valid for the driver that made them
+    const char* driverStrings[] =
+    {
+        (const char*)glGetString(GL_VENDOR),
+        (const char*)glGetString(GL_RENDERER),
+        (const char*)glGetString(GL_VERSION)
+    };
+
+    for (const char* driverString : driverStrings)
+    {
+        if (driverString) key = HashFNV1a64(driverString, strlen(driverString), key);
+    }
+
+    // The stage separators keep "ab" + "c" from matching "a" + "bc"
+    const char* stageCodes[] = { vertexCode, geometryCode, fragmentCode };
+
+    for (const char* stageCode : stageCodes)
+    {
+        if (stageCode) key = HashFNV1a64(stageCode, strlen(stageCode), key);
+        key = HashFNV1a64("|", 1, key);
+    }
+
+    return key;
+}
+
+string ShaderCache::GetCachePath(uint64_t key)
+{
+    return string(SHADER_CACHE_DIR) + "/" + HashToString(key) + ".bin";
+}
+
+bool ShaderCache::LoadProgram(GLuint program, uint64_t key)
+{
+    if (!IsSupported()) return false;
+
+    string path = GetCachePath(key);
+    ifstream fileStream(path, std::ios::in | std::ios::binary);
+
+    if (!fileStream.is_open()) return false;
+
+    ShaderCacheHeader header;
+    fileStream.read((char*)&header, sizeof(header));
+
+    bool valid = fileStream.good() &&
+                 header.magic == SHADER_CACHE_MAGIC &&
+                 header.version == SHADER_CACHE_VERSION &&
+                 header.key == key &&
+                 header.binaryLength > 0;
+
+    vector<uint8_t> binary;
+
+    if (valid)
+    {
+        binary.resize(header.binaryLength);
+        fileStream.read((char*)binary.data(), binary.size());
+        valid = fileStream.good();
+    }
+
+    fileStream.close();
+
+    if (!valid)
+    {
+        cerr << "Shader cache: ignoring invalid file " << path << endl;
+        return false;
+    }
+
+    glProgramBinary(program, header.binaryFormat, binary.data(), header.binaryLength);
+
+    // The driver can still refuse it (updated driver with the same strings, etc.)
+    GLint result = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &result);
+
+    if (!result)
+    {
+        cerr << "Shader cache: driver rejected " << path << ", compiling from source." << endl;
+        return false;
+    }
+
+    return true;
+}
+
+void ShaderCache::SaveProgram(GLuint program, uint64_t key)
+{
+    if (!IsSupported()) return;
+
+    GLint binaryLength = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+
+    if (binaryLength <= 0) return;
+
+    ShaderCacheHeader header;
+    header.magic = SHADER_CACHE_MAGIC;
+    header.version = SHADER_CACHE_VERSION;
+    header.key = key;
+
+    vector<uint8_t> binary(binaryLength);
+    GLenum binaryFormat = 0;
+    glGetProgramBinary(program, binaryLength, nullptr, &binaryFormat, binary.data());
+
+    header.binaryFormat = binaryFormat;
+    header.binaryLength = (uint32_t)binaryLength;
+
+    // Fails harmlessly when it already exists
+    MAKE_DIRECTORY(SHADER_CACHE_DIR);
+
+    string path = GetCachePath(key);
+    ofstream fileStream(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (!fileStream.is_open())
+    {
+        cerr << "\n\nERROR: Failed to write the shader cache " << path << ".\n" << endl;
+        return;
+    }
+
+    fileStream.write((const char*)&header, sizeof(header));
+    fileStream.write((const char*)binary.data(), binary.size());
+    fileStream.close();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+#include <GL\glew.h>
+
+#include "Config.h"
+#include "Hash.h"
+
+using std::cerr;
+using std::endl;
+using std::string;
+
+/*
+    On-disk cache of linked program binaries (glGetProgramBinary).
+
+    The key hashes every stage source (with its injected #defines) and the
+    driver strings, so a new driver or an edited shader just misses and the
+    program is compiled from source again.
+*/
+class ShaderCache
+{
+public:
+
+    static bool IsSupported();
+
+    // geometryCode may be nullptr
+    static uint64_t GetKey(const char *vertexCode, const char *geometryCode, const char *fragmentCode);
+
+    // Returns true if the program is linked from the cached binary
+    static bool LoadProgram(GLuint program, uint64_t key);
+    static void SaveProgram(GLuint program, uint64_t key);
+
+private:
+
+    static string GetCachePath(uint64_t key);
+};
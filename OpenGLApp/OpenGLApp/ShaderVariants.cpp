@@ -0,0 +1,104 @@
+#include "ShaderVariants.h"
+
+uint32_t ShaderFeatures::GetKey() const
+{
+    uint32_t pointCount = pointLightCount > MAX_POINT_LIGHTS ? MAX_POINT_LIGHTS : pointLightCount;
+    uint32_t spotCount = spotLightCount > MAX_SPOT_LIGHTS ? MAX_SPOT_LIGHTS : spotLightCount;
+    uint32_t pcf = pcfKernelSize >= 5 ? 2 : (pcfKernelSize >= 3 ? 1 : 0);
+
+    uint32_t key = 0;
+    key |= pointCount;
+    key |= spotCount << 5;
+    key |= (shadows ? 1u : 0u) << 10;
+    key |= (normalMapping ? 1u : 0u) << 11;
+    key |= pcf << 12;
+
+    return key;
+}
+
+string ShaderFeatures::GetDefines() const
+{
+    uint32_t key = GetKey();
+
+    // Built back from the key so the code always matches the cache slot
+    uint32_t pcf = (key >> 12) & 3u;
+
+    string defines;
+    defines += "#define NUM_POINT_LIGHTS " + std::to_string(key & 31u) + "\n";
+    defines += "#define NUM_SPOT_LIGHTS " + std::to_string((key >> 5) & 31u) + "\n";
+    defines += "#define SHADOWS_ENABLED " + std::to_string((key >> 10) & 1u) + "\n";
+    defines += "#define NORMAL_MAPPING " + std::to_string((key >> 11) & 1u) + "\n";
+    defines += "#define PCF_KERNEL_SIZE " + std::to_string(pcf * 2 + 1) + "\n";
+
+    return defines;
+}
+
+ShaderVariants::ShaderVariants()
+{
+}
+
+ShaderVariants::ShaderVariants(const char *vertexLocation, const char *fragmentLocation)
+{
+    // Reads the sources only once, every permutation is generated from them
+    vertexSource = Shader::ReadFile(vertexLocation);
+    fragmentSource = Shader::ReadFile(fragmentLocation);
+}
+
+ShaderVariants::ShaderVariants(ShaderVariants&& other)
+{
+    *this = std::move(other);
+}
+
+ShaderVariants& ShaderVariants::operator=(ShaderVariants&& other)
+{
+    if (this == &other) return *this;
+
+    ClearVariants();
+
+    vertexSource = std::move(other.vertexSource);
+    fragmentSource = std::move(other.fragmentSource);
+
+    // The other one no longer deletes them
+    variants = std::move(other.variants);
+    other.variants.clear();
+
+    return *this;
+}
+
+Shader* ShaderVariants::GetVariant(const ShaderFeatures& features)
+{
+    uint32_t key = features.GetKey();
+
+    auto found = variants.find(key);
+    if (found != variants.end())
+    {
+        return found->second;
+    }
+
+    cerr << "Compiling shader variant [0x" << std::hex << key << std::dec << "]..." << endl;
+
+    string defines = features.GetDefines();
+    string vertexCode = Shader::InjectDefines(vertexSource, defines);
+    string fragmentCode = Shader::InjectDefines(fragmentSource, defines);
+
+    Shader* variant = new Shader();
+    variant->CreateFromString(vertexCode.c_str(), fragmentCode.c_str());
+
+    variants[key] = variant;
+    return variant;
+}
+
+void ShaderVariants::ClearVariants()
+{
+    for (auto& variant : variants)
+    {
+        delete variant.second;
+    }
+
+    variants.clear();
+}
+
+ShaderVariants::~ShaderVariants()
+{
+    ClearVariants();
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <GL\glew.h>
+
+#include "Config.h"
+#include "Shader.h"
+
+using std::cerr;
+using std::endl;
+using std::string;
+
+// Everything that changes the generated code of a permutation
+struct ShaderFeatures
+{
+    uint32_t pointLightCount = 0;
+    uint32_t spotLightCount = 0;
+    bool shadows = true;
+    bool normalMapping = false;
+    uint32_t pcfKernelSize = 3;     // 1, 3 or 5
+
+    /*
+        Bitmask key of the permutation
+
+        bits 0-4   Point light count (0 - 16)
+        bits 5-9   Spot light count (0 - 16)
+        bit  10    Shadows
+        bit  11    Normal mapping
+        bits 12-13 PCF kernel (0 = 1x1, 1 = 3x3, 2 = 5x5)
+    */
+    uint32_t GetKey() const;
+
+    string GetDefines() const;
+};
+
+class ShaderVariants
+{
+public:
+
+    ShaderVariants();
+    ShaderVariants(const char *vertexLocation, const char *fragmentLocation);
+
+    // The programs are owned, moved along but never copied
+    ShaderVariants(ShaderVariants&& other);
+    ShaderVariants& operator=(ShaderVariants&& other);
+
+    // Returns the program for these features, compiling it the first time it is asked for
+    Shader* GetVariant(const ShaderFeatures& features);
+
+    size_t GetVariantCount() { return variants.size(); }
+
+    void ClearVariants();
+
+    ~ShaderVariants();
+
+private:
+
+    ShaderVariants(const ShaderVariants&) = delete;
+    ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+    string vertexSource, fragmentSource;
+
+    std::unordered_map<uint32_t, Shader*> variants;
+};
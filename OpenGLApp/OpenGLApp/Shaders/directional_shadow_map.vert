@@ -2,7 +2,15 @@
 
 layout (location = 0) in vec3 position;
 
-uniform mat4 model; // Converts the position of the LIGHT to WORLD Space
+// Filled once per frame by PerDrawBuffer
+layout (std140) uniform PerDraw
+{
+    mat4 model;     // Converts the position of the LIGHT to WORLD Space
+    mat4 normalMatrix;
+    mat4 mvp;
+    ivec4 textureLayers;
+    vec4 virtualRegion;
+};
 uniform mat4 directionalLightTransform;    // Projection * View
 
 void main()
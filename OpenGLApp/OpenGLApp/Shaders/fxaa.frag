@@ -0,0 +1,156 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D inputTexture;
+uniform vec2 texelSize;
+uniform vec2 uvClamp;           // Last texel centre of the render size corner
+
+// Contrast a pixel needs to be treated as an edge, absolute and relative to its brightest neighbour
+const float EDGE_THRESHOLD_MIN = 0.0312;
+const float EDGE_THRESHOLD_MAX = 0.125;
+
+// How much single pixel details (thin lines, specular dots) get smoothed
+const float SUBPIXEL_QUALITY = 0.75;
+
+// Steps along the edge to find its ends, taking bigger strides further out
+const int SEARCH_STEPS = 12;
+const float SEARCH_STRIDES[12] = float[](1.0, 1.0, 1.0, 1.0, 1.0, 1.5, 2.0, 2.0, 2.0, 2.0, 4.0, 8.0);
+
+// Bilinear, kept inside the part of the input the scene was drawn in
+vec3 SampleInput(vec2 uv)
+{
+    return texture(inputTexture, clamp(uv, 0.5 * texelSize, uvClamp)).rgb;
+}
+
+// Of the gamma corrected colour, close enough to what the eye sees
+float Luma(vec3 colour)
+{
+    return dot(colour, vec3(0.299, 0.587, 0.114));
+}
+
+float LumaAt(vec2 uv)
+{
+    return Luma(SampleInput(uv));
+}
+
+// FXAA 3.11 quality: finds the edge through the pixel and its ends, then moves the sample across it
+void main()
+{
+    vec3 colour = SampleInput(TexCoords);
+
+    float lumaCentre = Luma(colour);
+    float lumaDown = LumaAt(TexCoords + vec2(0.0, -texelSize.y));
+    float lumaUp = LumaAt(TexCoords + vec2(0.0, texelSize.y));
+    float lumaLeft = LumaAt(TexCoords + vec2(-texelSize.x, 0.0));
+    float lumaRight = LumaAt(TexCoords + vec2(texelSize.x, 0.0));
+
+    float lumaMin = min(lumaCentre, min(min(lumaDown, lumaUp), min(lumaLeft, lumaRight)));
+    float lumaMax = max(lumaCentre, max(max(lumaDown, lumaUp), max(lumaLeft, lumaRight)));
+    float lumaRange = lumaMax - lumaMin;
+
+    // Flat enough, most pixels leave here
+    if (lumaRange < max(EDGE_THRESHOLD_MIN, lumaMax * EDGE_THRESHOLD_MAX))
+    {
+        FragColor = vec4(colour, 1.0);
+        return;
+    }
+
+    float lumaDownLeft = LumaAt(TexCoords - texelSize);
+    float lumaUpRight = LumaAt(TexCoords + texelSize);
+    float lumaUpLeft = LumaAt(TexCoords + vec2(-texelSize.x, texelSize.y));
+    float lumaDownRight = LumaAt(TexCoords + vec2(texelSize.x, -texelSize.y));
+
+    float lumaDownUp = lumaDown + lumaUp;
+    float lumaLeftRight = lumaLeft + lumaRight;
+    float lumaLeftCorners = lumaDownLeft + lumaUpLeft;
+    float lumaDownCorners = lumaDownLeft + lumaDownRight;
+    float lumaRightCorners = lumaDownRight + lumaUpRight;
+    float lumaUpCorners = lumaUpRight + lumaUpLeft;
+
+    // Which way the edge runs, from the second derivative across each axis
+    float edgeHorizontal = abs(-2.0 * lumaLeft + lumaLeftCorners) + abs(-2.0 * lumaCentre + lumaDownUp) * 2.0 + abs(-2.0 * lumaRight + lumaRightCorners);
+    float edgeVertical = abs(-2.0 * lumaUp + lumaUpCorners) + abs(-2.0 * lumaCentre + lumaLeftRight) * 2.0 + abs(-2.0 * lumaDown + lumaDownCorners);
+    bool horizontal = edgeHorizontal >= edgeVertical;
+
+    // Which side of the pixel the edge is on
+    float luma1 = horizontal ? lumaDown : lumaLeft;
+    float luma2 = horizontal ? lumaUp : lumaRight;
+    float gradient1 = luma1 - lumaCentre;
+    float gradient2 = luma2 - lumaCentre;
+
+    bool steepest1 = abs(gradient1) >= abs(gradient2);
+    float gradientScaled = 0.25 * max(abs(gradient1), abs(gradient2));
+
+    float stepLength = horizontal ? texelSize.y : texelSize.x;
+    float lumaLocalAverage = 0.0;
+
+    if (steepest1)
+    {
+        stepLength = -stepLength;
+        lumaLocalAverage = 0.5 * (luma1 + lumaCentre);
+    }
+    else
+    {
+        lumaLocalAverage = 0.5 * (luma2 + lumaCentre);
+    }
+
+    // Walks along the edge, half a texel over so the bilinear taps average both sides of it
+    vec2 edgeUv = TexCoords;
+    if (horizontal) edgeUv.y += stepLength * 0.5;
+    else edgeUv.x += stepLength * 0.5;
+
+    vec2 offset = horizontal ? vec2(texelSize.x, 0.0) : vec2(0.0, texelSize.y);
+    vec2 uv1 = edgeUv - offset;
+    vec2 uv2 = edgeUv + offset;
+
+    float lumaEnd1 = LumaAt(uv1) - lumaLocalAverage;
+    float lumaEnd2 = LumaAt(uv2) - lumaLocalAverage;
+    bool reached1 = abs(lumaEnd1) >= gradientScaled;
+    bool reached2 = abs(lumaEnd2) >= gradientScaled;
+
+    if (!reached1) uv1 -= offset;
+    if (!reached2) uv2 += offset;
+
+    for (int i = 2; i < SEARCH_STEPS && !(reached1 && reached2); i++)
+    {
+        if (!reached1)
+        {
+            lumaEnd1 = LumaAt(uv1) - lumaLocalAverage;
+            reached1 = abs(lumaEnd1) >= gradientScaled;
+            if (!reached1) uv1 -= offset * SEARCH_STRIDES[i];
+        }
+
+        if (!reached2)
+        {
+            lumaEnd2 = LumaAt(uv2) - lumaLocalAverage;
+            reached2 = abs(lumaEnd2) >= gradientScaled;
+            if (!reached2) uv2 += offset * SEARCH_STRIDES[i];
+        }
+    }
+
+    float distance1 = horizontal ? TexCoords.x - uv1.x : TexCoords.y - uv1.y;
+    float distance2 = horizontal ? uv2.x - TexCoords.x : uv2.y - TexCoords.y;
+    bool nearer1 = distance1 < distance2;
+
+    // Closer to the end of the edge, further across it
+    float pixelOffset = 0.5 - min(distance1, distance2) / (distance1 + distance2);
+
+    // Only when the nearer end goes the same way as the centre, otherwise it's the wrong side of a corner
+    bool centreSmaller = lumaCentre < lumaLocalAverage;
+    bool correctVariation = ((nearer1 ? lumaEnd1 : lumaEnd2) < 0.0) != centreSmaller;
+    float finalOffset = correctVariation ? pixelOffset : 0.0;
+
+    // Pixels that differ from all their neighbours get blurred a bit whatever the edge says
+    float lumaAverage = (1.0 / 12.0) * (2.0 * (lumaDownUp + lumaLeftRight) + lumaLeftCorners + lumaRightCorners);
+    float subPixelOffset = clamp(abs(lumaAverage - lumaCentre) / lumaRange, 0.0, 1.0);
+    subPixelOffset = (-2.0 * subPixelOffset + 3.0) * subPixelOffset * subPixelOffset;
+    finalOffset = max(finalOffset, subPixelOffset * subPixelOffset * SUBPIXEL_QUALITY);
+
+    vec2 finalUv = TexCoords;
+    if (horizontal) finalUv.y += finalOffset * stepLength;
+    else finalUv.x += finalOffset * stepLength;
+
+    FragColor = vec4(SampleInput(finalUv), 1.0);
+}
@@ -2,28 +2,18 @@
 out vec4 FragColor;
 
 in vec2 TexCoords;
+in vec2 ScreenCoords;
 
-uniform sampler2D hdrBuffer;
-uniform bool hdr;
-uniform float exposure;
+uniform sampler2D inputTexture;
+
+// Template of the fused per-pixel effects, PostProcessStack fills in the two markers
+// POST_UNIFORMS
 
 void main()
 {             
-    const float gamma = 2.2;
-    vec3 hdrColor = texture(hdrBuffer, TexCoords).rgb;
-    if(hdr)
-    {
-        // reinhard
-        // vec3 result = hdrColor / (hdrColor + vec3(1.0));
-        // exposure
-        vec3 result = vec3(1.0) - exp(-hdrColor * exposure);
-        // also gamma correct while we're at it       
-        result = pow(result, vec3(1.0 / gamma));
-        FragColor = vec4(result, 1.0);
-    }
-    else
-    {
-        vec3 result = pow(hdrColor, vec3(1.0 / gamma));
-        FragColor = vec4(result, 1.0);
-    }
-}
\ No newline at end of file
+    vec4 colour = texture(inputTexture, TexCoords);
+
+// POST_EFFECTS
+
+    FragColor = vec4(colour.rgb, 1.0);
+}
@@ -1,11 +1,17 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec2 aTexCoords;
 
 out vec2 TexCoords;
+out vec2 ScreenCoords;           // 0..1 over the screen, whatever uvScale is
 
+// Part of the input the scene was drawn in, 1 at full resolution
+uniform vec2 uvScale;
+
+// One triangle covering the screen, no vertex buffer needed
 void main()
 {
-    TexCoords = aTexCoords;
-    gl_Position = vec4(aPos, 1.0);
-}
\ No newline at end of file
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+
+    TexCoords = corner * uvScale;
+    ScreenCoords = corner;
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -2,6 +2,8 @@
 
 in vec4 vColor;
 in vec2 TexCoord0;
+flat in ivec3 TextureLayers;
+flat in vec4 VirtualRegion;
 in vec2 NormalMap;
 in vec3 Normal;
 in vec3 FragPos;
@@ -13,6 +15,35 @@ out vec4 colour;
 const int MAX_POINT_LIGHTS = 16;
 const int MAX_SPOT_LIGHTS  = 16;
 
+// Permutation features (injected by ShaderVariants). The defaults keep the
+// file usable as a plain shader with the old runtime behaviour.
+#ifdef NUM_POINT_LIGHTS
+	#define POINT_LIGHT_COUNT NUM_POINT_LIGHTS
+#else
+	#define POINT_LIGHT_COUNT pointLightCount
+#endif
+
+#ifdef NUM_SPOT_LIGHTS
+	#define SPOT_LIGHT_COUNT NUM_SPOT_LIGHTS
+#else
+	#define SPOT_LIGHT_COUNT spotLightCount
+#endif
+
+#ifndef SHADOWS_ENABLED
+	#define SHADOWS_ENABLED 1
+#endif
+
+#ifndef NORMAL_MAPPING
+	#define NORMAL_MAPPING 0
+#endif
+
+#ifndef PCF_KERNEL_SIZE
+	#define PCF_KERNEL_SIZE 3
+#endif
+
+// Albedo textures are stored with this gamma
+const float SRGB_GAMMA = 2.2;
+
 struct Light
 {
 	vec3 colour;
@@ -63,6 +94,22 @@ uniform SpotLight spotLights[MAX_SPOT_LIGHTS];
 
 uniform sampler2D theTexture;
 uniform sampler2D normalMapTexture;
+
+// Models with texture arrays pick their layer from the per-draw data
+uniform sampler2DArray albedoArray;
+uniform sampler2DArray normalArray;
+uniform sampler2DArray materialArray;
+
+// Channel packed by MaterialPacker: R = occlusion, G = roughness, B = metalness, A = height
+uniform sampler2D materialMapTexture;
+
+// Virtual texturing, the page sizes are the same as in Config.h
+const float VT_PAGE_SIZE = 128.0;
+const float VT_PAGE_BORDER = 4.0;
+
+uniform sampler2D virtualPageTable;     // xy = physical page, z = level of that page
+uniform sampler2D virtualPageCache;
+
 uniform sampler2D directionalShadowMap;
 uniform OmniShadowMap omniShadowMaps[MAX_POINT_LIGHTS + MAX_SPOT_LIGHTS];
 
@@ -70,7 +117,11 @@ uniform Material material;
 
 uniform vec3 eyePosition;
 
-uniform float gamma;
+// Normal used by the lighting, from the vertex or from the Normal Map
+vec3 surfaceNormal;
+
+// Occlusion, roughness, metalness and height of the fragment
+vec4 surfaceMaterial;
 
 
 vec3 gridSamplingDisk[20] = vec3[]
@@ -83,6 +134,49 @@ vec3 gridSamplingDisk[20] = vec3[]
 );
 
 
+vec4 SampleVirtualTexture(vec2 uv)
+{
+	float regionTexels = VirtualRegion.z * VT_PAGE_SIZE;
+
+	// Level from the derivatives before the wrap, so the seam doesn't jump to the coarsest one
+	vec2 texelDx = dFdx(uv) * regionTexels;
+	vec2 texelDy = dFdy(uv) * regionTexels;
+	float level = clamp(floor(0.5 * log2(max(dot(texelDx, texelDx), dot(texelDy, texelDy)))), 0.0, VirtualRegion.w);
+
+	vec2 texel = fract(uv) * regionTexels;
+	ivec2 page = (ivec2(VirtualRegion.xy) + ivec2(texel / VT_PAGE_SIZE)) >> int(level);
+	vec3 entry = texelFetch(virtualPageTable, page, int(level)).xyz * 255.0;
+
+	// The entry may point to a coarser page while the wanted one streams in
+	vec2 pageTexel = mod(texel / exp2(entry.z), VT_PAGE_SIZE);
+	vec2 cacheTexel = entry.xy * (VT_PAGE_SIZE + 2.0 * VT_PAGE_BORDER) + VT_PAGE_BORDER + pageTexel;
+
+	return textureLod(virtualPageCache, cacheTexel / vec2(textureSize(virtualPageCache, 0)), 0.0);
+}
+
+#if NORMAL_MAPPING
+vec3 CalcNormalFromMap()
+{
+	// Normal maps are cooked to BC5 (X and Y only), so Z is rebuilt
+	vec3 tangentNormal;
+	vec2 normalSample = (TextureLayers.y >= 0) ? texture(normalArray, vec3(TexCoord0, TextureLayers.y)).rg
+	                                           : texture(normalMapTexture, TexCoord0).rg;
+	tangentNormal.xy = normalSample * 2.0 - 1.0;
+	tangentNormal.z = sqrt(max(1.0 - dot(tangentNormal.xy, tangentNormal.xy), 0.0));
+	vec3 Q1 = dFdx(FragPos);
+	vec3 Q2 = dFdy(FragPos);
+	vec2 st1 = dFdx(TexCoord0);
+	vec2 st2 = dFdy(TexCoord0);
+
+	vec3 N = normalize(Normal);
+
+	vec3 T = normalize(Q1 * st2.t - Q2 * st1.t);
+	vec3 B = -normalize(cross(N, T));
+	mat3 TBN = mat3(T, B, N);
+	return normalize(TBN * tangentNormal);
+}
+#endif
+
 float CalcDirectionalShadowFactor(DirectionalLight light)
 {
 	vec3 projCoords = DirectionalLightSpacePos.xyz / DirectionalLightSpacePos.w; // Getting the coordinate system (w is the Forth value)
@@ -95,19 +189,20 @@ float CalcDirectionalShadowFactor(DirectionalLight light)
 	
 	float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.0005);
 
+	const int pcfRadius = PCF_KERNEL_SIZE / 2;
 	
 	float shadow = 0.0;
 	vec2 texelSize = 1.0 / textureSize(directionalShadowMap, 0);
-	for(int x = -1; x <= 1; ++x)
+	for(int x = -pcfRadius; x <= pcfRadius; ++x)
 	{
-		for(int y = -1; y <= 1; ++y)
+		for(int y = -pcfRadius; y <= pcfRadius; ++y)
 		{
 			float pcfDepth = texture(directionalShadowMap, projCoords.xy + vec2(x,y) * texelSize).r;
 			shadow += current - bias > pcfDepth ? 1.0 : 0.0;
 		}
 	}
 
-	shadow /= 9.0;
+	shadow /= float(PCF_KERNEL_SIZE * PCF_KERNEL_SIZE);
 	
 	if(projCoords.z > 1.0)
 	{
@@ -124,14 +219,22 @@ float CalcOmniShadowFactor(PointLight light, int shadowIndex)
 
 	float shadow = 0.0;
 	float bias = 0.05;
-	int samples = 20;
+
+	// A single tap when PCF is off, the sampling disk otherwise
+#if PCF_KERNEL_SIZE > 1
+	const int samples = 20;
+	const float diskScale = 1.0;
+#else
+	const int samples = 1;
+	const float diskScale = 0.0;
+#endif
 
 	float viewDistance = length(eyePosition - FragPos);
 	float diskRadius = (1.0 + (viewDistance/omniShadowMaps[shadowIndex].farPlane)) / 25.0;
 
 	for( int i = 0; i < samples; i++ )
 	{
-		float closestDepth = texture(omniShadowMaps[shadowIndex].shadowMap, fragToLight + gridSamplingDisk[i] * diskRadius).r;
+		float closestDepth = texture(omniShadowMaps[shadowIndex].shadowMap, fragToLight + gridSamplingDisk[i] * diskRadius * diskScale).r;
 		closestDepth *= omniShadowMaps[shadowIndex].farPlane;
 
 		if(currentDepth - bias > closestDepth)
@@ -147,13 +250,13 @@ float CalcOmniShadowFactor(PointLight light, int shadowIndex)
 
 vec4 CalcLightByDirection(Light light, vec3 direction, float shadowFactor)
 {
-	vec4 ambientColour = vec4(light.colour, 1.0f) * light.ambientIntensity;
+	vec4 ambientColour = vec4(light.colour, 1.0f) * light.ambientIntensity * surfaceMaterial.r;
 
 	// Result of the angle of the light in the object
 	// A * B = |A||B|cos(angle)
 	// max() so the light on angles too big don't show
-	float diffuseFactor = max(dot(normalize(Normal), normalize(direction)), 0.0f);
-	vec4 diffuseColour = vec4(light.colour * light.diffuseIntensity * diffuseFactor, 1.0f);
+	float diffuseFactor = max(dot(surfaceNormal, normalize(direction)), 0.0f);
+	vec4 diffuseColour = vec4(light.colour * light.diffuseIntensity * diffuseFactor * (1.0 - surfaceMaterial.b), 1.0f);
 
 	vec4 specularColour = vec4(0, 0, 0, 0);
 
@@ -161,14 +264,14 @@ vec4 CalcLightByDirection(Light light, vec3 direction, float shadowFactor)
 	if( diffuseFactor > 0.0f )
 	{
 		vec3 fragToEye = normalize(eyePosition - FragPos);
-		vec3 reflectedVertex = normalize(reflect(direction, normalize(Normal)));
+		vec3 reflectedVertex = normalize(reflect(direction, surfaceNormal));
 
 		float specularFactor = dot(fragToEye, reflectedVertex);
 
 		if( specularFactor > 0.0f )
 		{
 			specularFactor = pow(specularFactor, material.shininess);
-			specularColour = vec4(light.colour * material.specularIntensity * specularFactor, 1.0f);
+			specularColour = vec4(light.colour * material.specularIntensity * (1.0 - surfaceMaterial.g) * specularFactor, 1.0f);
 		}
 	}
 
@@ -177,7 +280,11 @@ vec4 CalcLightByDirection(Light light, vec3 direction, float shadowFactor)
 
 vec4 CalcDirectionalLight()
 {
+#if SHADOWS_ENABLED
 	float shadowFactor = CalcDirectionalShadowFactor(directionalLight);
+#else
+	float shadowFactor = 0.0;
+#endif
 	return CalcLightByDirection(directionalLight.base, directionalLight.direction, shadowFactor);
 }
 
@@ -187,7 +294,11 @@ vec4 CalcPointLight(PointLight pLight, int shadowIndex)
 	float distance = length(direction);
 	direction = normalize(direction);
 
+#if SHADOWS_ENABLED
 	float shadowFactor = CalcOmniShadowFactor(pLight, shadowIndex);
+#else
+	float shadowFactor = 0.0;
+#endif
 
 	vec4 colour = CalcLightByDirection(pLight.base, direction, shadowFactor);
 	// float attenuation = pLight.exponent * distance * distance + pLight.linear * distance + pLight.constant; // AX^2 + BX + C
@@ -219,7 +330,7 @@ vec4 CalcPointLights()
 {
 	vec4 totalColour = vec4(0, 0, 0, 0);
 
-	for(int i = 0; i < pointLightCount; i++)
+	for(int i = 0; i < POINT_LIGHT_COUNT; i++)
 	{
 		totalColour += CalcPointLight(pointLights[i], i);
 	}
@@ -231,9 +342,9 @@ vec4 CalcSpotLights()
 {
 	vec4 totalColour = vec4(0, 0, 0, 0);
 
-	for(int i = 0; i < spotLightCount; i++)
+	for(int i = 0; i < SPOT_LIGHT_COUNT; i++)
 	{
-		totalColour += CalcSpotLight(spotLights[i], i + pointLightCount);
+		totalColour += CalcSpotLight(spotLights[i], i + POINT_LIGHT_COUNT);
 	}
 
 	return totalColour;
@@ -241,15 +352,32 @@ vec4 CalcSpotLights()
 
 void main() 
 {
+#if NORMAL_MAPPING
+	surfaceNormal = CalcNormalFromMap();
+#else
+	surfaceNormal = normalize(Normal);
+#endif
+
+	// Occlusion, roughness and metalness in one fetch. Materials without maps get (1, 0, 0, 0)
+	surfaceMaterial = (TextureLayers.z >= 0) ? texture(materialArray, vec3(TexCoord0, TextureLayers.z))
+	                                         : texture(materialMapTexture, TexCoord0);
+
 	vec4 finalColour = CalcDirectionalLight();
 	finalColour += CalcPointLights();
 	finalColour += CalcSpotLights();
 
-	//HDR tone mapping
-	finalColour = finalColour / (finalColour + vec4(1.0));
+	vec4 albedo;
+
+	if (VirtualRegion.z > 0.0)
+		albedo = SampleVirtualTexture(TexCoord0);
+	else if (TextureLayers.x >= 0)
+		albedo = texture(albedoArray, vec3(TexCoord0, TextureLayers.x));
+	else
+		albedo = texture(theTexture, TexCoord0);
 
-	// Gamma correction
-    finalColour.rgb = pow(finalColour.rgb, vec3(1.0 / gamma));
+	// Textures are stored gamma corrected, the light adds up in linear space
+	albedo.rgb = pow(albedo.rgb, vec3(SRGB_GAMMA));
 
-	colour = texture(theTexture, TexCoord0) * finalColour;
+	// Linear HDR, tone mapping and gamma are resolved once per pixel in post-processing.frag
+	colour = albedo * finalColour;
 }
\ No newline at end of file
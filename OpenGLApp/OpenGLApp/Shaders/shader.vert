@@ -11,24 +11,35 @@ out vec3 Normal; // Adicionando a saída das coordenadas das normais
 
 out vec4 DirectionalLightSpacePos;
 
-uniform mat4 model;
-uniform mat4 projection;
-uniform mat4 view;
+flat out ivec3 TextureLayers;
+flat out vec4 VirtualRegion;
+
+// Filled once per frame by PerDrawBuffer
+layout (std140) uniform PerDraw
+{
+	mat4 model;
+	mat4 normalMatrix;
+	mat4 mvp;
+	ivec4 textureLayers;    // x = albedo layer, y = normal layer, z = material map layer, -1 without texture arrays
+	vec4 virtualRegion;     // xy = first page, z = pages across, w = coarsest level. -1 without one
+};
 
 uniform mat4 directionalLightTransform;    // Projection * View
 
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(position, 1.0);
+	gl_Position = mvp * vec4(position, 1.0);
 	DirectionalLightSpacePos = directionalLightTransform * model * vec4(position, 1.0);
 
 	vColor = vec4(clamp(position, 0.0f, 1.0f), 1.0f);
 
 	TexCoord0 = texture;
+	TextureLayers = textureLayers.xyz;
+	VirtualRegion = virtualRegion;
 
 	FragPos = (model * vec4(position, 1.0)).xyz;
 
 	// Calcula as coordenadas das normais do modelo
-    Normal = mat3(transpose(inverse(model))) * norm;
+    Normal = mat3(normalMatrix) * norm;
 }
\ No newline at end of file
@@ -6,8 +6,11 @@ out vec4 colour;
 
 uniform samplerCube skybox;
 
+// The faces are stored gamma corrected, the HDR target is linear
+const float SRGB_GAMMA = 2.2;
 
 void main()
 {
     colour = texture(skybox, TexCoords);
+    colour.rgb = pow(colour.rgb, vec3(SRGB_GAMMA));
 }
\ No newline at end of file
@@ -0,0 +1,56 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2D inputTexture;     // Colour, from before the edges pass
+uniform sampler2D blendTexture;     // Weights from smaa_weights.frag
+uniform vec2 texelSize;
+uniform vec2 uvClamp;               // Last texel centre of the render size corner
+
+vec4 WeightsAt(ivec2 texel, ivec2 lastTexel)
+{
+    if (any(greaterThan(texel, lastTexel))) return vec4(0.0);
+
+    return texelFetch(blendTexture, texel, 0);
+}
+
+vec3 ColourAt(ivec2 texel, ivec2 lastTexel)
+{
+    return texelFetch(inputTexture, clamp(texel, ivec2(0), lastTexel), 0).rgb;
+}
+
+// SMAA 1x, last pass: mixes each pixel with the neighbours its edges and theirs gave it a share of
+void main()
+{
+    ivec2 lastTexel = ivec2(uvClamp / texelSize);
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+
+    vec4 weights = WeightsAt(texel, lastTexel);
+
+    float fromBelow = weights.x;
+    float fromAbove = WeightsAt(texel + ivec2(0, 1), lastTexel).y;
+    float fromLeft = weights.z;
+    float fromRight = WeightsAt(texel + ivec2(1, 0), lastTexel).w;
+
+    vec3 colour = ColourAt(texel, lastTexel);
+
+    float vertical = fromBelow + fromAbove;
+    float horizontal = fromLeft + fromRight;
+
+    if (vertical + horizontal == 0.0)
+    {
+        FragColor = vec4(colour, 1.0);
+        return;
+    }
+
+    // Along one axis only, the stronger one
+    if (vertical >= horizontal)
+    {
+        colour = colour * (1.0 - vertical) + ColourAt(texel - ivec2(0, 1), lastTexel) * fromBelow + ColourAt(texel + ivec2(0, 1), lastTexel) * fromAbove;
+    }
+    else
+    {
+        colour = colour * (1.0 - horizontal) + ColourAt(texel - ivec2(1, 0), lastTexel) * fromLeft + ColourAt(texel + ivec2(1, 0), lastTexel) * fromRight;
+    }
+
+    FragColor = vec4(colour, 1.0);
+}
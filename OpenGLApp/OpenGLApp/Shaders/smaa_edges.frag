@@ -0,0 +1,53 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2D inputTexture;
+uniform vec2 texelSize;
+uniform vec2 uvClamp;           // Last texel centre of the render size corner
+
+// Luma difference that makes an edge
+const float EDGE_THRESHOLD = 0.1;
+
+// An edge is dropped when a neighbouring one is this many times stronger, it's part of a bigger one
+const float LOCAL_CONTRAST_FACTOR = 2.0;
+
+float LumaAt(ivec2 texel, ivec2 lastTexel)
+{
+    vec3 colour = texelFetch(inputTexture, clamp(texel, ivec2(0), lastTexel), 0).rgb;
+    return dot(colour, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// SMAA 1x, first pass: luma edges on the left (r) and bottom (g) side of each pixel
+void main()
+{
+    ivec2 lastTexel = ivec2(uvClamp / texelSize);
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+
+    float luma = LumaAt(texel, lastTexel);
+    float lumaLeft = LumaAt(texel + ivec2(-1, 0), lastTexel);
+    float lumaBottom = LumaAt(texel + ivec2(0, -1), lastTexel);
+
+    vec2 delta = abs(luma - vec2(lumaLeft, lumaBottom));
+    vec2 edges = step(EDGE_THRESHOLD, delta);
+
+    // The target isn't cleared, every pixel writes
+    if (edges.x == 0.0 && edges.y == 0.0)
+    {
+        FragColor = vec4(0.0);
+        return;
+    }
+
+    float lumaRight = LumaAt(texel + ivec2(1, 0), lastTexel);
+    float lumaTop = LumaAt(texel + ivec2(0, 1), lastTexel);
+    float lumaLeftLeft = LumaAt(texel + ivec2(-2, 0), lastTexel);
+    float lumaBottomBottom = LumaAt(texel + ivec2(0, -2), lastTexel);
+
+    // Strongest edge around, along both axes
+    vec2 maxDelta = max(delta, abs(luma - vec2(lumaRight, lumaTop)));
+    maxDelta = max(maxDelta, abs(vec2(lumaLeft, lumaBottom) - vec2(lumaLeftLeft, lumaBottomBottom)));
+    float finalDelta = max(maxDelta.x, maxDelta.y);
+
+    edges *= step(finalDelta, LOCAL_CONTRAST_FACTOR * delta);
+
+    FragColor = vec4(edges, 0.0, 1.0);
+}
@@ -0,0 +1,109 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2D inputTexture;     // Edges from smaa_edges.frag
+uniform vec2 texelSize;
+uniform vec2 uvClamp;               // Last texel centre of the render size corner
+
+// Pixels searched along an edge each way, longer ones are treated as straight
+const int MAX_SEARCH_STEPS = 16;
+
+vec2 EdgesAt(ivec2 texel, ivec2 lastTexel)
+{
+    // No edges outside the picture, so the runs end at its border
+    if (any(lessThan(texel, ivec2(0))) || any(greaterThan(texel, lastTexel))) return vec2(0.0);
+
+    return texelFetch(inputTexture, texel, 0).rg;
+}
+
+// Pixels the edge goes on past this one in a direction
+int SearchEdge(ivec2 texel, ivec2 direction, int channel, ivec2 lastTexel)
+{
+    int steps = 0;
+
+    for (int i = 0; i < MAX_SEARCH_STEPS; i++)
+    {
+        if (EdgesAt(texel + direction * (steps + 1), lastTexel)[channel] < 0.5) break;
+        steps++;
+    }
+
+    return steps;
+}
+
+// Where the silhouette is at an end of the edge: half a pixel towards the side the crossing edge is on,
+// on the edge when there's none or both
+float EndHeight(float crossingPositive, float crossingNegative)
+{
+    return 0.5 * (step(0.5, crossingPositive) - step(0.5, crossingNegative));
+}
+
+// Signed area the silhouette cuts from this pixel, 0 to 1 along an edge running from -distance1 to
+// 1 + distance2. Like MLAA, each half of the edge is a line from the height at its end to the middle
+float Area(float distance1, float distance2, float height1, float height2)
+{
+    float start = -distance1;
+    float end = 1.0 + distance2;
+    float middle = 0.5 * (start + end);
+    float halfLength = middle - start;
+
+    float area = 0.0;
+
+    // First half, from height1 down to the edge
+    float a = 0.0;
+    float b = min(1.0, middle);
+    if (b > a) area += (b - a) * height1 * ((middle - a) + (middle - b)) * 0.5 / halfLength;
+
+    // Second half, from the edge up to height2
+    a = max(0.0, middle);
+    b = 1.0;
+    if (b > a) area += (b - a) * height2 * ((a - middle) + (b - middle)) * 0.5 / halfLength;
+
+    return area;
+}
+
+// SMAA 1x, second pass: how much each pixel takes from the neighbour across its left and bottom edges.
+// The area is worked out here rather than read from the precomputed area texture, and only the
+// horizontal and vertical patterns are handled, not the diagonal ones
+void main()
+{
+    ivec2 lastTexel = ivec2(uvClamp / texelSize);
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+
+    vec2 edges = EdgesAt(texel, lastTexel);
+    vec4 weights = vec4(0.0);
+
+    // Bottom edge: runs along x, positive is up, into this pixel
+    if (edges.g > 0.5)
+    {
+        int left = SearchEdge(texel, ivec2(-1, 0), 1, lastTexel);
+        int right = SearchEdge(texel, ivec2(1, 0), 1, lastTexel);
+
+        ivec2 leftEnd = texel - ivec2(left, 0);
+        ivec2 rightEnd = texel + ivec2(right + 1, 0);
+
+        float height1 = EndHeight(EdgesAt(leftEnd, lastTexel).r, EdgesAt(leftEnd - ivec2(0, 1), lastTexel).r);
+        float height2 = EndHeight(EdgesAt(rightEnd, lastTexel).r, EdgesAt(rightEnd - ivec2(0, 1), lastTexel).r);
+
+        float area = Area(float(left), float(right), height1, height2);
+        weights.xy = vec2(max(area, 0.0), max(-area, 0.0));
+    }
+
+    // Left edge: runs along y, positive is right, into this pixel
+    if (edges.r > 0.5)
+    {
+        int down = SearchEdge(texel, ivec2(0, -1), 0, lastTexel);
+        int up = SearchEdge(texel, ivec2(0, 1), 0, lastTexel);
+
+        ivec2 downEnd = texel - ivec2(0, down);
+        ivec2 upEnd = texel + ivec2(0, up + 1);
+
+        float height1 = EndHeight(EdgesAt(downEnd, lastTexel).g, EdgesAt(downEnd - ivec2(1, 0), lastTexel).g);
+        float height2 = EndHeight(EdgesAt(upEnd, lastTexel).g, EdgesAt(upEnd - ivec2(1, 0), lastTexel).g);
+
+        float area = Area(float(down), float(up), height1, height2);
+        weights.zw = vec2(max(area, 0.0), max(-area, 0.0));
+    }
+
+    // x: from below into this pixel, y: from this pixel into the one below, z and w the same with the left one
+    FragColor = weights;
+}
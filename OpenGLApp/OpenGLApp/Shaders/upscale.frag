@@ -0,0 +1,33 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D inputTexture;
+uniform vec2 texelSize;
+uniform vec2 uvClamp;           // Last texel centre of the render size corner
+uniform float sharpness;
+
+// Bilinear, kept inside the part of the input the scene was drawn in
+vec3 SampleInput(vec2 uv)
+{
+    return texture(inputTexture, clamp(uv, 0.5 * texelSize, uvClamp)).rgb;
+}
+
+// Bilinear upscale to the window, sharpened with the four neighbours
+void main()
+{             
+    vec3 centre = SampleInput(TexCoords);
+    vec3 north = SampleInput(TexCoords + vec2(0.0, texelSize.y));
+    vec3 south = SampleInput(TexCoords - vec2(0.0, texelSize.y));
+    vec3 east = SampleInput(TexCoords + vec2(texelSize.x, 0.0));
+    vec3 west = SampleInput(TexCoords - vec2(texelSize.x, 0.0));
+
+    vec3 sharpened = centre + (4.0 * centre - north - south - east - west) * (0.25 * sharpness);
+
+    // Inside the range of the neighbours, so edges don't get halos
+    vec3 lowest = min(centre, min(min(north, south), min(east, west)));
+    vec3 highest = max(centre, max(max(north, south), max(east, west)));
+
+    FragColor = vec4(clamp(sharpened, lowest, highest), 1.0);
+}
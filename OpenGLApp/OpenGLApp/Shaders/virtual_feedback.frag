@@ -0,0 +1,34 @@
+#version 330
+
+in vec2 TexCoord0;
+flat in vec4 VirtualRegion;
+
+out vec4 colour;
+
+// Same as Config.h
+const float VT_PAGE_SIZE = 128.0;
+
+// log2 of the feedback downscale, the derivatives are that much bigger than on screen
+uniform float feedbackBias;
+
+void main()
+{
+    // Still writes, so surfaces without a virtual texture hide the ones behind them
+    if (VirtualRegion.z <= 0.0)
+    {
+        colour = vec4(0.0);
+        return;
+    }
+
+    float regionTexels = VirtualRegion.z * VT_PAGE_SIZE;
+
+    // Same level as SampleVirtualTexture() in shader.frag
+    vec2 texelDx = dFdx(TexCoord0) * regionTexels;
+    vec2 texelDy = dFdy(TexCoord0) * regionTexels;
+    float level = clamp(floor(0.5 * log2(max(dot(texelDx, texelDx), dot(texelDy, texelDy))) - feedbackBias), 0.0, VirtualRegion.w);
+
+    // Virtual page on that level, read back by VirtualTexture
+    ivec2 page = (ivec2(VirtualRegion.xy) + ivec2(fract(TexCoord0) * VirtualRegion.z)) >> int(level);
+
+    colour = vec4(vec2(page), level, 255.0) / 255.0;
+}
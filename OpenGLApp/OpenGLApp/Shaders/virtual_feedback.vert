@@ -0,0 +1,25 @@
+#version 330
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec2 texture;
+
+out vec2 TexCoord0;
+flat out vec4 VirtualRegion;
+
+// Filled once per frame by PerDrawBuffer
+layout (std140) uniform PerDraw
+{
+    mat4 model;
+    mat4 normalMatrix;
+    mat4 mvp;
+    ivec4 textureLayers;
+    vec4 virtualRegion;
+};
+
+void main()
+{
+    gl_Position = mvp * vec4(position, 1.0);
+
+    TexCoord0 = texture;
+    VirtualRegion = virtualRegion;
+}
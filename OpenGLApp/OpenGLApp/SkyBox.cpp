@@ -10,9 +10,6 @@ SkyBox::SkyBox(vector<string> faceLocations, bool invertedTexture, bool hasAlpha
     skyShader = new Shader();
     skyShader->CreateFromFile("Shaders/skybox.vert", "Shaders/skybox.frag");
 
-    uniformProjection = skyShader->GetProjectionLocation();
-    uniformView = skyShader->GetViewLocation();
-
     // Texture setup
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
@@ -20,20 +17,29 @@ SkyBox::SkyBox(vector<string> faceLocations, bool invertedTexture, bool hasAlpha
     // bool invertedTexture = false;
     // bool hasAlpha = false;
 
-    int width, height, bitDepth;
-
-    if (invertedTexture)
-        stbi_set_flip_vertically_on_load(true);
+    int width, height;
 
     cerr << endl;
     cerr << "Loading Skybox..." << endl;
     cerr << "----------------------------------" << endl;
 
+    // The six decodes are independent and hold up the first frame, so they run on the job threads
+    unsigned char* faceData[6] = {};
+    int faceWidths[6] = {}, faceHeights[6] = {}, faceBitDepths[6] = {};
+
+    JobSystem::ParallelFor(6, [&](size_t i)
+    {
+        // Sets the per thread flip flag, so it's fine on any thread
+        faceData[i] = Texture::DecodeFile(faceLocations[i], invertedTexture, faceWidths[i], faceHeights[i], faceBitDepths[i]);
+    });
+
     for (size_t i = 0; i < 6; i++)
     {
         cerr << "Loading Skybox texture: " << faceLocations[i].c_str() << " [" << i + 1 << " of " << 6 << "]..." << endl;
 
-        unsigned char *texData = stbi_load(faceLocations[i].c_str(), &width, &height, &bitDepth, 0);
+        unsigned char *texData = faceData[i];
+        width = faceWidths[i];
+        height = faceHeights[i];
 
         if (!texData)
         {
@@ -102,6 +108,10 @@ void SkyBox::DrawSkybox(glm::mat4 viewMatrix, glm::mat4 projectionMatrix)
 
     skyShader->UseShader();
 
+    // Only known once the program is linked, which UseShader waits for
+    uniformProjection = skyShader->GetProjectionLocation();
+    uniformView = skyShader->GetViewLocation();
+
     // Setting the Projection Matrix
     glUniformMatrix4fv(uniformProjection, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
 
@@ -12,6 +12,8 @@
 #include "Config.h"
 #include "Shader.h"
 #include "Mesh.h"
+#include "Texture.h"
+#include "JobSystem.h"
 
 using std::vector;
 using std::string;
@@ -1,4 +1,5 @@
 #include "Texture.h"
+#include "AssetPack.h"
 
 using std::cerr;
 using std::cout;
@@ -11,6 +12,10 @@ Texture::Texture()
     width = 0;
     height = 0;
     bitDepth = 0;
+    internalFormat = 0;
+    levelCount = 0;
+    baseLevel = 0;
+    streamed = false;
     fileLocation = "";
 }
 
@@ -20,127 +25,208 @@ Texture::Texture(const char* _fileLocation)
     width = 0;
     height = 0;
     bitDepth = 0;
+    internalFormat = 0;
+    levelCount = 0;
+    baseLevel = 0;
+    streamed = false;
     fileLocation = _fileLocation;
 }
 
-bool Texture::LoadTexture(bool invertedTexture)
+unsigned char* Texture::DecodeFile(const string& fileLocation, bool invertedTexture, int32_t& width, int32_t& height, int32_t& bitDepth)
 {
-    if (invertedTexture) stbi_set_flip_vertically_on_load(true);
+    // The flip is per thread, so the loader workers don't fight over it
+    stbi_set_flip_vertically_on_load_thread(invertedTexture ? 1 : 0);
 
-    unsigned char* texData = stbi_load(fileLocation, &width, &height, &bitDepth, 0);
+    // Decoded straight from the pack or the mapped loose file, no copy of the file
+    AssetFile file;
+    if (!file.Open(fileLocation) || file.GetSize() > INT32_MAX) return nullptr;
 
-    cerr << "\n\tLoading texID: " << &textureID << " | " << textureID << endl;
-    cerr << "\tFile Location: "  << this->fileLocation << endl;
+    return stbi_load_from_memory(file.GetData(), (int)file.GetSize(), &width, &height, &bitDepth, 0);
+}
 
-    if( texData )
+bool Texture::UploadPixels(const void* pixels, int32_t imageWidth, int32_t imageHeight, int32_t imageBitDepth)
+{
+    GLenum format;
+    if (imageBitDepth == 1)
+        format = GL_RED;
+    else if (imageBitDepth == 2)
+        format = GL_RG;
+    else if (imageBitDepth == 3)
+        format = GL_RGB;
+    else if (imageBitDepth == 4)
+        format = GL_RGBA;
+    else
     {
-        GLenum format;
-        if (bitDepth == 1)
-            format = GL_RED;
-        else if (bitDepth == 3)
-            format = GL_RGB;
-        else if (bitDepth == 4)
-            format = GL_RGBA;
+        cerr << "\n\nERROR: Unsupported channel count " << imageBitDepth << " in " << fileLocation << ".\n" << endl;
+        return false;
+    }
 
-        // Generating the texture and giving it an ID
-        glGenTextures(1, &textureID);
+    width = imageWidth;
+    height = imageHeight;
+    bitDepth = imageBitDepth;
+    internalFormat = format;
 
-        // Binding
-        glBindTexture(GL_TEXTURE_2D, textureID);
+    // Full chain down to 1x1 from glGenerateMipmap
+    levelCount = 1;
+    for (int32_t size = (width > height ? width : height); size > 1; size /= 2) levelCount++;
 
-        // Setting the Texture
-        // Can be a problem with the texture. Make shure it's the right one here <GL_RGBA or GL_RGB>
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, texData);
+    // Generating the texture and giving it an ID. Placeholders already have one
+    if (textureID == 0) glGenTextures(1, &textureID);
 
-        // Create mipmaps automatically
-        glGenerateMipmap(GL_TEXTURE_2D);
+    // Binding
+    glBindTexture(GL_TEXTURE_2D, textureID);
 
-        // Setting parameters for this texture
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // Away from the image
-        // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // Closer to the image
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); // Away from the image
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST); // Closer to the image
+    // RGB rows aren't 4 byte aligned on odd widths
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-        // Texture loaded to the memory! UwU
+    // Setting the Texture. pixels is an offset when a pixel buffer is bound
+    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, pixels);
 
-        // Goodbye texture
-        glBindTexture(GL_TEXTURE_2D, 0);
-        stbi_image_free(texData);
-    }
-    else
-    {
-        cerr << "\n\nERROR: Failed to find the texture " << fileLocation << ".\n" << endl;
-        return false;
-    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    // Create mipmaps automatically
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    // Back to the defaults, a cooked upload may have changed them
+    baseLevel = 0;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+
+    // Setting parameters for this texture
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // Away from the image
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // Closer to the image
+    // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); // Away from the image
+    // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST); // Closer to the image
+
+    // Texture loaded to the memory! UwU
+
+    // Goodbye texture
+    glBindTexture(GL_TEXTURE_2D, 0);
 
     return true;
 }
 
-uint32_t Texture::LoadTextureID(bool invertedTexture)
+bool Texture::UploadCompressed(const CookedTexture& cooked, const uint8_t* blockData)
 {
-    if (invertedTexture)
-        stbi_set_flip_vertically_on_load(true);
+    width = cooked.width;
+    height = cooked.height;
+    bitDepth = 0;
+    internalFormat = cooked.GetGLFormat();
+    levelCount = (int32_t)cooked.levelSizes.size();
 
-    unsigned char *texData = stbi_load(fileLocation, &width, &height, &bitDepth, 0);
+    if (textureID == 0) glGenTextures(1, &textureID);
 
-    cerr << "\n\tLoading texID: " << &textureID << " | " << textureID << endl;
-    // cerr << "File Location: "  << this->fileLocation << endl;
+    glBindTexture(GL_TEXTURE_2D, textureID);
 
-    if (texData)
+    // The chain comes from the cooked file, no glGenerateMipmap
+    UploadCompressedLevels(cooked, blockData);
+
+    // Streamed textures start without their biggest levels
+    baseLevel = (int32_t)cooked.firstLevel;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, baseLevel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)cooked.levelSizes.size() - 1);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return true;
+}
+
+void Texture::UploadCompressedLevels(const CookedTexture& cooked, const uint8_t* blockData)
+{
+    for (uint32_t level = cooked.firstLevel; level < cooked.endLevel; level++)
     {
-        GLenum format;
-        if (bitDepth == 1)
-            format = GL_RED;
-        else if (bitDepth == 3)
-            format = GL_RGB;
-        else if (bitDepth == 4)
-            format = GL_RGBA;
+        glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, cooked.GetGLFormat(),
+                               cooked.GetLevelWidth(level), cooked.GetLevelHeight(level), 0,
+                               (GLsizei)cooked.levelSizes[level], blockData + cooked.levelOffsets[level]);
+    }
+}
 
-        // Generating the texture and giving it an ID
-        glGenTextures(1, &textureID);
+void Texture::StreamInLevels(const CookedTexture& cooked, const uint8_t* blockData)
+{
+    glBindTexture(GL_TEXTURE_2D, textureID);
 
-        // Binding
-        glBindTexture(GL_TEXTURE_2D, textureID);
+    UploadCompressedLevels(cooked, blockData);
 
-        // Setting the Texture
-        // Can be a problem with the texture. Make shure it's the right one here <GL_RGBA or GL_RGB>
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, texData);
+    // The new levels are only sampled once the base level moves down to them
+    if ((int32_t)cooked.firstLevel < baseLevel)
+    {
+        baseLevel = (int32_t)cooked.firstLevel;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, baseLevel);
+    }
 
-        // Create mipmaps automatically
-        glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
 
-        // Setting parameters for this texture
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // Away from the image
-        // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // Closer to the image
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); // Away from the image
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST); // Closer to the image
+void Texture::DropBaseLevel()
+{
+    if (baseLevel + 1 >= levelCount) return;
 
-        // Texture loaded to the memory! UwU
+    glBindTexture(GL_TEXTURE_2D, textureID);
 
-        // Goodbye texture
-        glBindTexture(GL_TEXTURE_2D, 0);
-        stbi_image_free(texData);
+    baseLevel++;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, baseLevel);
+
+    // A zero sized image gives the level's memory back (streamed textures are always compressed)
+    glCompressedTexImage2D(GL_TEXTURE_2D, baseLevel - 1, internalFormat, 0, 0, 0, 0, nullptr);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+bool Texture::LoadCookedTexture(uint32_t flags)
+{
+    CookedTexture cooked;
+
+    if (TextureCooker::IsSupported() && TextureCooker::LoadOrCook(fileLocation, flags, cooked))
+    {
+        return UploadCompressed(cooked, cooked.data.data());
     }
-    else
+
+    return LoadTextureID((flags & TEXTURE_FLIP_VERTICAL) != 0) != 0;
+}
+
+void Texture::CreatePlaceholder()
+{
+    // A single white texel until the real image arrives
+    const unsigned char white[4] = { 255, 255, 255, 255 };
+    UploadPixels(white, 1, 1, 4);
+}
+
+bool Texture::LoadTexture(bool invertedTexture)
+{
+    return LoadTextureID(invertedTexture) != 0;
+}
+
+uint32_t Texture::LoadTextureID(bool invertedTexture)
+{
+    int32_t imageWidth = 0, imageHeight = 0, imageBitDepth = 0;
+    unsigned char *texData = DecodeFile(fileLocation, invertedTexture, imageWidth, imageHeight, imageBitDepth);
+
+    cerr << "\n\tLoading texID: " << &textureID << " | " << textureID << endl;
+    cerr << "\tFile Location: "  << this->fileLocation << endl;
+
+    if (!texData)
     {
         cerr << "\n\nERROR: Failed to find the texture " << fileLocation << ".\n"
              << endl;
         return false;
     }
 
-    return textureID;
+    bool uploaded = UploadPixels(texData, imageWidth, imageHeight, imageBitDepth);
+    stbi_image_free(texData);
+
+    return uploaded ? textureID : 0;
 }
 
 uint32_t Texture::LoadTextureIDNormal(bool invertedTexture)
 {
-    if (invertedTexture)
-        stbi_set_flip_vertically_on_load(true);
-
-    unsigned char* texData = stbi_load(fileLocation, &width, &height, &bitDepth, 0);
+    unsigned char* texData = DecodeFile(fileLocation, invertedTexture, width, height, bitDepth);
 
     cerr << "\n\tLoading texID: " << &textureID << " | " << textureID << endl;
     // cerr << "File Location: "  << this->fileLocation << endl;
@@ -250,6 +336,10 @@ void Texture::ClearTexture()
     width = 0;
     height = 0;
     bitDepth = 0;
+    internalFormat = 0;
+    levelCount = 0;
+    baseLevel = 0;
+    streamed = false;
     fileLocation = "";
 }
 
@@ -1,12 +1,21 @@
 #pragma once
 
 #include <iostream>
+#include <string>
 
 #include <GL\glew.h>
 #include <assimp\Importer.hpp>
 #include <assimp\scene.h>
 
 #include "Config.h"
+#include "TextureCooker.h"
+
+enum TextureLoadFlags
+{
+    TEXTURE_FLIP_VERTICAL = 1 << 0,
+    TEXTURE_NORMAL_MAP = 1 << 1,        // Cooked as BC5, only X and Y are kept
+    TEXTURE_STREAMED = 1 << 2           // Starts with the small mips, TextureStreamer loads the rest
+};
 
 class Texture
 {
@@ -20,6 +29,27 @@ public:
     uint32_t LoadTextureID(bool invertedTexture);
     uint32_t LoadTextureIDNormal(bool invertedTexture);
     uint32_t LoadTextureID();
+
+    // Thread safe, the caller frees the pixels with stbi_image_free
+    static unsigned char* DecodeFile(const std::string& fileLocation, bool invertedTexture, int32_t& width, int32_t& height, int32_t& bitDepth);
+
+    // Creates or respecifies the texture. Needs the GL thread
+    bool UploadPixels(const void* pixels, int32_t imageWidth, int32_t imageHeight, int32_t imageBitDepth);
+    void CreatePlaceholder();
+
+    // Uses the block compressed copy of the file, cooking it on the first run. Falls back to LoadTextureID
+    bool LoadCookedTexture(uint32_t flags);
+
+    // blockData is an offset when a pixel buffer is bound
+    bool UploadCompressed(const CookedTexture& cooked, const uint8_t* blockData);
+
+    // Mip streaming, the levels under the base level are the ones that can be sampled
+    void StreamInLevels(const CookedTexture& cooked, const uint8_t* blockData);
+    void DropBaseLevel();
+    int32_t GetBaseLevel() { return baseLevel; }
+
+    bool IsStreamed() { return streamed; }
+    void SetStreamed(bool isStreamed) { streamed = isStreamed; }
     
     void UseTexture();
     void UseGL_TEXTURE(GLuint id);
@@ -27,7 +57,12 @@ public:
     void UsePBRTexture();
     void ClearTexture();
 
-    const char * GetFileLocation() { return fileLocation; }
+    const char * GetFileLocation() { return fileLocation.c_str(); }
+    GLuint GetTextureID() { return textureID; }
+    GLenum GetInternalFormat() { return internalFormat; }
+    int32_t GetWidth() { return width; }
+    int32_t GetHeight() { return height; }
+    int32_t GetLevelCount() { return levelCount; }
 
     ~Texture();
 
@@ -37,8 +72,18 @@ private:
     GLuint textureID;
     int32_t width, height, bitDepth;
 
+    // What the texture arrays need to know to take a copy
+    GLenum internalFormat;
+    int32_t levelCount;
+
+    int32_t baseLevel;
+    bool streamed;
+
+    void UploadCompressedLevels(const CookedTexture& cooked, const uint8_t* blockData);
+
 
-    const char* fileLocation;
+    // Owned copy, callers often pass a temporary string's c_str()
+    std::string fileLocation;
 
 };
 
@@ -0,0 +1,92 @@
+#include "TextureArray.h"
+
+TextureArray::TextureArray()
+{
+    arrayID = 0;
+    arrayWidth = 0;
+    arrayHeight = 0;
+    levelCount = 0;
+    layerCount = 0;
+}
+
+bool TextureArray::IsSupported()
+{
+    return (GLEW_VERSION_4_3 || GLEW_ARB_copy_image) ? true : false;
+}
+
+bool TextureArray::CreateArray(GLenum format, int32_t width, int32_t height, int32_t levels, int32_t layers)
+{
+    GLint maxLayers = 256;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+    if (layers > maxLayers)
+    {
+        cerr << "\n\nERROR: Texture array of " << layers << " layers is over the limit (" << maxLayers << ").\n" << endl;
+        return false;
+    }
+
+    arrayWidth = width;
+    arrayHeight = height;
+    levelCount = levels;
+    layerCount = layers;
+
+    glGenTextures(1, &arrayID);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, arrayID);
+
+    // Storage only, the layers are filled by CopyLayer
+    for (int32_t level = 0; level < levelCount; level++)
+    {
+        int32_t levelWidth = (width >> level) > 0 ? (width >> level) : 1;
+        int32_t levelHeight = (height >> level) > 0 ? (height >> level) : 1;
+
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, level, format, levelWidth, levelHeight, layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    return true;
+}
+
+void TextureArray::CopyLayer(GLuint sourceTexture, int32_t layer)
+{
+    for (int32_t level = 0; level < levelCount; level++)
+    {
+        int32_t levelWidth = (arrayWidth >> level) > 0 ? (arrayWidth >> level) : 1;
+        int32_t levelHeight = (arrayHeight >> level) > 0 ? (arrayHeight >> level) : 1;
+
+        glCopyImageSubData(sourceTexture, GL_TEXTURE_2D, level, 0, 0, 0,
+                           arrayID, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer,
+                           levelWidth, levelHeight, 1);
+    }
+}
+
+void TextureArray::UseArray(GLuint textureUnit)
+{
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, arrayID);
+}
+
+void TextureArray::ClearArray()
+{
+    if (arrayID != 0)
+    {
+        glDeleteTextures(1, &arrayID);
+        arrayID = 0;
+    }
+
+    arrayWidth = 0;
+    arrayHeight = 0;
+    levelCount = 0;
+    layerCount = 0;
+}
+
+TextureArray::~TextureArray()
+{
+    ClearArray();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <iostream>
+
+#include <GL\glew.h>
+
+#include "Config.h"
+
+using std::cerr;
+using std::endl;
+
+/*
+    GL_TEXTURE_2D_ARRAY of textures with the same size, format and mip count.
+
+    Layers are copied from textures that are already on the GPU
+    (glCopyImageSubData), so compressed and streamed textures work the same.
+*/
+class TextureArray
+{
+public:
+
+    TextureArray();
+
+    // Needs GL 4.3 or ARB_copy_image
+    static bool IsSupported();
+
+    bool CreateArray(GLenum format, int32_t width, int32_t height, int32_t levels, int32_t layers);
+
+    // Copies every mip level of the texture into the layer
+    void CopyLayer(GLuint sourceTexture, int32_t layer);
+
+    void UseArray(GLuint textureUnit);
+    void ClearArray();
+
+    int32_t GetLayerCount() { return layerCount; }
+
+    ~TextureArray();
+
+private:
+
+    GLuint arrayID;
+
+    int32_t arrayWidth, arrayHeight, levelCount, layerCount;
+};
@@ -0,0 +1,705 @@
+#include "TextureCooker.h"
+#include "Texture.h"
+#include "AssetPack.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fstream>
+
+#ifdef _WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#define STAT_STRUCT struct _stat64
+#define STAT_FUNCTION _stat64
+#else
+#include <sys/stat.h>
+#define STAT_STRUCT struct stat
+#define STAT_FUNCTION stat
+#endif
+
+using std::ifstream;
+using std::ofstream;
+
+// Legacy DDS header, enough for BC1/BC3/BC5 through FourCC codes
+struct DDSPixelFormat
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t rBitMask, gBitMask, bBitMask, aBitMask;
+};
+
+struct DDSHeader
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];     // [0] cook magic, [1] version, [2-3] source time, [4-5] source size, [6] size limit
+    DDSPixelFormat pixelFormat;
+    uint32_t caps, caps2, caps3, caps4;
+    uint32_t reserved2;
+};
+
+static const uint32_t DDS_MAGIC = 0x20534444;           // "DDS "
+static const uint32_t COOK_MAGIC = 0x494F414D;          // "MOAI"
+static const uint32_t COOK_VERSION = 1;
+
+static const uint32_t FOURCC_DXT1 = 0x31545844;
+static const uint32_t FOURCC_DXT5 = 0x35545844;
+static const uint32_t FOURCC_ATI2 = 0x32495441;
+
+static uint32_t GetBlockSize(CookedFormat format)
+{
+    return (format == COOKED_BC1) ? 8 : 16;
+}
+
+static size_t GetLevelSize(int32_t width, int32_t height, CookedFormat format)
+{
+    size_t blocksX = (width + 3) / 4;
+    size_t blocksY = (height + 3) / 4;
+
+    return blocksX * blocksY * GetBlockSize(format);
+}
+
+GLenum CookedTexture::GetGLFormat() const
+{
+    switch (format)
+    {
+    case COOKED_BC1:
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case COOKED_BC3:
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    default:
+        return GL_COMPRESSED_RG_RGTC2;
+    }
+}
+
+int32_t CookedTexture::GetLevelWidth(size_t level) const
+{
+    int32_t levelWidth = width >> level;
+    return levelWidth > 0 ? levelWidth : 1;
+}
+
+int32_t CookedTexture::GetLevelHeight(size_t level) const
+{
+    int32_t levelHeight = height >> level;
+    return levelHeight > 0 ? levelHeight : 1;
+}
+
+bool TextureCooker::IsSupported()
+{
+    // RGTC is core since 3.0, S3TC is still an extension
+    return GLEW_EXT_texture_compression_s3tc ? true : false;
+}
+
+string TextureCooker::GetCookedPath(const string& fileLocation, uint32_t flags)
+{
+    // The flags change the cooked data, so each combination gets its own file
+    string path = fileLocation;
+
+    if (flags & TEXTURE_NORMAL_MAP) path += ".n";
+    if (flags & TEXTURE_FLIP_VERTICAL) path += ".f";
+
+    return path + ".dds";
+}
+
+bool TextureCooker::GetSourceStamp(const string& fileLocation, uint64_t& modifiedTime, uint64_t& fileSize)
+{
+    // Packed files keep the stamp they had on disk, so their cooked files still match
+    if (AssetPack::GetStamp(fileLocation, modifiedTime, fileSize)) return true;
+
+    STAT_STRUCT fileInfo;
+
+    if (STAT_FUNCTION(fileLocation.c_str(), &fileInfo) != 0) return false;
+
+    modifiedTime = (uint64_t)fileInfo.st_mtime;
+    fileSize = (uint64_t)fileInfo.st_size;
+
+    return true;
+}
+
+bool TextureCooker::LoadOrCook(const string& fileLocation, uint32_t flags, CookedTexture& cooked)
+{
+    if (LoadCooked(fileLocation, flags, cooked)) return true;
+
+    int32_t width = 0, height = 0, channels = 0;
+    unsigned char* pixels = Texture::DecodeFile(fileLocation, (flags & TEXTURE_FLIP_VERTICAL) != 0, width, height, channels);
+
+    if (!pixels) return false;
+
+    cerr << "\tCooking " << fileLocation << " (" << width << "x" << height << ")..." << endl;
+
+    Cook(pixels, width, height, channels, flags, cooked);
+    stbi_image_free(pixels);
+
+    // Still usable this run if the folder is read only
+    SaveCooked(fileLocation, flags, cooked);
+
+    return true;
+}
+
+bool TextureCooker::LoadCooked(const string& fileLocation, uint32_t flags, CookedTexture& cooked)
+{
+    return LoadCookedLevels(fileLocation, flags, 0, UINT32_MAX, cooked);
+}
+
+bool TextureCooker::LoadCookedTail(const string& fileLocation, uint32_t flags, int32_t maxLevelSize, CookedTexture& cooked)
+{
+    // Level count and sizes come from the header, so read it first
+    if (!LoadCookedLevels(fileLocation, flags, UINT32_MAX, UINT32_MAX, cooked)) return false;
+
+    uint32_t firstLevel = 0;
+
+    while (firstLevel + 1 < cooked.levelSizes.size() &&
+           (cooked.GetLevelWidth(firstLevel) > maxLevelSize || cooked.GetLevelHeight(firstLevel) > maxLevelSize))
+    {
+        firstLevel++;
+    }
+
+    return LoadCookedLevels(fileLocation, flags, firstLevel, UINT32_MAX, cooked);
+}
+
+bool TextureCooker::LoadCookedLevels(const string& fileLocation, uint32_t flags, uint32_t firstLevel, uint32_t endLevel, CookedTexture& cooked)
+{
+    uint64_t sourceTime = 0, sourceSize = 0;
+    if (!GetSourceStamp(fileLocation, sourceTime, sourceSize)) return false;
+
+    // Only the levels that are used get paged in from the mapping
+    AssetFile file;
+    if (!file.Open(GetCookedPath(fileLocation, flags))) return false;
+
+    const size_t headerSize = sizeof(uint32_t) + sizeof(DDSHeader);
+    if (file.GetSize() < headerSize) return false;
+
+    uint32_t magic = 0;
+    DDSHeader header;
+
+    memcpy(&magic, file.GetData(), sizeof(magic));
+    memcpy(&header, file.GetData() + sizeof(magic), sizeof(header));
+
+    if (magic != DDS_MAGIC || header.size != sizeof(DDSHeader)) return false;
+    // Out of date, the source was edited after it was cooked or the size limit changed
+    // Out of date, the source was edited after it was cooked
+    if (header.reserved1[0] != COOK_MAGIC || header.reserved1[1] != COOK_VERSION ||
+        header.reserved1[2] != (uint32_t)sourceTime || header.reserved1[3] != (uint32_t)(sourceTime >> 32) ||
+        header.reserved1[4] != (uint32_t)sourceSize || header.reserved1[5] != (uint32_t)(sourceSize >> 32) ||
+        header.reserved1[6] != (uint32_t)TEXTURE_MAX_SIZE)
+    {
+        return false;
+    }
+
+    if (header.pixelFormat.fourCC == FOURCC_DXT1) cooked.format = COOKED_BC1;
+    else if (header.pixelFormat.fourCC == FOURCC_DXT5) cooked.format = COOKED_BC3;
+    else if (header.pixelFormat.fourCC == FOURCC_ATI2) cooked.format = COOKED_BC5;
+    else return false;
+
+    cooked.width = (int32_t)header.width;
+    cooked.height = (int32_t)header.height;
+    cooked.levelOffsets.clear();
+    cooked.levelSizes.clear();
+
+    uint32_t levelCount = header.mipMapCount > 0 ? header.mipMapCount : 1;
+
+    if (endLevel > levelCount) endLevel = levelCount;
+    if (firstLevel > endLevel) firstLevel = endLevel;
+
+    cooked.firstLevel = firstLevel;
+    cooked.endLevel = endLevel;
+
+    // Where the first wanted level starts in the file, and the offsets inside data
+    size_t skippedSize = 0, totalSize = 0;
+
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        size_t levelSize = GetLevelSize(cooked.GetLevelWidth(level), cooked.GetLevelHeight(level), cooked.format);
+
+        cooked.levelSizes.push_back(levelSize);
+        cooked.levelOffsets.push_back(totalSize);
+
+        if (level < firstLevel) skippedSize += levelSize;
+        else if (level < endLevel) totalSize += levelSize;
+    }
+
+    cooked.data.resize(totalSize);
+
+    if (totalSize == 0) return true;
+
+    if (skippedSize + totalSize > file.GetSize() - headerSize) return false;
+
+    memcpy(cooked.data.data(), file.GetData() + headerSize + skippedSize, totalSize);
+
+    return true;
+}
+
+void TextureCooker::TrimLevels(CookedTexture& cooked, int32_t maxLevelSize)
+{
+    uint32_t firstLevel = cooked.firstLevel;
+
+    while (firstLevel + 1 < cooked.endLevel &&
+           (cooked.GetLevelWidth(firstLevel) > maxLevelSize || cooked.GetLevelHeight(firstLevel) > maxLevelSize))
+    {
+        firstLevel++;
+    }
+
+    if (firstLevel == cooked.firstLevel) return;
+
+    size_t trimmedSize = cooked.levelOffsets[firstLevel];
+    cooked.data.erase(cooked.data.begin(), cooked.data.begin() + trimmedSize);
+
+    for (uint32_t level = firstLevel; level < cooked.endLevel; level++)
+    {
+        cooked.levelOffsets[level] -= trimmedSize;
+    }
+
+    cooked.firstLevel = firstLevel;
+}
+
+bool TextureCooker::SaveCooked(const string& fileLocation, uint32_t flags, const CookedTexture& cooked)
+{
+    uint64_t sourceTime = 0, sourceSize = 0;
+    if (!GetSourceStamp(fileLocation, sourceTime, sourceSize)) return false;
+
+    // Only complete chains are written
+    if (cooked.firstLevel != 0 || cooked.endLevel != cooked.levelSizes.size()) return false;
+
+    string path = GetCookedPath(fileLocation, flags);
+    ofstream fileStream(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (!fileStream.is_open())
+    {
+        cerr << "\n\nERROR: Failed to write the cooked texture " << path << ".\n" << endl;
+        return false;
+    }
+
+    DDSHeader header;
+    memset(&header, 0, sizeof(header));
+
+    header.size = sizeof(DDSHeader);
+    header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;     // Caps, height, width, pixel format, mip count, linear size
+    header.height = (uint32_t)cooked.height;
+    header.width = (uint32_t)cooked.width;
+    header.pitchOrLinearSize = (uint32_t)cooked.levelSizes[0];
+    header.mipMapCount = (uint32_t)cooked.levelSizes.size();
+
+    header.reserved1[0] = COOK_MAGIC;
+    header.reserved1[1] = COOK_VERSION;
+    header.reserved1[2] = (uint32_t)sourceTime;
+    header.reserved1[3] = (uint32_t)(sourceTime >> 32);
+    header.reserved1[4] = (uint32_t)sourceSize;
+    header.reserved1[5] = (uint32_t)(sourceSize >> 32);
+    header.reserved1[6] = (uint32_t)TEXTURE_MAX_SIZE;
+
+    header.pixelFormat.size = sizeof(DDSPixelFormat);
+    header.pixelFormat.flags = 0x4;     // FourCC
+    header.pixelFormat.fourCC = (cooked.format == COOKED_BC1) ? FOURCC_DXT1 : (cooked.format == COOKED_BC3) ? FOURCC_DXT5 : FOURCC_ATI2;
+
+    header.caps = 0x1000 | 0x400000 | 0x8;     // Texture, mip map, complex
+
+    fileStream.write((const char*)&DDS_MAGIC, sizeof(DDS_MAGIC));
+    fileStream.write((const char*)&header, sizeof(header));
+    fileStream.write((const char*)cooked.data.data(), cooked.data.size());
+
+    return fileStream.good();
+}
+
+void TextureCooker::HalveImage(const uint8_t* pixels, int32_t width, int32_t height, int32_t channels, uint8_t* halved)
+{
+    int32_t halvedWidth = width > 1 ? width / 2 : 1;
+    int32_t halvedHeight = height > 1 ? height / 2 : 1;
+
+    for (int32_t y = 0; y < halvedHeight; y++)
+    {
+        // Clamped so odd sizes don't read past the last row or column
+        int32_t y0 = y * 2;
+        int32_t y1 = (y0 + 1 < height) ? y0 + 1 : y0;
+
+        for (int32_t x = 0; x < halvedWidth; x++)
+        {
+            int32_t x0 = x * 2;
+            int32_t x1 = (x0 + 1 < width) ? x0 + 1 : x0;
+
+            for (int32_t c = 0; c < channels; c++)
+            {
+                uint32_t sum = pixels[((size_t)y0 * width + x0) * channels + c] +
+                               pixels[((size_t)y0 * width + x1) * channels + c] +
+                               pixels[((size_t)y1 * width + x0) * channels + c] +
+                               pixels[((size_t)y1 * width + x1) * channels + c];
+
+                halved[((size_t)y * halvedWidth + x) * channels + c] = (uint8_t)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+// Averaged normals get shorter, put them back on the unit sphere
+static void RenormalizeNormals(uint8_t* rgba, size_t texelCount)
+{
+    for (size_t i = 0; i < texelCount; i++)
+    {
+        float x = rgba[i * 4 + 0] / 127.5f - 1.0f;
+        float y = rgba[i * 4 + 1] / 127.5f - 1.0f;
+        float z = rgba[i * 4 + 2] / 127.5f - 1.0f;
+
+        float length = sqrtf(x * x + y * y + z * z);
+        if (length < 0.0001f) continue;
+
+        rgba[i * 4 + 0] = (uint8_t)((x / length + 1.0f) * 127.5f + 0.5f);
+        rgba[i * 4 + 1] = (uint8_t)((y / length + 1.0f) * 127.5f + 0.5f);
+        rgba[i * 4 + 2] = (uint8_t)((z / length + 1.0f) * 127.5f + 0.5f);
+    }
+}
+
+// Wraps like GL_REPEAT, so tiling textures keep their seams clean
+void TextureCooker::ResizeToRGBA(const uint8_t* pixels, int32_t width, int32_t height, int32_t channels, int32_t newWidth, int32_t newHeight, uint8_t* resized)
+{
+    auto fetch = [&](int32_t x, int32_t y, int32_t channel)
+    {
+        x = ((x % width) + width) % width;
+        y = ((y % height) + height) % height;
+        const uint8_t* texel = pixels + ((size_t)y * width + x) * channels;
+
+        // Grey images fill RGB, alpha is opaque unless the image has one
+        if (channel == 3) return (channels == 4 || channels == 2) ? (float)texel[channels - 1] : 255.0f;
+        return (float)texel[channels >= 3 ? channel : 0];
+    };
+
+    float scaleX = (float)width / newWidth;
+    float scaleY = (float)height / newHeight;
+
+    for (int32_t y = 0; y < newHeight; y++)
+    {
+        float sourceY = (y + 0.5f) * scaleY - 0.5f;
+        int32_t y0 = (int32_t)floorf(sourceY);
+        float fy = sourceY - y0;
+
+        for (int32_t x = 0; x < newWidth; x++)
+        {
+            float sourceX = (x + 0.5f) * scaleX - 0.5f;
+            int32_t x0 = (int32_t)floorf(sourceX);
+            float fx = sourceX - x0;
+
+            for (int32_t channel = 0; channel < 4; channel++)
+            {
+                float top = fetch(x0, y0, channel) * (1.0f - fx) + fetch(x0 + 1, y0, channel) * fx;
+                float bottom = fetch(x0, y0 + 1, channel) * (1.0f - fx) + fetch(x0 + 1, y0 + 1, channel) * fx;
+
+                resized[((size_t)y * newWidth + x) * 4 + channel] = (uint8_t)(top * (1.0f - fy) + bottom * fy + 0.5f);
+            }
+        }
+    }
+}
+
+void TextureCooker::Cook(const uint8_t* pixels, int32_t width, int32_t height, int32_t channels, uint32_t flags, CookedTexture& cooked)
+{
+    bool normalMap = (flags & TEXTURE_NORMAL_MAP) != 0;
+
+    // Everything is cooked from RGBA, grey and grey + alpha get spread over RGB
+    vector<uint8_t> rgba((size_t)width * height * 4);
+    bool hasAlpha = false;
+
+    for (size_t i = 0; i < (size_t)width * height; i++)
+    {
+        const uint8_t* texel = pixels + i * channels;
+
+        rgba[i * 4 + 0] = texel[0];
+        rgba[i * 4 + 1] = (channels >= 3) ? texel[1] : texel[0];
+        rgba[i * 4 + 2] = (channels >= 3) ? texel[2] : texel[0];
+        rgba[i * 4 + 3] = (channels == 4) ? texel[3] : (channels == 2) ? texel[1] : 255;
+
+        if (rgba[i * 4 + 3] < 255) hasAlpha = true;
+    }
+
+    cooked.format = normalMap ? COOKED_BC5 : (hasAlpha ? COOKED_BC3 : COOKED_BC1);
+    cooked.data.clear();
+    cooked.levelOffsets.clear();
+    cooked.levelSizes.clear();
+
+    // Drops the levels over the size limit
+    while (width > TEXTURE_MAX_SIZE || height > TEXTURE_MAX_SIZE)
+    {
+        vector<uint8_t> halved((size_t)(width > 1 ? width / 2 : 1) * (height > 1 ? height / 2 : 1) * 4);
+        HalveImage(rgba.data(), width, height, 4, halved.data());
+
+        rgba.swap(halved);
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+
+        if (normalMap) RenormalizeNormals(rgba.data(), (size_t)width * height);
+    }
+
+    cooked.width = width;
+    cooked.height = height;
+    cooked.firstLevel = 0;
+
+    while (true)
+    {
+        size_t levelSize = GetLevelSize(width, height, cooked.format);
+
+        cooked.levelOffsets.push_back(cooked.data.size());
+        cooked.levelSizes.push_back(levelSize);
+        cooked.data.resize(cooked.data.size() + levelSize);
+
+        EncodeLevel(rgba.data(), width, height, cooked.format, cooked.data.data() + cooked.levelOffsets.back());
+        cooked.endLevel = (uint32_t)cooked.levelSizes.size();
+
+        if (width == 1 && height == 1) break;
+
+        vector<uint8_t> halved((size_t)(width > 1 ? width / 2 : 1) * (height > 1 ? height / 2 : 1) * 4);
+        HalveImage(rgba.data(), width, height, 4, halved.data());
+
+        rgba.swap(halved);
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+
+        if (normalMap) RenormalizeNormals(rgba.data(), (size_t)width * height);
+    }
+}
+
+void TextureCooker::EncodeLevel(const uint8_t* rgba, int32_t width, int32_t height, CookedFormat format, uint8_t* blocks)
+{
+    uint32_t blockSize = GetBlockSize(format);
+    int32_t blocksX = (width + 3) / 4;
+    int32_t blocksY = (height + 3) / 4;
+
+    for (int32_t blockY = 0; blockY < blocksY; blockY++)
+    {
+        for (int32_t blockX = 0; blockX < blocksX; blockX++)
+        {
+            // Levels smaller than a block repeat their last row and column
+            uint8_t block[16][4];
+
+            for (int32_t i = 0; i < 16; i++)
+            {
+                int32_t x = blockX * 4 + (i % 4);
+                int32_t y = blockY * 4 + (i / 4);
+
+                if (x >= width) x = width - 1;
+                if (y >= height) y = height - 1;
+
+                memcpy(block[i], rgba + ((size_t)y * width + x) * 4, 4);
+            }
+
+            uint8_t* output = blocks + ((size_t)blockY * blocksX + blockX) * blockSize;
+            uint8_t channel[16];
+
+            if (format == COOKED_BC1)
+            {
+                EncodeBC1Block(block, output);
+            }
+            else if (format == COOKED_BC3)
+            {
+                // Alpha block first, then the colour block
+                for (int32_t i = 0; i < 16; i++) channel[i] = block[i][3];
+
+                EncodeBC4Block(channel, output);
+                EncodeBC1Block(block, output + 8);
+            }
+            else
+            {
+                // X in the first block, Y in the second
+                for (int32_t i = 0; i < 16; i++) channel[i] = block[i][0];
+                EncodeBC4Block(channel, output);
+
+                for (int32_t i = 0; i < 16; i++) channel[i] = block[i][1];
+                EncodeBC4Block(channel, output + 8);
+            }
+        }
+    }
+}
+
+static uint16_t ToRGB565(const float colour[3])
+{
+    uint32_t r = (uint32_t)(fminf(fmaxf(colour[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+    uint32_t g = (uint32_t)(fminf(fmaxf(colour[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+    uint32_t b = (uint32_t)(fminf(fmaxf(colour[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void FromRGB565(uint16_t packed, int32_t colour[3])
+{
+    int32_t r = (packed >> 11) & 31;
+    int32_t g = (packed >> 5) & 63;
+    int32_t b = packed & 31;
+
+    colour[0] = (r << 3) | (r >> 2);
+    colour[1] = (g << 2) | (g >> 4);
+    colour[2] = (b << 3) | (b >> 2);
+}
+
+void TextureCooker::EncodeBC1Block(const uint8_t block[16][4], uint8_t* output)
+{
+    // Endpoints along the main axis of the colours in the block
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+
+    for (int32_t i = 0; i < 16; i++)
+    {
+        for (int32_t c = 0; c < 3; c++) mean[c] += block[i][c] / 16.0f;
+    }
+
+    float covariance[6] = { 0.0f };
+
+    for (int32_t i = 0; i < 16; i++)
+    {
+        float r = block[i][0] - mean[0];
+        float g = block[i][1] - mean[1];
+        float b = block[i][2] - mean[2];
+
+        covariance[0] += r * r; covariance[1] += r * g; covariance[2] += r * b;
+        covariance[3] += g * g; covariance[4] += g * b; covariance[5] += b * b;
+    }
+
+    // A few power iterations are plenty for a 3x3 matrix
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+
+    for (int32_t iteration = 0; iteration < 4; iteration++)
+    {
+        float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+        float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+        float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+
+        float length = fmaxf(fabsf(x), fmaxf(fabsf(y), fabsf(z)));
+        if (length < 0.0001f) break;
+
+        axis[0] = x / length;
+        axis[1] = y / length;
+        axis[2] = z / length;
+    }
+
+    float minProjection = 0.0f, maxProjection = 0.0f;
+    float axisLength = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+    for (int32_t i = 0; i < 16; i++)
+    {
+        float projection = ((block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2]) / axisLength;
+
+        if (i == 0 || projection < minProjection) minProjection = projection;
+        if (i == 0 || projection > maxProjection) maxProjection = projection;
+    }
+
+    float endpoint0[3], endpoint1[3];
+
+    for (int32_t c = 0; c < 3; c++)
+    {
+        endpoint0[c] = mean[c] + axis[c] * maxProjection;
+        endpoint1[c] = mean[c] + axis[c] * minProjection;
+    }
+
+    uint16_t colour0 = ToRGB565(endpoint0);
+    uint16_t colour1 = ToRGB565(endpoint1);
+
+    // colour0 > colour1 picks the four colour mode
+    if (colour0 < colour1)
+    {
+        uint16_t swap = colour0;
+        colour0 = colour1;
+        colour1 = swap;
+    }
+
+    output[0] = (uint8_t)(colour0 & 0xFF);
+    output[1] = (uint8_t)(colour0 >> 8);
+    output[2] = (uint8_t)(colour1 & 0xFF);
+    output[3] = (uint8_t)(colour1 >> 8);
+
+    uint32_t indices = 0;
+
+    if (colour0 != colour1)
+    {
+        int32_t palette[4][3];
+        FromRGB565(colour0, palette[0]);
+        FromRGB565(colour1, palette[1]);
+
+        for (int32_t c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (int32_t i = 0; i < 16; i++)
+        {
+            uint32_t bestIndex = 0;
+            int32_t bestError = INT32_MAX;
+
+            for (uint32_t p = 0; p < 4; p++)
+            {
+                int32_t r = block[i][0] - palette[p][0];
+                int32_t g = block[i][1] - palette[p][1];
+                int32_t b = block[i][2] - palette[p][2];
+                int32_t error = r * r + g * g + b * b;
+
+                if (error < bestError)
+                {
+                    bestError = error;
+                    bestIndex = p;
+                }
+            }
+
+            indices |= bestIndex << (i * 2);
+        }
+    }
+
+    output[4] = (uint8_t)(indices & 0xFF);
+    output[5] = (uint8_t)((indices >> 8) & 0xFF);
+    output[6] = (uint8_t)((indices >> 16) & 0xFF);
+    output[7] = (uint8_t)(indices >> 24);
+}
+
+void TextureCooker::EncodeBC4Block(const uint8_t values[16], uint8_t* output)
+{
+    uint8_t minValue = 255, maxValue = 0;
+
+    for (int32_t i = 0; i < 16; i++)
+    {
+        if (values[i] < minValue) minValue = values[i];
+        if (values[i] > maxValue) maxValue = values[i];
+    }
+
+    // max > min picks the eight value mode
+    output[0] = maxValue;
+    output[1] = minValue;
+
+    uint64_t indices = 0;
+
+    if (maxValue != minValue)
+    {
+        int32_t palette[8];
+        palette[0] = maxValue;
+        palette[1] = minValue;
+
+        for (int32_t p = 1; p < 7; p++)
+        {
+            palette[p + 1] = ((7 - p) * maxValue + p * minValue) / 7;
+        }
+
+        for (int32_t i = 0; i < 16; i++)
+        {
+            uint64_t bestIndex = 0;
+            int32_t bestError = INT32_MAX;
+
+            for (int32_t p = 0; p < 8; p++)
+            {
+                int32_t error = abs(values[i] - palette[p]);
+
+                if (error < bestError)
+                {
+                    bestError = error;
+                    bestIndex = (uint64_t)p;
+                }
+            }
+
+            indices |= bestIndex << (i * 3);
+        }
+    }
+
+    for (int32_t i = 0; i < 6; i++)
+    {
+        output[2 + i] = (uint8_t)((indices >> (i * 8)) & 0xFF);
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <GL\glew.h>
+
+#include "Config.h"
+
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+
+enum CookedFormat
+{
+    COOKED_BC1 = 0,     // RGB, 4 bits per texel
+    COOKED_BC3 = 1,     // RGBA, 8 bits per texel
+    COOKED_BC5 = 2      // Two channel normal maps, Z is rebuilt in the shader
+};
+
+// A block compressed texture with its mip chain, biggest level first
+struct CookedTexture
+{
+    CookedFormat format;
+    int32_t width, height;                  // Of level 0, even when it isn't loaded
+
+    // data only holds levels firstLevel to endLevel - 1, levelOffsets index into it
+    uint32_t firstLevel, endLevel;
+
+    vector<uint8_t> data;
+    vector<size_t> levelOffsets;
+    vector<size_t> levelSizes;              // Every level of the file
+
+    GLenum GetGLFormat() const;
+    int32_t GetLevelWidth(size_t level) const;
+    int32_t GetLevelHeight(size_t level) const;
+};
+
+/*
+    First run CPU encoder for BC1/BC3/BC5 textures.
+
+    Cooked files are saved as DDS next to the source (ground.png -> ground.png.dds)
+    and stamped with the size and modification time of the source, so editing
+    the image cooks it again. Every function here is safe to call from the
+    texture loader threads, except IsSupported().
+*/
+class TextureCooker
+{
+public:
+
+    // Needs the GL thread
+    static bool IsSupported();
+
+    static string GetCookedPath(const string& fileLocation, uint32_t flags);
+
+    // Reads the cooked file if there is an up to date one, otherwise decodes and cooks the source
+    static bool LoadOrCook(const string& fileLocation, uint32_t flags, CookedTexture& cooked);
+
+    static bool LoadCooked(const string& fileLocation, uint32_t flags, CookedTexture& cooked);
+
+    // Only reads the levels in [firstLevel, endLevel), for texture streaming
+    static bool LoadCookedLevels(const string& fileLocation, uint32_t flags, uint32_t firstLevel, uint32_t endLevel, CookedTexture& cooked);
+
+    // Only reads the levels that fit in maxLevelSize (the smallest level is always read)
+    static bool LoadCookedTail(const string& fileLocation, uint32_t flags, int32_t maxLevelSize, CookedTexture& cooked);
+
+    // Drops the levels bigger than maxLevelSize from a fully loaded texture
+    static void TrimLevels(CookedTexture& cooked, int32_t maxLevelSize);
+    static bool SaveCooked(const string& fileLocation, uint32_t flags, const CookedTexture& cooked);
+
+    // Levels bigger than TEXTURE_MAX_SIZE are left out of the chain
+    static void Cook(const uint8_t* pixels, int32_t width, int32_t height, int32_t channels, uint32_t flags, CookedTexture& cooked);
+
+    // 2x2 box filter, halved has to fit max(1, width / 2) * max(1, height / 2) texels
+    static void HalveImage(const uint8_t* pixels, int32_t width, int32_t height, int32_t channels, uint8_t* halved);
+
+    // Bilinear resize to RGBA. Grey images fill RGB, alpha is 255 unless the image has one
+    static void ResizeToRGBA(const uint8_t* pixels, int32_t width, int32_t height, int32_t channels, int32_t newWidth, int32_t newHeight, uint8_t* resized);
+
+    // Modified time and size of the source, written in cooked files to spot stale ones
+    static bool GetSourceStamp(const string& fileLocation, uint64_t& modifiedTime, uint64_t& fileSize);
+
+private:
+
+    static void EncodeLevel(const uint8_t* rgba, int32_t width, int32_t height, CookedFormat format, uint8_t* blocks);
+    static void EncodeBC1Block(const uint8_t block[16][4], uint8_t* output);
+    static void EncodeBC4Block(const uint8_t values[16], uint8_t* output);
+};
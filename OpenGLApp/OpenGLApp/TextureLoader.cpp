@@ -0,0 +1,302 @@
+#include "TextureLoader.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+
+bool TextureLoader::running = false;
+vector<std::thread> TextureLoader::workers;
+
+std::mutex TextureLoader::queueMutex;
+std::condition_variable TextureLoader::queueCondition;
+deque<TextureLoader::DecodeRequest> TextureLoader::decodeQueue;
+deque<TextureLoader::DecodedImage> TextureLoader::uploadQueue;
+size_t TextureLoader::decodingCount = 0;
+
+GLuint TextureLoader::uploadBuffers[TEXTURE_UPLOAD_PBOS] = {};
+uint32_t TextureLoader::nextUploadBuffer = 0;
+
+void TextureLoader::Init(uint32_t threadCount)
+{
+    if (running) return;
+
+    if (threadCount == 0)
+    {
+        uint32_t cores = std::thread::hardware_concurrency();
+        threadCount = cores > 1 ? cores - 1 : 1;
+    }
+
+    // Uploads rotate through these so a new copy doesn't wait on the last transfer
+    glGenBuffers(TEXTURE_UPLOAD_PBOS, uploadBuffers);
+    nextUploadBuffer = 0;
+
+    running = true;
+
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        workers.push_back(std::thread(WorkerLoop));
+    }
+
+    cerr << "Texture loader: " << threadCount << " decode threads" << endl;
+}
+
+void TextureLoader::Request(const TextureHandle& texture, uint32_t flags)
+{
+    if (!texture) return;
+
+    if (!running)
+    {
+        texture->LoadCookedTexture(flags);
+        return;
+    }
+
+    // Valid ID from the start, the image replaces it when it's uploaded
+    texture->CreatePlaceholder();
+
+    DecodeRequest request;
+    request.texture = texture;
+    request.fileLocation = texture->GetFileLocation();
+    request.flags = flags;
+    request.cook = TextureCooker::IsSupported();
+    request.stream = request.cook && (flags & TEXTURE_STREAMED) && TextureStreamer::IsRunning();
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        decodeQueue.push_back(request);
+    }
+
+    queueCondition.notify_one();
+}
+
+void TextureLoader::WorkerLoop()
+{
+    while (true)
+    {
+        DecodeRequest request;
+
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [] { return !running || !decodeQueue.empty(); });
+
+            if (!running) return;
+
+            request = decodeQueue.front();
+            decodeQueue.pop_front();
+            decodingCount++;
+        }
+
+        DecodedImage image;
+        image.texture = request.texture;
+        image.fileLocation = request.fileLocation;
+        image.flags = request.stream ? request.flags : request.flags & ~TEXTURE_STREAMED;
+        image.pixels = nullptr;
+        image.width = 0;
+        image.height = 0;
+        image.bitDepth = 0;
+        image.ownedPixels = false;
+        image.compressed = false;
+
+        // Nobody wants it anymore
+        if (!request.texture.expired())
+        {
+            if (request.stream)
+            {
+                // Saves reading the big levels when the file is already cooked
+                image.compressed = TextureCooker::LoadCookedTail(request.fileLocation, request.flags, TEXTURE_STREAMING_START_SIZE, image.cooked);
+
+                if (!image.compressed && TextureCooker::LoadOrCook(request.fileLocation, request.flags, image.cooked))
+                {
+                    TextureCooker::TrimLevels(image.cooked, TEXTURE_STREAMING_START_SIZE);
+                    image.compressed = true;
+                }
+            }
+            else if (request.cook)
+            {
+                image.compressed = TextureCooker::LoadOrCook(request.fileLocation, request.flags, image.cooked);
+            }
+
+            if (!image.compressed)
+            {
+                bool invertedTexture = (request.flags & TEXTURE_FLIP_VERTICAL) != 0;
+                image.pixels = Texture::DecodeFile(request.fileLocation, invertedTexture, image.width, image.height, image.bitDepth);
+            }
+        }
+
+        if (image.pixels)
+        {
+            ShrinkImage(image);
+        }
+
+        std::lock_guard<std::mutex> lock(queueMutex);
+        uploadQueue.push_back(image);
+        decodingCount--;
+    }
+}
+
+void TextureLoader::ShrinkImage(DecodedImage& image)
+{
+    while (image.width > TEXTURE_MAX_SIZE || image.height > TEXTURE_MAX_SIZE)
+    {
+        int32_t newWidth = image.width > 1 ? image.width / 2 : 1;
+        int32_t newHeight = image.height > 1 ? image.height / 2 : 1;
+
+        unsigned char* newPixels = new unsigned char[(size_t)newWidth * newHeight * image.bitDepth];
+        TextureCooker::HalveImage(image.pixels, image.width, image.height, image.bitDepth, newPixels);
+
+        FreeImage(image);
+
+        image.pixels = newPixels;
+        image.width = newWidth;
+        image.height = newHeight;
+        image.ownedPixels = true;
+    }
+}
+
+uint32_t TextureLoader::ProcessUploads(uint32_t maxUploads)
+{
+    vector<DecodedImage> images;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+
+        while (!uploadQueue.empty() && images.size() < maxUploads)
+        {
+            images.push_back(uploadQueue.front());
+            uploadQueue.pop_front();
+        }
+    }
+
+    for (DecodedImage& image : images)
+    {
+        UploadImage(image);
+    }
+
+    return (uint32_t)images.size();
+}
+
+void TextureLoader::UploadImage(DecodedImage& image)
+{
+    TextureHandle texture = image.texture.lock();
+
+    if (!texture)
+    {
+        FreeImage(image);
+        return;
+    }
+
+    if (!image.pixels && !image.compressed)
+    {
+        cerr << "\n\nERROR: Failed to find the texture " << image.fileLocation << ", keeping the placeholder.\n" << endl;
+
+        // Asked for again, it's decoded again instead of getting the placeholder
+        TextureRegistry::Remove(texture.get(), image.flags);
+        return;
+    }
+
+    const uint8_t* sourceData = image.compressed ? image.cooked.data.data() : image.pixels;
+    GLsizeiptr imageSize = image.compressed ? (GLsizeiptr)image.cooked.data.size() : (GLsizeiptr)image.width * image.height * image.bitDepth;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadBuffers[nextUploadBuffer]);
+    nextUploadBuffer = (nextUploadBuffer + 1) % TEXTURE_UPLOAD_PBOS;
+
+    // Orphaning gives us fresh storage even if the driver still reads the old one
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, imageSize, nullptr, GL_STREAM_DRAW);
+    void* mappedData = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, imageSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+    bool copied = false;
+
+    if (mappedData)
+    {
+        memcpy(mappedData, sourceData, imageSize);
+        copied = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+    }
+
+    if (!copied)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // nullptr is offset 0 in the bound pixel buffer
+    const uint8_t* uploadData = copied ? nullptr : sourceData;
+
+    if (image.compressed)
+    {
+        texture->UploadCompressed(image.cooked, uploadData);
+
+        if ((image.flags & TEXTURE_STREAMED) && image.cooked.firstLevel > 0)
+        {
+            TextureStreamer::Register(texture, image.fileLocation, image.flags, image.cooked);
+        }
+    }
+    else
+    {
+        texture->UploadPixels(uploadData, image.width, image.height, image.bitDepth);
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    FreeImage(image);
+}
+
+void TextureLoader::FreeImage(DecodedImage& image)
+{
+    if (!image.pixels) return;
+
+    if (image.ownedPixels) delete[] image.pixels;
+    else stbi_image_free(image.pixels);
+
+    image.pixels = nullptr;
+}
+
+size_t TextureLoader::GetPendingCount()
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return decodeQueue.size() + decodingCount + uploadQueue.size();
+}
+
+void TextureLoader::Flush()
+{
+    while (GetPendingCount() > 0)
+    {
+        if (ProcessUploads(UINT32_MAX) == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+void TextureLoader::Shutdown()
+{
+    if (!running) return;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        running = false;
+    }
+
+    queueCondition.notify_all();
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    workers.clear();
+
+    // Whatever was still waiting is dropped
+    decodeQueue.clear();
+
+    for (DecodedImage& image : uploadQueue)
+    {
+        FreeImage(image);
+    }
+
+    uploadQueue.clear();
+
+    glDeleteBuffers(TEXTURE_UPLOAD_PBOS, uploadBuffers);
+
+    for (size_t i = 0; i < TEXTURE_UPLOAD_PBOS; i++)
+    {
+        uploadBuffers[i] = 0;
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <GL\glew.h>
+
+#include "Config.h"
+#include "Texture.h"
+#include "TextureCooker.h"
+#include "TextureRegistry.h"
+#include "TextureStreamer.h"
+
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+using std::deque;
+
+/*
+    Background texture loading.
+
+    Worker threads read the cooked BC files (cooking them the first time) or
+    decode and shrink the raw images, the GL thread
+    only copies the finished pixels into a pixel buffer and lets the driver
+    upload from there. Textures handed to Request() get a white placeholder
+    right away, so they can be bound before their image is in.
+*/
+class TextureLoader
+{
+public:
+
+    // threadCount 0 picks one less than the number of cores
+    static void Init(uint32_t threadCount = 0);
+    static bool IsRunning() { return running; }
+
+    // flags are TextureLoadFlags
+    static void Request(const TextureHandle& texture, uint32_t flags);
+
+    // Uploads up to maxUploads finished images. Call from the GL thread
+    static uint32_t ProcessUploads(uint32_t maxUploads);
+
+    // Blocks until every request is decoded and uploaded
+    static void Flush();
+
+    static size_t GetPendingCount();
+
+    // Joins the workers and frees the pixel buffers. Call before the context goes away
+    static void Shutdown();
+
+private:
+
+    // Weak, so a texture nobody uses anymore is skipped and never freed off the GL thread
+    struct DecodeRequest
+    {
+        weak_ptr<Texture> texture;
+        string fileLocation;
+        uint32_t flags;
+        bool cook;                  // Checked on the GL thread, the workers can't ask GLEW
+        bool stream;                // Only the small levels are loaded, TextureStreamer brings in the rest
+    };
+
+    struct DecodedImage
+    {
+        weak_ptr<Texture> texture;
+        string fileLocation;
+        uint32_t flags;
+        unsigned char* pixels;
+        int32_t width, height, bitDepth;
+        bool ownedPixels;           // Resized images aren't from stbi_load
+
+        bool compressed;            // cooked is used instead of pixels
+        CookedTexture cooked;
+    };
+
+    static bool running;
+    static vector<std::thread> workers;
+
+    static std::mutex queueMutex;
+    static std::condition_variable queueCondition;
+    static deque<DecodeRequest> decodeQueue;
+    static deque<DecodedImage> uploadQueue;
+    static size_t decodingCount;
+
+    static GLuint uploadBuffers[TEXTURE_UPLOAD_PBOS];
+    static uint32_t nextUploadBuffer;
+
+    static void WorkerLoop();
+    static void UploadImage(DecodedImage& image);
+    static void FreeImage(DecodedImage& image);
+
+    // Box filters the image down until it fits in TEXTURE_MAX_SIZE
+    static void ShrinkImage(DecodedImage& image);
+};
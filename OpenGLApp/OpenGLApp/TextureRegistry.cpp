@@ -0,0 +1,151 @@
+#include "TextureRegistry.h"
+#include "TextureLoader.h"
+#include "Hash.h"
+
+#include <ctype.h>
+#include <vector>
+
+using std::vector;
+
+std::unordered_map<string, weak_ptr<Texture>> TextureRegistry::entries;
+
+TextureHandle TextureRegistry::Load(const string& fileLocation, uint32_t flags)
+{
+    string path = NormalizePath(fileLocation);
+    string key = path + "|" + std::to_string(flags);
+
+    auto entry = entries.find(key);
+    if (entry != entries.end())
+    {
+        TextureHandle texture = entry->second.lock();
+
+        if (texture)
+        {
+            cerr << "\tReusing texture " << path << " (" << texture.use_count() - 1 << " other users)" << endl;
+            return texture;
+        }
+    }
+
+    TextureHandle texture = std::make_shared<Texture>(path.c_str());
+
+    // Decoded in the background, the handle is usable right away
+    if (TextureLoader::IsRunning())
+    {
+        TextureLoader::Request(texture, flags);
+        entries[key] = texture;
+        return texture;
+    }
+
+    if (!texture->LoadCookedTexture(flags))
+    {
+        // Not cached, so a missing file is retried next time someone asks for it
+        entries.erase(key);
+        return nullptr;
+    }
+
+    entries[key] = texture;
+    return texture;
+}
+
+void TextureRegistry::Remove(Texture* texture, uint32_t flags)
+{
+    if (!texture) return;
+
+    // The path was normalized when it was loaded
+    string key = string(texture->GetFileLocation()) + "|" + std::to_string(flags);
+
+    auto entry = entries.find(key);
+    if (entry == entries.end()) return;
+
+    // Only if it's still this texture, the file may have been asked for again since
+    TextureHandle registered = entry->second.lock();
+    if (!registered || registered.get() == texture) entries.erase(entry);
+}
+
+TextureHandle TextureRegistry::LoadSolid(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha)
+{
+    const uint8_t texel[4] = { red, green, blue, alpha };
+
+    // Can't clash with a path, the separators are normalized to '/'
+    string key = "#" + HashToString(((uint64_t)red << 24) | ((uint64_t)green << 16) | ((uint64_t)blue << 8) | alpha).substr(8);
+
+    auto entry = entries.find(key);
+    if (entry != entries.end())
+    {
+        TextureHandle texture = entry->second.lock();
+        if (texture) return texture;
+    }
+
+    TextureHandle texture = std::make_shared<Texture>(key.c_str());
+
+    if (!texture->UploadPixels(texel, 1, 1, 4)) return nullptr;
+
+    entries[key] = texture;
+    return texture;
+}
+
+string TextureRegistry::NormalizePath(const string& fileLocation)
+{
+    vector<string> parts;
+    string part;
+
+    // Splits on both separators, dropping "." and resolving ".."
+    for (size_t i = 0; i <= fileLocation.size(); i++)
+    {
+        char c = (i < fileLocation.size()) ? fileLocation[i] : '/';
+
+        if (c != '/' && c != '\\')
+        {
+#ifdef _WIN32
+            // The file system doesn't care about case, so neither do we
+            c = (char)tolower((unsigned char)c);
+#endif
+            part += c;
+            continue;
+        }
+
+        if (part == "..")
+        {
+            if (!parts.empty() && parts.back() != "..") parts.pop_back();
+            else parts.push_back(part);
+        }
+        else if (!part.empty() && part != ".")
+        {
+            parts.push_back(part);
+        }
+
+        part.clear();
+    }
+
+    // Keeps absolute paths absolute
+    string path = (!fileLocation.empty() && (fileLocation[0] == '/' || fileLocation[0] == '\\')) ? "/" : "";
+
+    for (size_t i = 0; i < parts.size(); i++)
+    {
+        if (i > 0) path += "/";
+        path += parts[i];
+    }
+
+    return path;
+}
+
+size_t TextureRegistry::GetLiveCount()
+{
+    size_t count = 0;
+
+    for (auto& entry : entries)
+    {
+        if (!entry.second.expired()) count++;
+    }
+
+    return count;
+}
+
+void TextureRegistry::PurgeExpired()
+{
+    for (auto entry = entries.begin(); entry != entries.end();)
+    {
+        if (entry->second.expired()) entry = entries.erase(entry);
+        else entry++;
+    }
+}
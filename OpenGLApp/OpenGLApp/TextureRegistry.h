@@ -0,0 +1,54 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <GL\glew.h>
+
+#include "Texture.h"
+
+using std::cerr;
+using std::endl;
+using std::string;
+using std::shared_ptr;
+using std::weak_ptr;
+
+// Shared by every user of the same file, the GL texture goes away with the last one
+using TextureHandle = shared_ptr<Texture>;
+
+/*
+    Global list of loaded textures, keyed by normalized path and load flags.
+
+    The registry only keeps weak references, so it never holds a texture
+    alive by itself. Materials pointing at the same file get the same
+    handle and the image is decoded and uploaded once.
+*/
+class TextureRegistry
+{
+public:
+
+    // Returns nullptr if the file can't be loaded
+    static TextureHandle Load(const string& fileLocation, uint32_t flags);
+
+    // 1x1 texture of a single colour, shared the same way. Needs the GL thread
+    static TextureHandle LoadSolid(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha);
+
+    // Forgets a texture whose background load failed, so the next Load of the file tries again.
+    // The users it already has keep the placeholder
+    static void Remove(Texture* texture, uint32_t flags);
+
+    // "Assets\Textures\..\Textures\a.png" and "assets/textures/a.png" are the same file
+    static string NormalizePath(const string& fileLocation);
+
+    // Textures that still have at least one user
+    static size_t GetLiveCount();
+
+    // Drops the entries whose texture was already freed
+    static void PurgeExpired();
+
+private:
+
+    static std::unordered_map<string, weak_ptr<Texture>> entries;
+};
@@ -0,0 +1,286 @@
+#include "TextureStreamer.h"
+
+bool TextureStreamer::running = false;
+std::thread TextureStreamer::ioThread;
+
+std::mutex TextureStreamer::queueMutex;
+std::condition_variable TextureStreamer::queueCondition;
+deque<TextureStreamer::LevelRead> TextureStreamer::readQueue;
+deque<TextureStreamer::LevelRead> TextureStreamer::finishedQueue;
+
+std::unordered_map<Texture*, TextureStreamer::StreamedTexture> TextureStreamer::textures;
+uint64_t TextureStreamer::frameIndex = 0;
+uint64_t TextureStreamer::nextRegistration = 1;
+TextureStreamingStats TextureStreamer::stats = {};
+
+void TextureStreamer::Init(size_t budgetBytes)
+{
+    if (running) return;
+
+    stats = TextureStreamingStats();
+    stats.budgetBytes = budgetBytes;
+    frameIndex = 0;
+
+    running = true;
+    ioThread = std::thread(IOLoop);
+
+    cerr << "Texture streamer: " << budgetBytes / (1024 * 1024) << " MB budget" << endl;
+}
+
+void TextureStreamer::Register(const TextureHandle& texture, const string& fileLocation, uint32_t flags, const CookedTexture& cooked)
+{
+    if (!running || !texture) return;
+
+    StreamedTexture streamed;
+    streamed.texture = texture;
+    streamed.fileLocation = fileLocation;
+    streamed.flags = flags;
+    streamed.levelSizes = cooked.levelSizes;
+    streamed.residentLevel = (int32_t)cooked.firstLevel;
+    streamed.startLevel = (int32_t)cooked.firstLevel;
+    streamed.wantedLevel = (int32_t)cooked.firstLevel;
+    streamed.lastWantedFrame = frameIndex;
+    streamed.loading = false;
+    streamed.evictedLevel = 0;
+    streamed.evictedUntilFrame = 0;
+    streamed.registration = nextRegistration++;
+
+    texture->SetStreamed(true);
+    textures[texture.get()] = streamed;
+}
+
+void TextureStreamer::RequestLevel(Texture* texture, int32_t level)
+{
+    auto entry = textures.find(texture);
+    if (entry == textures.end()) return;
+
+    StreamedTexture& streamed = entry->second;
+
+    if (level < 0) level = 0;
+    if (level > streamed.startLevel) level = streamed.startLevel;
+
+    // Dropped for the budget not long ago, it comes back once the time is up and the level fits
+    if (level < streamed.evictedLevel)
+    {
+        size_t nextLevelSize = streamed.levelSizes[streamed.residentLevel > 0 ? streamed.residentLevel - 1 : 0];
+        bool fits = stats.residentBytes + nextLevelSize <= stats.budgetBytes;
+
+        if (frameIndex < streamed.evictedUntilFrame || !fits) level = streamed.evictedLevel;
+        else streamed.evictedLevel = 0;
+    }
+
+    // The finest request of the frame wins
+    if (streamed.lastWantedFrame != frameIndex || level < streamed.wantedLevel)
+    {
+        streamed.wantedLevel = level;
+    }
+
+    streamed.lastWantedFrame = frameIndex;
+}
+
+void TextureStreamer::IOLoop()
+{
+    while (true)
+    {
+        LevelRead read;
+
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [] { return !running || !readQueue.empty(); });
+
+            if (!running) return;
+
+            read = readQueue.front();
+            readQueue.pop_front();
+        }
+
+        read.succeeded = TextureCooker::LoadCookedLevels(read.fileLocation, read.flags, read.firstLevel, read.endLevel, read.cooked);
+
+        std::lock_guard<std::mutex> lock(queueMutex);
+        finishedQueue.push_back(read);
+    }
+}
+
+size_t TextureStreamer::GetResidentSize(const StreamedTexture& streamed)
+{
+    size_t size = 0;
+
+    for (size_t level = streamed.residentLevel; level < streamed.levelSizes.size(); level++)
+    {
+        size += streamed.levelSizes[level];
+    }
+
+    return size;
+}
+
+void TextureStreamer::Update()
+{
+    if (!running) return;
+
+    frameIndex++;
+
+    deque<LevelRead> finished;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        finished.swap(finishedQueue);
+    }
+
+    for (LevelRead& read : finished)
+    {
+        // Also skips reads for a texture that was freed, and another one got its address
+        auto entry = textures.find(read.key);
+        if (entry == textures.end() || entry->second.registration != read.registration) continue;
+
+        StreamedTexture& streamed = entry->second;
+        streamed.loading = false;
+
+        TextureHandle texture = streamed.texture.lock();
+        if (!texture) continue;
+
+        if (!read.succeeded)
+        {
+            cerr << "\n\nERROR: Failed to stream levels of " << read.fileLocation << ".\n" << endl;
+
+            // Don't ask again
+            streamed.startLevel = streamed.residentLevel;
+            continue;
+        }
+
+        // Only if nothing was evicted while the read was in flight
+        if ((int32_t)read.endLevel == streamed.residentLevel)
+        {
+            texture->StreamInLevels(read.cooked, read.cooked.data.data());
+            stats.levelsLoaded += streamed.residentLevel - read.firstLevel;
+            streamed.residentLevel = (int32_t)read.firstLevel;
+        }
+    }
+
+    size_t pendingReads = 0;
+    vector<LevelRead> newReads;
+
+    for (auto entry = textures.begin(); entry != textures.end();)
+    {
+        StreamedTexture& streamed = entry->second;
+
+        if (streamed.texture.expired())
+        {
+            entry = textures.erase(entry);
+            continue;
+        }
+
+        // Not drawn for a while, it can go back to its small levels
+        if (frameIndex - streamed.lastWantedFrame > TEXTURE_STREAMING_IDLE_FRAMES)
+        {
+            streamed.wantedLevel = streamed.startLevel;
+        }
+
+        if (streamed.loading)
+        {
+            pendingReads++;
+        }
+        else if (streamed.wantedLevel < streamed.residentLevel)
+        {
+            LevelRead read;
+            read.key = entry->first;
+            read.registration = streamed.registration;
+            read.fileLocation = streamed.fileLocation;
+            read.flags = streamed.flags;
+            read.firstLevel = (uint32_t)streamed.wantedLevel;
+            read.endLevel = (uint32_t)streamed.residentLevel;
+            read.succeeded = false;
+
+            newReads.push_back(read);
+            streamed.loading = true;
+            pendingReads++;
+        }
+
+        entry++;
+    }
+
+    if (!newReads.empty())
+    {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            readQueue.insert(readQueue.end(), newReads.begin(), newReads.end());
+        }
+
+        queueCondition.notify_one();
+    }
+
+    stats.pendingRequests = pendingReads;
+
+    EnforceBudget();
+}
+
+void TextureStreamer::EnforceBudget()
+{
+    size_t residentBytes = 0;
+
+    for (auto& entry : textures)
+    {
+        residentBytes += GetResidentSize(entry.second);
+    }
+
+    while (residentBytes > stats.budgetBytes)
+    {
+        // Least recently wanted texture that still has a level to give
+        StreamedTexture* victim = nullptr;
+        Texture* victimKey = nullptr;
+
+        for (auto& entry : textures)
+        {
+            StreamedTexture& streamed = entry.second;
+
+            if (streamed.residentLevel >= streamed.startLevel) continue;
+
+            // A level above the wanted one is always the first to go
+            bool unwanted = streamed.residentLevel < streamed.wantedLevel;
+            bool victimUnwanted = victim && victim->residentLevel < victim->wantedLevel;
+
+            if (!victim || (unwanted && !victimUnwanted) ||
+                (unwanted == victimUnwanted && streamed.lastWantedFrame < victim->lastWantedFrame))
+            {
+                victim = &streamed;
+                victimKey = entry.first;
+            }
+        }
+
+        if (!victim) break;
+
+        victimKey->DropBaseLevel();
+        residentBytes -= victim->levelSizes[victim->residentLevel];
+        victim->residentLevel++;
+        stats.levelsEvicted++;
+
+        // Keeps it from being streamed right back in next frame, RequestLevel holds it there
+        if (victim->wantedLevel < victim->residentLevel) victim->wantedLevel = victim->residentLevel;
+        victim->evictedLevel = victim->residentLevel;
+        victim->evictedUntilFrame = frameIndex + TEXTURE_STREAMING_EVICTED_FRAMES;
+    }
+
+    stats.textureCount = textures.size();
+    stats.residentBytes = residentBytes;
+}
+
+TextureStreamingStats TextureStreamer::GetStats()
+{
+    return stats;
+}
+
+void TextureStreamer::Shutdown()
+{
+    if (!running) return;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        running = false;
+    }
+
+    queueCondition.notify_all();
+    ioThread.join();
+
+    readQueue.clear();
+    finishedQueue.clear();
+    textures.clear();
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <GL\glew.h>
+
+#include "Config.h"
+#include "Texture.h"
+#include "TextureCooker.h"
+#include "TextureRegistry.h"
+
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+using std::deque;
+
+struct TextureStreamingStats
+{
+    size_t textureCount;
+    size_t residentBytes;
+    size_t budgetBytes;
+    size_t pendingRequests;
+    size_t levelsLoaded;
+    size_t levelsEvicted;
+};
+
+/*
+    Mip level streaming of cooked textures.
+
+    Streamed textures start with only their small levels. Every frame the
+    renderer says which level it would like for each texture it drew
+    (RequestLevel), a background thread reads the missing levels from the
+    cooked DDS, and Update() uploads them and moves the base level down.
+    When the resident levels go over the budget, the biggest level of the
+    least recently wanted texture is dropped, and it stays down for a while
+    and until there's room for it again, so it doesn't bounce every frame.
+*/
+class TextureStreamer
+{
+public:
+
+    static void Init(size_t budgetBytes);
+    static bool IsRunning() { return running; }
+
+    // Called by the texture loader once the small levels are uploaded
+    static void Register(const TextureHandle& texture, const string& fileLocation, uint32_t flags, const CookedTexture& cooked);
+
+    // The finest level the renderer could use this frame for the texture
+    static void RequestLevel(Texture* texture, int32_t level);
+
+    // Uploads finished reads, sends new ones and keeps the budget. Call once per frame from the GL thread
+    static void Update();
+
+    static TextureStreamingStats GetStats();
+
+    static void Shutdown();
+
+private:
+
+    struct StreamedTexture
+    {
+        weak_ptr<Texture> texture;
+        string fileLocation;
+        uint32_t flags;
+
+        vector<size_t> levelSizes;
+        int32_t residentLevel;          // Biggest level in VRAM
+        int32_t startLevel;             // Never evicted past this one
+        int32_t wantedLevel;
+        uint64_t lastWantedFrame;
+        bool loading;
+
+        int32_t evictedLevel;           // Requests don't go past this one until evictedUntilFrame
+        uint64_t evictedUntilFrame;
+
+        uint64_t registration;          // The address can come back with another texture
+    };
+
+    struct LevelRead
+    {
+        Texture* key;
+        uint64_t registration;
+        string fileLocation;
+        uint32_t flags;
+        uint32_t firstLevel, endLevel;
+
+        bool succeeded;
+        CookedTexture cooked;
+    };
+
+    static bool running;
+    static std::thread ioThread;
+
+    static std::mutex queueMutex;
+    static std::condition_variable queueCondition;
+    static deque<LevelRead> readQueue;
+    static deque<LevelRead> finishedQueue;
+
+    // Only touched on the GL thread
+    static std::unordered_map<Texture*, StreamedTexture> textures;
+    static uint64_t frameIndex;
+    static uint64_t nextRegistration;
+    static TextureStreamingStats stats;
+
+    static void IOLoop();
+
+    static size_t GetResidentSize(const StreamedTexture& streamed);
+    static void EnforceBudget();
+};
@@ -0,0 +1,113 @@
+#include "VertexConverter.h"
+
+#include <float.h>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define VERTEX_CONVERTER_SSE2 1
+#include <emmintrin.h>
+#else
+#define VERTEX_CONVERTER_SSE2 0
+#endif
+
+// The loads below read the components as packed floats
+static_assert(sizeof(aiVector3D) == 3 * sizeof(float), "Assimp built with double precision");
+
+void VertexConverter::ConvertVertex(const aiMesh* mesh, size_t i, GLfloat* output, glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+    const aiVector3D& position = mesh->mVertices[i];
+    glm::vec3 point(position.x, position.y, position.z);
+
+    boundsMin = glm::min(boundsMin, point);
+    boundsMax = glm::max(boundsMax, point);
+
+    output[0] = position.x;
+    output[1] = position.y;
+    output[2] = position.z;
+
+    // Check if the Texture exists
+    output[3] = mesh->mTextureCoords[0] ? mesh->mTextureCoords[0][i].x : 0.0f;
+    output[4] = mesh->mTextureCoords[0] ? mesh->mTextureCoords[0][i].y : 0.0f;
+
+    // Minus because they are not negative in the FRAG SHADER as normaly are
+    output[5] = mesh->mNormals ? -mesh->mNormals[i].x : 0.0f;
+    output[6] = mesh->mNormals ? -mesh->mNormals[i].y : 0.0f;
+    output[7] = mesh->mNormals ? -mesh->mNormals[i].z : 0.0f;
+}
+
+void VertexConverter::ConvertVertices(const aiMesh* mesh, GLfloat* output, glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+    boundsMin = glm::vec3(FLT_MAX);
+    boundsMax = glm::vec3(-FLT_MAX);
+
+    size_t vertexCount = mesh->mNumVertices;
+    size_t i = 0;
+
+#if VERTEX_CONVERTER_SSE2
+    const float* positions = &mesh->mVertices[0].x;
+    const float* texCoords = mesh->mTextureCoords[0] ? &mesh->mTextureCoords[0][0].x : nullptr;
+    const float* normals = mesh->mNormals ? &mesh->mNormals[0].x : nullptr;
+
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 zero = _mm_setzero_ps();
+
+    __m128 lowest = _mm_set1_ps(FLT_MAX);
+    __m128 highest = _mm_set1_ps(-FLT_MAX);
+
+    // Each load takes x y z and the next vertex's x, so the last vertex is left for the scalar path
+    for (; i + 1 < vertexCount; i++)
+    {
+        __m128 position = _mm_loadu_ps(positions + i * 3);
+        __m128 texCoord = texCoords ? _mm_loadu_ps(texCoords + i * 3) : zero;
+        __m128 normal = normals ? _mm_xor_ps(_mm_loadu_ps(normals + i * 3), signMask) : zero;
+
+        // x y z u
+        __m128 zu = _mm_shuffle_ps(position, texCoord, _MM_SHUFFLE(0, 0, 2, 2));
+        __m128 low = _mm_shuffle_ps(position, zu, _MM_SHUFFLE(2, 0, 1, 0));
+
+        // v -nx -ny -nz
+        __m128 vn = _mm_shuffle_ps(texCoord, normal, _MM_SHUFFLE(0, 0, 1, 1));
+        __m128 high = _mm_shuffle_ps(vn, normal, _MM_SHUFFLE(2, 1, 2, 0));
+
+        _mm_storeu_ps(output + i * VERTEX_FLOATS, low);
+        _mm_storeu_ps(output + i * VERTEX_FLOATS + 4, high);
+
+        // The fourth lane is the next x, it's dropped below
+        lowest = _mm_min_ps(lowest, position);
+        highest = _mm_max_ps(highest, position);
+    }
+
+    float lowestLanes[4], highestLanes[4];
+    _mm_storeu_ps(lowestLanes, lowest);
+    _mm_storeu_ps(highestLanes, highest);
+
+    if (i > 0)
+    {
+        boundsMin = glm::vec3(lowestLanes[0], lowestLanes[1], lowestLanes[2]);
+        boundsMax = glm::vec3(highestLanes[0], highestLanes[1], highestLanes[2]);
+    }
+#endif
+
+    for (; i < vertexCount; i++)
+    {
+        ConvertVertex(mesh, i, output + i * VERTEX_FLOATS, boundsMin, boundsMax);
+    }
+}
+
+void VertexConverter::ConvertIndices(const aiMesh* mesh, vector<uint32_t>& indices)
+{
+    size_t indexCount = 0;
+    for (size_t i = 0; i < mesh->mNumFaces; i++) indexCount += mesh->mFaces[i].mNumIndices;
+
+    indices.resize(indexCount);
+    uint32_t* output = indices.data();
+
+    for (size_t i = 0; i < mesh->mNumFaces; i++)
+    {
+        const aiFace& face = mesh->mFaces[i];
+
+        for (size_t j = 0; j < face.mNumIndices; j++)
+        {
+            *output++ = face.mIndices[j];
+        }
+    }
+}
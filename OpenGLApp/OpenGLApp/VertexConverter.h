@@ -0,0 +1,40 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+
+#include <assimp\mesh.h>
+
+using std::cerr;
+using std::endl;
+using std::vector;
+
+/*
+    Assimp mesh to the engine's vertex layout, in one pass.
+
+    Assimp keeps positions, texture coordinates and normals in separate
+    arrays. The converter reads the three streams and writes each vertex
+    straight into its final place (position, uv, negated normal, 8 floats),
+    with SSE2 shuffles when the compiler targets it, so the output array
+    is the one that goes into the mesh cache and glBufferData.
+*/
+class VertexConverter
+{
+public:
+
+    static const uint32_t VERTEX_FLOATS = 8;
+
+    // output has room for mNumVertices * VERTEX_FLOATS floats. Also gives the position bounds
+    static void ConvertVertices(const aiMesh* mesh, GLfloat* output, glm::vec3& boundsMin, glm::vec3& boundsMax);
+
+    // Face indices one after the other, sized once
+    static void ConvertIndices(const aiMesh* mesh, vector<uint32_t>& indices);
+
+private:
+
+    // One vertex at a time, for the last one (the SSE loads read a float past it) and without SSE2
+    static void ConvertVertex(const aiMesh* mesh, size_t i, GLfloat* output, glm::vec3& boundsMin, glm::vec3& boundsMax);
+};
@@ -0,0 +1,389 @@
+#include "VirtualPageTable.h"
+
+#include <algorithm>
+
+const uint32_t VirtualPageTable::WHITE_PAGE_ENTRY;
+const uint32_t VirtualPageTable::NO_PAGE;
+
+VirtualPageTable::VirtualPageTable()
+{
+    tablePages = 0;
+    cachePages = 0;
+    nextGeneration = 1;
+    lastFeedbackFrame = 0;
+    entriesDirty = false;
+}
+
+void VirtualPageTable::Init(int32_t tablePages, int32_t cachePages)
+{
+    Clear();
+
+    this->tablePages = tablePages;
+    this->cachePages = cachePages;
+
+    int32_t levelCount = 1;
+    while ((tablePages >> levelCount) > 0) levelCount++;
+
+    tableLevels.resize(levelCount);
+
+    for (int32_t level = 0; level < levelCount; level++)
+    {
+        int32_t levelSize = tablePages >> level;
+        tableLevels[level].assign((size_t)levelSize * levelSize, WHITE_PAGE_ENTRY);
+    }
+
+    regionOwners.assign((size_t)tablePages * tablePages, -1);
+
+    CacheSlot freeSlot = { NO_PAGE, 0 };
+    cacheSlots.assign((size_t)cachePages * cachePages, freeSlot);
+
+    entriesDirty = true;
+}
+
+void VirtualPageTable::Clear()
+{
+    regions.clear();
+    regionOwners.clear();
+    cacheSlots.clear();
+    residentPages.clear();
+    pendingPages.clear();
+    tableLevels.clear();
+
+    tablePages = 0;
+    cachePages = 0;
+    lastFeedbackFrame = 0;
+    entriesDirty = false;
+}
+
+uint32_t VirtualPageTable::MakeKey(int32_t level, int32_t pageX, int32_t pageY)
+{
+    return ((uint32_t)level << 16) | ((uint32_t)pageY << 8) | (uint32_t)pageX;
+}
+
+void VirtualPageTable::SplitKey(uint32_t key, int32_t& level, int32_t& pageX, int32_t& pageY)
+{
+    level = (int32_t)(key >> 16);
+    pageX = (int32_t)(key & 0xFF);
+    pageY = (int32_t)((key >> 8) & 0xFF);
+}
+
+int32_t VirtualPageTable::GetPagesAcross(int32_t width, int32_t height, int32_t pageSize, int32_t maxRegionPages, int32_t& maxLevel)
+{
+    int32_t pagesAcross = 1;
+    maxLevel = 0;
+
+    // Square power of two regions, so every level halves cleanly
+    while (pagesAcross * pageSize < std::max(width, height) && pagesAcross < maxRegionPages)
+    {
+        pagesAcross *= 2;
+        maxLevel++;
+    }
+
+    return pagesAcross;
+}
+
+bool VirtualPageTable::FindSpace(int32_t pagesAcross, int32_t& originX, int32_t& originY) const
+{
+    // Regions are aligned to their size, so each one maps to whole pages on every level
+    for (int32_t y = 0; y + pagesAcross <= tablePages; y += pagesAcross)
+    {
+        for (int32_t x = 0; x + pagesAcross <= tablePages; x += pagesAcross)
+        {
+            bool free = true;
+
+            for (int32_t py = y; py < y + pagesAcross && free; py++)
+            {
+                for (int32_t px = x; px < x + pagesAcross && free; px++)
+                {
+                    free = regionOwners[(size_t)py * tablePages + px] < 0;
+                }
+            }
+
+            if (free)
+            {
+                originX = x;
+                originY = y;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+int32_t VirtualPageTable::AddRegion(int32_t pagesAcross, int32_t maxLevel)
+{
+    VirtualRegion region;
+    region.pagesAcross = pagesAcross;
+    region.maxLevel = maxLevel;
+    region.used = true;
+
+    if (pagesAcross <= 0 || !FindSpace(pagesAcross, region.originX, region.originY)) return -1;
+
+    region.generation = nextGeneration++;
+
+    int32_t regionID = 0;
+    while (regionID < (int32_t)regions.size() && regions[regionID].used) regionID++;
+
+    if (regionID == (int32_t)regions.size())
+    {
+        regions.push_back(region);
+    }
+    else
+    {
+        regions[regionID] = region;
+    }
+
+    for (int32_t py = region.originY; py < region.originY + pagesAcross; py++)
+    {
+        for (int32_t px = region.originX; px < region.originX + pagesAcross; px++)
+        {
+            regionOwners[(size_t)py * tablePages + px] = regionID;
+        }
+    }
+
+    entriesDirty = true;
+
+    return regionID;
+}
+
+void VirtualPageTable::RemoveRegion(int32_t regionID)
+{
+    const VirtualRegion* region = GetRegion(regionID);
+    if (!region) return;
+
+    // Slot 0 is the white page
+    for (size_t slot = 1; slot < cacheSlots.size(); slot++)
+    {
+        if (cacheSlots[slot].key == NO_PAGE || GetOwner(cacheSlots[slot].key) != regionID) continue;
+
+        residentPages.erase(cacheSlots[slot].key);
+        cacheSlots[slot].key = NO_PAGE;
+        cacheSlots[slot].lastUsedFrame = 0;
+    }
+
+    // So a texture that gets this space next can ask for the same keys
+    for (auto pending = pendingPages.begin(); pending != pendingPages.end();)
+    {
+        if (GetOwner(*pending) == regionID)
+        {
+            pending = pendingPages.erase(pending);
+        }
+        else
+        {
+            ++pending;
+        }
+    }
+
+    for (int32_t py = region->originY; py < region->originY + region->pagesAcross; py++)
+    {
+        for (int32_t px = region->originX; px < region->originX + region->pagesAcross; px++)
+        {
+            regionOwners[(size_t)py * tablePages + px] = -1;
+        }
+    }
+
+    regions[regionID].used = false;
+    entriesDirty = true;
+}
+
+const VirtualRegion* VirtualPageTable::GetRegion(int32_t regionID) const
+{
+    if (regionID < 0 || regionID >= (int32_t)regions.size() || !regions[regionID].used) return nullptr;
+
+    return &regions[regionID];
+}
+
+int32_t VirtualPageTable::GetOwner(uint32_t key) const
+{
+    int32_t level, pageX, pageY;
+    SplitKey(key, level, pageX, pageY);
+
+    if (level >= GetLevelCount()) return -1;
+
+    int32_t levelSize = tablePages >> level;
+    if (pageX >= levelSize || pageY >= levelSize) return -1;
+
+    int32_t owner = regionOwners[(size_t)(pageY << level) * tablePages + (pageX << level)];
+
+    // Past its last level a page covers other textures too
+    if (owner < 0 || level > regions[owner].maxLevel) return -1;
+
+    return owner;
+}
+
+void VirtualPageTable::DecodeFeedback(const uint8_t* pixels, size_t byteCount, std::unordered_set<uint32_t>& keys) const
+{
+    int32_t levelCount = GetLevelCount();
+
+    for (size_t p = 0; p + 3 < byteCount; p += 4)
+    {
+        if (pixels[p + 3] == 0) continue;
+
+        int32_t level = pixels[p + 2];
+        if (level >= levelCount) continue;
+
+        int32_t levelSize = tablePages >> level;
+        if (pixels[p] >= levelSize || pixels[p + 1] >= levelSize) continue;
+
+        keys.insert(MakeKey(level, pixels[p], pixels[p + 1]));
+    }
+}
+
+void VirtualPageTable::CollectRequests(const std::unordered_set<uint32_t>& feedbackKeys, uint64_t frame, size_t maxPending, vector<uint32_t>& requests)
+{
+    lastFeedbackFrame = frame;
+
+    std::unordered_set<uint32_t> wanted;
+
+    for (uint32_t key : feedbackKeys)
+    {
+        int32_t owner = GetOwner(key);
+        if (owner < 0) continue;
+
+        int32_t level, pageX, pageY;
+        SplitKey(key, level, pageX, pageY);
+
+        // Walks up until a resident page, asking for every missing one on the way
+        // so the texture sharpens a level at a time
+        while (level <= regions[owner].maxLevel)
+        {
+            uint32_t pageKey = MakeKey(level, pageX, pageY);
+            auto resident = residentPages.find(pageKey);
+
+            if (resident != residentPages.end())
+            {
+                cacheSlots[resident->second].lastUsedFrame = frame;
+                break;
+            }
+
+            if (pendingPages.find(pageKey) == pendingPages.end())
+            {
+                wanted.insert(pageKey);
+            }
+
+            level++;
+            pageX /= 2;
+            pageY /= 2;
+        }
+    }
+
+    // Coarse levels first, they cover the most screen
+    vector<uint32_t> keys(wanted.begin(), wanted.end());
+    std::sort(keys.begin(), keys.end(), [](uint32_t a, uint32_t b) { return a > b; });
+
+    for (uint32_t key : keys)
+    {
+        if (pendingPages.size() >= maxPending) break;
+
+        requests.push_back(key);
+        pendingPages.insert(key);
+    }
+}
+
+int32_t VirtualPageTable::FindFreeSlot()
+{
+    int32_t victim = -1;
+
+    // Slot 0 is the white page
+    for (int32_t slot = 1; slot < (int32_t)cacheSlots.size(); slot++)
+    {
+        if (cacheSlots[slot].key == NO_PAGE) return slot;
+
+        // Pages seen in the latest feedback stay
+        if (cacheSlots[slot].lastUsedFrame >= lastFeedbackFrame) continue;
+
+        if (victim < 0 || cacheSlots[slot].lastUsedFrame < cacheSlots[victim].lastUsedFrame)
+        {
+            victim = slot;
+        }
+    }
+
+    if (victim >= 0)
+    {
+        residentPages.erase(cacheSlots[victim].key);
+        cacheSlots[victim].key = NO_PAGE;
+        entriesDirty = true;
+    }
+
+    return victim;
+}
+
+int32_t VirtualPageTable::PlacePage(uint32_t key, uint32_t generation, bool succeeded, uint64_t frame)
+{
+    // Asked for by a texture that was removed since. Its pending entry went with it,
+    // and the key may be pending again for whoever has the space now
+    int32_t owner = GetOwner(key);
+    if (owner < 0 || regions[owner].generation != generation) return -1;
+
+    pendingPages.erase(key);
+
+    if (!succeeded || residentPages.find(key) != residentPages.end()) return -1;
+
+    // Everything in the cache is on screen, the page waits for the next feedback
+    int32_t slot = FindFreeSlot();
+    if (slot < 0) return -1;
+
+    cacheSlots[slot].key = key;
+    cacheSlots[slot].lastUsedFrame = frame;
+    residentPages[key] = slot;
+    entriesDirty = true;
+
+    return slot;
+}
+
+bool VirtualPageTable::UpdateEntries()
+{
+    if (!entriesDirty) return false;
+
+    // Coarsest first, so missing pages can copy their parent's entry
+    for (int32_t level = GetLevelCount() - 1; level >= 0; level--)
+    {
+        int32_t levelSize = tablePages >> level;
+        vector<uint32_t>& entries = tableLevels[level];
+
+        for (int32_t y = 0; y < levelSize; y++)
+        {
+            for (int32_t x = 0; x < levelSize; x++)
+            {
+                uint32_t& entry = entries[(size_t)y * levelSize + x];
+                uint32_t key = MakeKey(level, x, y);
+                int32_t owner = GetOwner(key);
+
+                if (owner < 0)
+                {
+                    entry = WHITE_PAGE_ENTRY;
+                    continue;
+                }
+
+                auto resident = residentPages.find(key);
+
+                if (resident != residentPages.end())
+                {
+                    uint32_t slotX = (uint32_t)(resident->second % cachePages);
+                    uint32_t slotY = (uint32_t)(resident->second / cachePages);
+                    entry = slotX | (slotY << 8) | ((uint32_t)level << 16) | 0xFF000000;
+                }
+                else if (level < regions[owner].maxLevel)
+                {
+                    entry = tableLevels[level + 1][(size_t)(y / 2) * (levelSize / 2) + x / 2];
+                }
+                else
+                {
+                    entry = WHITE_PAGE_ENTRY;
+                }
+            }
+        }
+    }
+
+    entriesDirty = false;
+
+    return true;
+}
+
+int32_t VirtualPageTable::FindSlot(uint32_t key) const
+{
+    auto resident = residentPages.find(key);
+
+    return resident != residentPages.end() ? resident->second : -1;
+}
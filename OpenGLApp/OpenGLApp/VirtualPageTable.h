@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+using std::vector;
+
+// Part of the virtual page space given to one texture
+struct VirtualRegion
+{
+    int32_t originX, originY;       // Level 0 pages
+    int32_t pagesAcross;
+    int32_t maxLevel;               // Level where the whole texture fits in one page
+    uint32_t generation;            // Changes every time the id is given out, so late pages of a removed texture are dropped
+    bool used;
+};
+
+/*
+    Bookkeeping of the virtual texture, without any GL.
+
+    Owns the regions of the virtual page space, the LRU of the physical
+    cache slots, the pages in flight and the page table entries.
+    VirtualTexture feeds it the feedback readback and the loaded pages and
+    uploads what it says, so all of this can be tested without a context.
+*/
+class VirtualPageTable
+{
+public:
+
+    // Slot 0 of the cache is a white page, for virtual pages with nothing resident
+    static const uint32_t WHITE_PAGE_ENTRY = 0xFF000000;
+    static const uint32_t NO_PAGE = UINT32_MAX;
+
+    VirtualPageTable();
+
+    // tablePages level 0 pages across the virtual space, cachePages across the physical cache. Both up to 256
+    void Init(int32_t tablePages, int32_t cachePages);
+    void Clear();
+
+    static uint32_t MakeKey(int32_t level, int32_t pageX, int32_t pageY);
+    static void SplitKey(uint32_t key, int32_t& level, int32_t& pageX, int32_t& pageY);
+
+    // Pages across the square power of two region of a texture, and its last level
+    static int32_t GetPagesAcross(int32_t width, int32_t height, int32_t pageSize, int32_t maxRegionPages, int32_t& maxLevel);
+
+    // Returns the id of the region, -1 when there's no aligned space left. Ids of removed regions are reused
+    int32_t AddRegion(int32_t pagesAcross, int32_t maxLevel);
+
+    // Frees the space and the cache slots of its pages, the pages still in flight are dropped when they arrive
+    void RemoveRegion(int32_t regionID);
+
+    // nullptr for a removed or unknown id
+    const VirtualRegion* GetRegion(int32_t regionID) const;
+
+    // Region a page of any level is in, -1 when nobody owns it
+    int32_t GetOwner(uint32_t key) const;
+
+    // Page keys of the visible pixels of an RGBA8 feedback readback. x, y = page, z = level, alpha 0 = no page
+    void DecodeFeedback(const uint8_t* pixels, size_t byteCount, std::unordered_set<uint32_t>& keys) const;
+
+    // Marks the resident pages of the feedback as used this frame, and returns the missing ones and their
+    // missing parents, coarsest first, at most until maxPending are in flight. They count as pending from now on
+    void CollectRequests(const std::unordered_set<uint32_t>& feedbackKeys, uint64_t frame, size_t maxPending, vector<uint32_t>& requests);
+
+    // A requested page arrived. Returns the cache slot to upload it to, or -1 when it's dropped: it failed,
+    // its region was removed since, or every slot holds a page of the latest feedback
+    int32_t PlacePage(uint32_t key, uint32_t generation, bool succeeded, uint64_t frame);
+
+    // Fills the entries again if a page came or went. The caller uploads them
+    bool UpdateEntries();
+    const vector<uint32_t>& GetEntries(int32_t level) const { return tableLevels[level]; }
+    int32_t GetLevelCount() const { return (int32_t)tableLevels.size(); }
+
+    int32_t GetTablePages() const { return tablePages; }
+    int32_t GetCachePages() const { return cachePages; }
+    size_t GetResidentPageCount() const { return residentPages.size(); }
+    size_t GetPendingPageCount() const { return pendingPages.size(); }
+
+    // Cache slot of a resident page, -1 if it isn't in
+    int32_t FindSlot(uint32_t key) const;
+
+private:
+
+    struct CacheSlot
+    {
+        uint32_t key;                   // NO_PAGE when free
+        uint64_t lastUsedFrame;
+    };
+
+    int32_t tablePages, cachePages;
+
+    vector<VirtualRegion> regions;
+    vector<int32_t> regionOwners;                   // Region of each level 0 page, -1 when free
+    uint32_t nextGeneration;
+
+    vector<CacheSlot> cacheSlots;
+    std::unordered_map<uint32_t, int32_t> residentPages;
+    std::unordered_set<uint32_t> pendingPages;
+    uint64_t lastFeedbackFrame;
+
+    vector<vector<uint32_t>> tableLevels;
+    bool entriesDirty;
+
+    bool FindSpace(int32_t pagesAcross, int32_t& originX, int32_t& originY) const;
+    int32_t FindFreeSlot();
+};
@@ -0,0 +1,599 @@
+#include "VirtualTexture.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <fstream>
+
+using std::ifstream;
+using std::ofstream;
+
+// Page coordinates go in 8 bit texels of the page table and the feedback target
+static_assert(VT_TABLE_PAGES <= 256 && VT_CACHE_PAGES <= 256, "Virtual page coordinates must fit in a byte");
+
+// Written in front of every page file
+struct VirtualPageHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceTime;
+    uint64_t sourceSize;
+    uint32_t pageSize;
+    uint32_t pageBorder;
+    uint32_t pagesAcross;
+    uint32_t levelCount;
+};
+
+static const uint32_t VIRTUAL_PAGE_MAGIC = 0x54564F4D;     // "MOVT"
+static const uint32_t VIRTUAL_PAGE_VERSION = 1;
+
+static const int32_t PAGE_TEXELS = VT_PAGE_SIZE + 2 * VT_PAGE_BORDER;
+static const size_t PAGE_BYTES = (size_t)PAGE_TEXELS * PAGE_TEXELS * 4;
+
+bool VirtualTexture::running = false;
+std::thread VirtualTexture::ioThread;
+
+std::mutex VirtualTexture::queueMutex;
+std::condition_variable VirtualTexture::queueCondition;
+deque<VirtualTexture::PageRequest> VirtualTexture::requestQueue;
+deque<VirtualTexture::LoadedPage> VirtualTexture::loadedQueue;
+
+vector<VirtualTexture::VirtualTextureInfo> VirtualTexture::textures;
+VirtualPageTable VirtualTexture::pages;
+uint64_t VirtualTexture::frameIndex = 0;
+
+GLuint VirtualTexture::pageTable = 0;
+GLuint VirtualTexture::pageCache = 0;
+GLuint VirtualTexture::feedbackFBO = 0;
+GLuint VirtualTexture::feedbackColour = 0;
+GLuint VirtualTexture::feedbackDepth = 0;
+GLuint VirtualTexture::feedbackBuffers[VT_FEEDBACK_FRAMES] = {};
+GLsync VirtualTexture::feedbackFences[VT_FEEDBACK_FRAMES] = {};
+uint32_t VirtualTexture::feedbackSlot = 0;
+int32_t VirtualTexture::feedbackWidth = 0;
+int32_t VirtualTexture::feedbackHeight = 0;
+
+bool VirtualTexture::Init(int32_t screenWidth, int32_t screenHeight)
+{
+    if (running) return true;
+
+    pages.Init(VT_TABLE_PAGES, VT_CACHE_PAGES);
+    int32_t tableLevels = pages.GetLevelCount();
+
+    // One texel per virtual page, nearest so the entries are never blended
+    glGenTextures(1, &pageTable);
+    glBindTexture(GL_TEXTURE_2D, pageTable);
+
+    for (int32_t level = 0; level < tableLevels; level++)
+    {
+        int32_t levelSize = VT_TABLE_PAGES >> level;
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, levelSize, levelSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, tableLevels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    // The physical pages, the borders take care of the filtering at the page edges
+    int32_t cacheSize = VT_CACHE_PAGES * PAGE_TEXELS;
+
+    glGenTextures(1, &pageCache);
+    glBindTexture(GL_TEXTURE_2D, pageCache);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, cacheSize, cacheSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    vector<uint8_t> whitePage(PAGE_BYTES, 255);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, PAGE_TEXELS, PAGE_TEXELS, GL_RGBA, GL_UNSIGNED_BYTE, whitePage.data());
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Feedback target, with its own depth so only the visible surfaces ask for pages
+    feedbackWidth = std::max(screenWidth / VT_FEEDBACK_DIVISOR, 1);
+    feedbackHeight = std::max(screenHeight / VT_FEEDBACK_DIVISOR, 1);
+
+    glGenTextures(1, &feedbackColour);
+    glBindTexture(GL_TEXTURE_2D, feedbackColour);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, feedbackWidth, feedbackHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenRenderbuffers(1, &feedbackDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, feedbackDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, feedbackWidth, feedbackHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &feedbackFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, feedbackFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, feedbackColour, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedbackDepth);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        cerr << "\n\nERROR: Virtual texture feedback framebuffer incomplete: " << status << ".\n" << endl;
+        running = true;
+        Shutdown();
+        return false;
+    }
+
+    // Read back a few frames later, so the readback never waits on the GPU
+    glGenBuffers(VT_FEEDBACK_FRAMES, feedbackBuffers);
+
+    for (size_t i = 0; i < VT_FEEDBACK_FRAMES; i++)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackBuffers[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)feedbackWidth * feedbackHeight * 4, nullptr, GL_STREAM_READ);
+        feedbackFences[i] = 0;
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    feedbackSlot = 0;
+
+    frameIndex = 0;
+
+    running = true;
+    ioThread = std::thread(IOLoop);
+
+    cerr << "Virtual texturing: " << VT_TABLE_PAGES * VT_PAGE_SIZE << " texels virtual space, "
+         << VT_CACHE_PAGES * VT_CACHE_PAGES - 1 << " physical pages" << endl;
+
+    return true;
+}
+
+int32_t VirtualTexture::AddTexture(const string& fileLocation, uint32_t flags)
+{
+    if (!running) return -1;
+
+    // Only the header, the pixels are read when the pages are cooked
+    int32_t width = 0, height = 0, channels = 0;
+
+    AssetFile file;
+
+    if (!file.Open(fileLocation) || file.GetSize() > INT32_MAX ||
+        !stbi_info_from_memory(file.GetData(), (int)file.GetSize(), &width, &height, &channels))
+    {
+        cerr << "\n\nERROR: Failed to find the virtual texture " << fileLocation << ".\n" << endl;
+        return -1;
+    }
+
+    int32_t maxLevel = 0;
+    int32_t pagesAcross = VirtualPageTable::GetPagesAcross(width, height, VT_PAGE_SIZE, VT_MAX_REGION_PAGES, maxLevel);
+    int32_t textureID = pages.AddRegion(pagesAcross, maxLevel);
+
+    if (textureID < 0)
+    {
+        cerr << "\n\nERROR: The virtual texture space is full, can't add " << fileLocation << ".\n" << endl;
+        return -1;
+    }
+
+    const VirtualRegion* region = pages.GetRegion(textureID);
+
+    VirtualTextureInfo info;
+    info.fileLocation = fileLocation;
+    info.flags = flags & TEXTURE_FLIP_VERTICAL;
+    info.originX = region->originX;
+    info.originY = region->originY;
+    info.pagesAcross = region->pagesAcross;
+    info.maxLevel = region->maxLevel;
+
+    if (textureID >= (int32_t)textures.size()) textures.resize(textureID + 1);
+    textures[textureID] = info;
+
+    return textureID;
+}
+
+void VirtualTexture::RemoveTexture(int32_t textureID)
+{
+    if (!running || !pages.GetRegion(textureID)) return;
+
+    // Its entries go white on the next Update, pages still on the IO thread are dropped when they arrive
+    pages.RemoveRegion(textureID);
+    textures[textureID] = VirtualTextureInfo();
+}
+
+glm::vec4 VirtualTexture::GetRegion(int32_t textureID)
+{
+    const VirtualRegion* region = pages.GetRegion(textureID);
+    if (!region) return glm::vec4(-1.0f);
+
+    return glm::vec4((float)region->originX, (float)region->originY, (float)region->pagesAcross, (float)region->maxLevel);
+}
+
+float VirtualTexture::GetFeedbackBias()
+{
+    return log2f((float)VT_FEEDBACK_DIVISOR);
+}
+
+void VirtualTexture::BeginFeedback()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, feedbackFBO);
+    glViewport(0, 0, feedbackWidth, feedbackHeight);
+
+    // Alpha 0 is "no page"
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void VirtualTexture::EndFeedback()
+{
+    // The GPU is behind by more than the ring, that old readback is dropped
+    if (feedbackFences[feedbackSlot])
+    {
+        glDeleteSync(feedbackFences[feedbackSlot]);
+        feedbackFences[feedbackSlot] = 0;
+    }
+
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackBuffers[feedbackSlot]);
+
+    // Into the pixel buffer, returns right away
+    glReadPixels(0, 0, feedbackWidth, feedbackHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    feedbackFences[feedbackSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    feedbackSlot = (feedbackSlot + 1) % VT_FEEDBACK_FRAMES;
+}
+
+void VirtualTexture::Update()
+{
+    if (!running) return;
+
+    frameIndex++;
+
+    ReadFeedback();
+    UploadPages();
+    UpdatePageTable();
+}
+
+void VirtualTexture::ReadFeedback()
+{
+    std::unordered_set<uint32_t> feedbackKeys;
+    bool readAny = false;
+
+    for (size_t i = 0; i < VT_FEEDBACK_FRAMES; i++)
+    {
+        if (!feedbackFences[i]) continue;
+
+        // Only readbacks the GPU is done with
+        GLenum result = glClientWaitSync(feedbackFences[i], 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) continue;
+
+        glDeleteSync(feedbackFences[i]);
+        feedbackFences[i] = 0;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackBuffers[i]);
+        GLsizeiptr feedbackSize = (GLsizeiptr)feedbackWidth * feedbackHeight * 4;
+        const uint8_t* pixels = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, feedbackSize, GL_MAP_READ_BIT);
+
+        if (pixels)
+        {
+            pages.DecodeFeedback(pixels, (size_t)feedbackSize, feedbackKeys);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            readAny = true;
+        }
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (!readAny) return;
+
+    vector<uint32_t> keys;
+    pages.CollectRequests(feedbackKeys, frameIndex, VT_MAX_PENDING_PAGES, keys);
+
+    SendRequests(keys);
+}
+
+void VirtualTexture::SendRequests(const vector<uint32_t>& keys)
+{
+    vector<PageRequest> requests;
+
+    for (uint32_t key : keys)
+    {
+        int32_t level, pageX, pageY;
+        VirtualPageTable::SplitKey(key, level, pageX, pageY);
+        int32_t owner = pages.GetOwner(key);
+
+        PageRequest request;
+        request.key = key;
+        request.generation = pages.GetRegion(owner)->generation;
+        request.info = textures[owner];
+        request.level = level;
+        request.pageX = pageX - (request.info.originX >> level);
+        request.pageY = pageY - (request.info.originY >> level);
+
+        requests.push_back(request);
+    }
+
+    if (requests.empty()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        requestQueue.insert(requestQueue.end(), requests.begin(), requests.end());
+    }
+
+    queueCondition.notify_one();
+}
+
+void VirtualTexture::UploadPages()
+{
+    vector<LoadedPage> loaded;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+
+        while (!loadedQueue.empty() && loaded.size() < VT_PAGE_UPLOADS_PER_FRAME)
+        {
+            loaded.push_back(std::move(loadedQueue.front()));
+            loadedQueue.pop_front();
+        }
+    }
+
+    if (loaded.empty()) return;
+
+    glBindTexture(GL_TEXTURE_2D, pageCache);
+
+    for (LoadedPage& page : loaded)
+    {
+        int32_t slot = pages.PlacePage(page.key, page.generation, page.succeeded, frameIndex);
+        if (slot < 0) continue;
+
+        int32_t slotX = slot % VT_CACHE_PAGES;
+        int32_t slotY = slot / VT_CACHE_PAGES;
+
+        glTexSubImage2D(GL_TEXTURE_2D, 0, slotX * PAGE_TEXELS, slotY * PAGE_TEXELS, PAGE_TEXELS, PAGE_TEXELS,
+                        GL_RGBA, GL_UNSIGNED_BYTE, page.texels.data());
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void VirtualTexture::UpdatePageTable()
+{
+    if (!pages.UpdateEntries()) return;
+
+    glBindTexture(GL_TEXTURE_2D, pageTable);
+
+    for (int32_t level = 0; level < pages.GetLevelCount(); level++)
+    {
+        int32_t levelSize = VT_TABLE_PAGES >> level;
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levelSize, levelSize, GL_RGBA, GL_UNSIGNED_BYTE, pages.GetEntries(level).data());
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void VirtualTexture::UseTextures(GLuint tableUnit, GLuint cacheUnit)
+{
+    if (!running) return;
+
+    glActiveTexture(GL_TEXTURE0 + tableUnit);
+    glBindTexture(GL_TEXTURE_2D, pageTable);
+
+    glActiveTexture(GL_TEXTURE0 + cacheUnit);
+    glBindTexture(GL_TEXTURE_2D, pageCache);
+}
+
+void VirtualTexture::IOLoop()
+{
+    while (true)
+    {
+        PageRequest request;
+
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [] { return !running || !requestQueue.empty(); });
+
+            if (!running) return;
+
+            request = requestQueue.front();
+            requestQueue.pop_front();
+        }
+
+        LoadedPage page;
+        page.key = request.key;
+        page.generation = request.generation;
+        page.succeeded = ReadPage(request, page.texels);
+
+        // First time this texture is used, or its source changed
+        if (!page.succeeded && CookPages(request.info))
+        {
+            page.succeeded = ReadPage(request, page.texels);
+        }
+
+        if (!page.succeeded)
+        {
+            cerr << "\n\nERROR: Failed to read a page of the virtual texture " << request.info.fileLocation << ".\n" << endl;
+        }
+
+        std::lock_guard<std::mutex> lock(queueMutex);
+        loadedQueue.push_back(std::move(page));
+    }
+}
+
+string VirtualTexture::GetPagePath(const string& fileLocation, uint32_t flags)
+{
+    return fileLocation + ((flags & TEXTURE_FLIP_VERTICAL) ? ".f" : "") + ".vt";
+}
+
+bool VirtualTexture::ReadPage(const PageRequest& request, vector<uint8_t>& texels)
+{
+    uint64_t sourceTime = 0, sourceSize = 0;
+    if (!TextureCooker::GetSourceStamp(request.info.fileLocation, sourceTime, sourceSize)) return false;
+
+    ifstream fileStream(GetPagePath(request.info.fileLocation, request.info.flags), std::ios::in | std::ios::binary);
+    if (!fileStream.is_open()) return false;
+
+    VirtualPageHeader header;
+    fileStream.read((char*)&header, sizeof(header));
+
+    bool valid = fileStream.good() &&
+                 header.magic == VIRTUAL_PAGE_MAGIC &&
+                 header.version == VIRTUAL_PAGE_VERSION &&
+                 header.sourceTime == sourceTime &&
+                 header.sourceSize == sourceSize &&
+                 header.pageSize == VT_PAGE_SIZE &&
+                 header.pageBorder == VT_PAGE_BORDER &&
+                 header.pagesAcross == (uint32_t)request.info.pagesAcross &&
+                 (int32_t)header.levelCount > request.level;
+
+    if (!valid) return false;
+
+    // Levels are stored biggest first, pages in rows
+    size_t pageIndex = 0;
+
+    for (int32_t level = 0; level < request.level; level++)
+    {
+        size_t levelPages = (size_t)std::max(request.info.pagesAcross >> level, 1);
+        pageIndex += levelPages * levelPages;
+    }
+
+    size_t levelPages = (size_t)std::max(request.info.pagesAcross >> request.level, 1);
+    pageIndex += (size_t)request.pageY * levelPages + request.pageX;
+
+    fileStream.seekg(sizeof(header) + pageIndex * PAGE_BYTES, std::ios::beg);
+
+    texels.resize(PAGE_BYTES);
+    fileStream.read((char*)texels.data(), PAGE_BYTES);
+
+    return fileStream.good();
+}
+
+bool VirtualTexture::CookPages(const VirtualTextureInfo& info)
+{
+    uint64_t sourceTime = 0, sourceSize = 0;
+    if (!TextureCooker::GetSourceStamp(info.fileLocation, sourceTime, sourceSize)) return false;
+
+    int32_t width = 0, height = 0, channels = 0;
+    unsigned char* pixels = Texture::DecodeFile(info.fileLocation, (info.flags & TEXTURE_FLIP_VERTICAL) != 0, width, height, channels);
+
+    if (!pixels) return false;
+
+    cerr << "\tCooking virtual pages of " << info.fileLocation << " (" << info.pagesAcross << "x" << info.pagesAcross << " pages)..." << endl;
+
+    int32_t levelSize = info.pagesAcross * VT_PAGE_SIZE;
+    vector<uint8_t> levelPixels((size_t)levelSize * levelSize * 4);
+
+    TextureCooker::ResizeToRGBA(pixels, width, height, channels, levelSize, levelSize, levelPixels.data());
+    stbi_image_free(pixels);
+
+    string path = GetPagePath(info.fileLocation, info.flags);
+    ofstream fileStream(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (!fileStream.is_open())
+    {
+        cerr << "\n\nERROR: Failed to write the virtual page file " << path << ".\n" << endl;
+        return false;
+    }
+
+    VirtualPageHeader header;
+    header.magic = VIRTUAL_PAGE_MAGIC;
+    header.version = VIRTUAL_PAGE_VERSION;
+    header.sourceTime = sourceTime;
+    header.sourceSize = sourceSize;
+    header.pageSize = VT_PAGE_SIZE;
+    header.pageBorder = VT_PAGE_BORDER;
+    header.pagesAcross = (uint32_t)info.pagesAcross;
+    header.levelCount = (uint32_t)info.maxLevel + 1;
+
+    fileStream.write((const char*)&header, sizeof(header));
+
+    vector<uint8_t> page(PAGE_BYTES);
+    vector<uint8_t> halved;
+
+    for (int32_t level = 0; level <= info.maxLevel; level++)
+    {
+        int32_t levelPages = std::max(info.pagesAcross >> level, 1);
+
+        for (int32_t pageY = 0; pageY < levelPages; pageY++)
+        {
+            for (int32_t pageX = 0; pageX < levelPages; pageX++)
+            {
+                // The border wraps around, the texture repeats
+                for (int32_t y = 0; y < PAGE_TEXELS; y++)
+                {
+                    int32_t sourceY = ((pageY * VT_PAGE_SIZE + y - VT_PAGE_BORDER) % levelSize + levelSize) % levelSize;
+
+                    for (int32_t x = 0; x < PAGE_TEXELS; x++)
+                    {
+                        int32_t sourceX = ((pageX * VT_PAGE_SIZE + x - VT_PAGE_BORDER) % levelSize + levelSize) % levelSize;
+                        memcpy(&page[((size_t)y * PAGE_TEXELS + x) * 4], &levelPixels[((size_t)sourceY * levelSize + sourceX) * 4], 4);
+                    }
+                }
+
+                fileStream.write((const char*)page.data(), page.size());
+            }
+        }
+
+        if (level < info.maxLevel)
+        {
+            halved.resize((size_t)(levelSize / 2) * (levelSize / 2) * 4);
+            TextureCooker::HalveImage(levelPixels.data(), levelSize, levelSize, 4, halved.data());
+
+            levelPixels.swap(halved);
+            levelSize /= 2;
+        }
+    }
+
+    fileStream.close();
+
+    return !fileStream.fail();
+}
+
+void VirtualTexture::Shutdown()
+{
+    if (!running) return;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        running = false;
+    }
+
+    queueCondition.notify_all();
+
+    if (ioThread.joinable()) ioThread.join();
+
+    requestQueue.clear();
+    loadedQueue.clear();
+
+    for (size_t i = 0; i < VT_FEEDBACK_FRAMES; i++)
+    {
+        if (feedbackFences[i])
+        {
+            glDeleteSync(feedbackFences[i]);
+            feedbackFences[i] = 0;
+        }
+    }
+
+    if (feedbackBuffers[0]) glDeleteBuffers(VT_FEEDBACK_FRAMES, feedbackBuffers);
+
+    for (size_t i = 0; i < VT_FEEDBACK_FRAMES; i++)
+    {
+        feedbackBuffers[i] = 0;
+    }
+
+    if (feedbackFBO) glDeleteFramebuffers(1, &feedbackFBO);
+    if (feedbackDepth) glDeleteRenderbuffers(1, &feedbackDepth);
+    if (feedbackColour) glDeleteTextures(1, &feedbackColour);
+    if (pageCache) glDeleteTextures(1, &pageCache);
+    if (pageTable) glDeleteTextures(1, &pageTable);
+
+    feedbackFBO = 0;
+    feedbackDepth = 0;
+    feedbackColour = 0;
+    pageCache = 0;
+    pageTable = 0;
+
+    textures.clear();
+    pages.Clear();
+}
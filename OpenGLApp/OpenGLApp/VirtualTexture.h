@@ -0,0 +1,131 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+
+#include "Config.h"
+#include "Texture.h"
+#include "TextureCooker.h"
+#include "AssetPack.h"
+#include "VirtualPageTable.h"
+
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+using std::deque;
+
+/*
+    Software virtual texturing.
+
+    Every texture gets a square region of a big virtual page space and is
+    cooked once into a page file (<texture>.vt) of VT_PAGE_SIZE pages with
+    a border, for every mip level. Only the pages the camera sees live in
+    the physical page cache texture, and the page table (one texel per
+    virtual page, with a mip chain) says where each one is. Pages that
+    aren't in yet point to their closest resident parent.
+
+    A low resolution feedback pass writes the page each pixel wants, it's
+    read back a few frames later without stalling, and a background thread
+    reads the missing pages from disk.
+*/
+class VirtualTexture
+{
+public:
+
+    static bool Init(int32_t screenWidth, int32_t screenHeight);
+    static bool IsRunning() { return running; }
+
+    // Returns the id of the texture, -1 if it can't be read. flags are TextureLoadFlags
+    static int32_t AddTexture(const string& fileLocation, uint32_t flags);
+
+    // Gives its space and its cached pages back, the id can be handed out again
+    static void RemoveTexture(int32_t textureID);
+
+    // xy = first page, z = pages across, w = coarsest level. All -1 for an invalid id
+    static glm::vec4 GetRegion(int32_t textureID);
+
+    // The feedback shader is bound between these two
+    static void BeginFeedback();
+    static void EndFeedback();
+
+    // log2 of the feedback downscale, the feedback shader subtracts it from the level
+    static float GetFeedbackBias();
+
+    // Reads the finished feedback, uploads new pages and sends the next requests. Once per frame
+    static void Update();
+
+    static void UseTextures(GLuint tableUnit, GLuint cacheUnit);
+
+    static size_t GetResidentPageCount() { return pages.GetResidentPageCount(); }
+
+    static void Shutdown();
+
+private:
+
+    struct VirtualTextureInfo
+    {
+        string fileLocation;
+        uint32_t flags;
+        int32_t originX, originY;       // Level 0 pages
+        int32_t pagesAcross;
+        int32_t maxLevel;               // Level where the whole texture fits in one page
+    };
+
+    struct PageRequest
+    {
+        uint32_t key;
+        uint32_t generation;            // Of the region, pages of a removed texture are dropped
+        VirtualTextureInfo info;
+        int32_t level, pageX, pageY;    // Inside the texture
+    };
+
+    struct LoadedPage
+    {
+        uint32_t key;
+        uint32_t generation;
+        bool succeeded;
+        vector<uint8_t> texels;         // RGBA, with the border
+    };
+
+    static bool running;
+    static std::thread ioThread;
+
+    static std::mutex queueMutex;
+    static std::condition_variable queueCondition;
+    static deque<PageRequest> requestQueue;
+    static deque<LoadedPage> loadedQueue;
+
+    // Only touched on the GL thread
+    static vector<VirtualTextureInfo> textures;             // By region id
+    static VirtualPageTable pages;
+    static uint64_t frameIndex;
+
+    static GLuint pageTable, pageCache;
+    static GLuint feedbackFBO, feedbackColour, feedbackDepth;
+    static GLuint feedbackBuffers[VT_FEEDBACK_FRAMES];
+    static GLsync feedbackFences[VT_FEEDBACK_FRAMES];
+    static uint32_t feedbackSlot;
+    static int32_t feedbackWidth, feedbackHeight;
+
+    static void ReadFeedback();
+    static void SendRequests(const vector<uint32_t>& keys);
+    static void UploadPages();
+    static void UpdatePageTable();
+
+    static void IOLoop();
+
+    // Writes <texture>.vt, every level of the texture cut into bordered pages
+    static bool CookPages(const VirtualTextureInfo& info);
+    static bool ReadPage(const PageRequest& request, vector<uint8_t>& texels);
+    static string GetPagePath(const string& fileLocation, uint32_t flags);
+};
@@ -52,7 +52,7 @@ GLFWwindow* Window::Initialise(string windowName)
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    // MultiSampling Anti Aliasing
+    // MultiSampling Anti Aliasing. Not on the window, the HDR target does it (and post-processing FXAA or SMAA)
     //glfwWindowHint(GLFW_SAMPLES, 1);
 
     // Create the window
@@ -88,7 +88,7 @@ GLFWwindow* Window::Initialise(string windowName)
 
     glEnable(GL_DEPTH_TEST);
 
-    // Enables MSAA
+    // Enables MSAA, on by default in a core profile
     //glEnable(GL_MULTISAMPLE);
 
     // Create Viewport
@@ -20,15 +20,28 @@
 #include "Config.h"
 #include "Mesh.h"
 #include "Shader.h"
+#include "ShaderVariants.h"
+#include "PerDrawBuffer.h"
 #include "Window.h"
 #include "Camera.h"
 #include "Texture.h"
+#include "TextureLoader.h"
+#include "TextureStreamer.h"
+#include "VirtualTexture.h"
 #include "DirectionalLight.h"
 #include "PointLight.h"
 #include "SpotLight.h"
 #include "Material.h"
 #include "Model.h"
+#include "ModelLoader.h"
+#include "CullView.h"
 #include "SkyBox.h"
+#include "HDR.h"
+#include "PostProcessing.h"
+#include "GpuTimer.h"
+#include "DynamicResolution.h"
+#include "AntiAliasingBenchmark.h"
+#include "AssetPack.h"
 
 
 using std::cerr;
@@ -53,22 +66,77 @@ float triIncrement = 0.0005f;
 float currentAngle = 0.0f;
 
 float gamma = 2.2f;
+float exposure = 1.0f;
 
-// Getting the Uniforms (Shaders variables)
-// The camera matrices from the shaders
-GLuint uniformProjection = 0, uniformModel = 0, uniformView = 0;
+// Hashed at compile time, the setters only do a table lookup
+static constexpr UniformID UNIFORM_FEEDBACK_BIAS("feedbackBias");
+
+// Global permutation settings for the main shader
+bool shadowsEnabled = true;
+uint32_t pcfKernelSize = 3;
+
+// Curve the HDR target is resolved with
+uint32_t toneMapMode = TONEMAP_REINHARD;
 
+// Getting the Uniforms (Shaders variables)
 // Light uniforms
 GLuint uniformEyePosition = 0, uniformSpecularIntensity = 0, uniformShininess = 0,
 uniformOmniLightPos = 0, uniformFarPlane = 0;
 
 vector<Mesh *> meshList;
-vector<Shader> shaderList;
+
+// Main shader permutations, picked per draw in the Render Pass
+ShaderVariants mainShaderVariants;
+Shader* currentMainShader = nullptr;
+bool renderingMainPass = false;
+
+// Per-draw matrices of the frame, indexed by the draws of RenderScene()
+PerDrawBuffer perDrawBuffer;
+
+enum SceneDraw
+{
+	DRAW_FLOOR,
+	DRAW_SPONZA,
+	DRAW_ROOM,
+	DRAW_BRIAR,
+	DRAW_FORMULA1,
+	DRAW_COUNT
+};
+
+uint32_t sceneDraws[DRAW_COUNT];
+
+// What each pass sees this frame, the models keep the clusters visible in every one
+enum SceneCullView
+{
+	CULL_VIEW_CAMERA,
+	CULL_VIEW_DIRECTIONAL_SHADOW,
+	CULL_VIEW_OMNI_SHADOWS		// One per point light, then one per spot light
+};
+
+vector<CullView> cullViews;
 
 Shader directionalShadowShader;
 Shader omniShadowShader;
-Shader postShader;
 Shader framebufferShader;
+Shader virtualFeedbackShader;
+
+// Linear lighting of the Render Pass, tone mapped in the Post Processing Pass
+HDR hdrBuffer;
+PostProcessStack postStack;
+
+// Points of the frame timed on the GPU, they feed the dynamic resolution
+enum GpuMarker
+{
+	GPU_MARK_FRAME_START,
+	GPU_MARK_SCENE_START,		// The Render Pass, the part that scales with the resolution
+	GPU_MARK_SCENE_END,
+	GPU_MARK_FRAME_END,
+	GPU_MARK_COUNT
+};
+
+GpuTimer gpuTimer;
+DynamicResolution dynamicResolution;
+AntiAliasingBenchmark aaBenchmark;
 
 
 Texture obamiumTexture;
@@ -94,16 +162,17 @@ Model briar;
 Model formula1;
 Model testModel;
 
+// Bound for the draws whose model has no material map of its own
+TextureHandle neutralMaterialMap;
+
 //---------------------------------------------------------------------------
 
 // Vertex Shader
 static const char *vShader = "Shaders/shader.vert";
-//static const char *vShader = "Shaders/normal.vert";
 //static const char *vShader = "Shaders/default.vert";
 
-// Fragment Shader
+// Fragment Shader (Normal Mapping is a permutation of it now)
 static const char *fShader = "Shaders/shader.frag";
-//static const char *fShader = "Shaders/normal.frag";
 //static const char *fShader = "Shaders/default.frag";
 
 // Geometry Shader
@@ -134,21 +203,139 @@ void CreateObjects()
 
 void CreateShaders()
 {
-	Shader *_shader = new Shader();
-	_shader->CreateFromFile(vShader, fShader);
-	//_shader->CreateFromFile(vShader, gShader, fShader);
-	shaderList.push_back(*_shader);
+	// Everything below is only submitted, the driver compiles it in the background
+	Shader::EnableParallelCompile();
+
+	// The variants are compiled on demand from this source
+	mainShaderVariants = ShaderVariants(vShader, fShader);
 
 	framebufferShader.CreateFromFile("Shaders/framebuffer.vert", "Shaders/framebuffer.frag");
 
 	directionalShadowShader.CreateFromFile("Shaders/directional_shadow_map.vert", "Shaders/directional_shadow_map.frag");
 	omniShadowShader.CreateFromFile("Shaders/omni_shadow_map.vert", "Shaders/omni_shadow_map.geo", "Shaders/omni_shadow_map.frag");
-	postShader.CreateFromFile("Shaders/post-processing.vert", "Shaders/post-processing.frag");
+
+	// The per-pixel effects are fused into one generated pass from this template
+	postStack.Init("Shaders/post-processing.vert", "Shaders/post-processing.frag");
+	postStack.AddEffect(POST_EXPOSURE);
+	postStack.AddEffect(POST_TONE_MAP);
+	postStack.AddEffect(POST_COLOR_GRADING);
+	postStack.AddEffect(POST_VIGNETTE);
+	postStack.AddEffect(POST_GAMMA);
+
+	// FXAA or SMAA on the gamma corrected image, nothing for the MSAA modes
+	postStack.AddEffect(POST_ANTI_ALIASING);
+
+	// Only runs while the scene is drawn smaller than the window
+	postStack.SetUpscalePass("Shaders/upscale.frag");
+	virtualFeedbackShader.CreateFromFile("Shaders/virtual_feedback.vert", "Shaders/virtual_feedback.frag");
 	// PBRshader.CreateFromFile("Shaders/PBR.vert", "Shaders/PBR.frag");
 }
 
-void RenderScene()
+ShaderFeatures GetMainShaderFeatures(bool normalMapped)
+{
+	ShaderFeatures features;
+	features.pointLightCount = pointLightCount;
+	features.spotLightCount = spotLightCount;
+	features.shadows = shadowsEnabled;
+	features.normalMapping = normalMapped;
+	features.pcfKernelSize = pcfKernelSize;
+
+	return features;
+}
+
+// Cheap permutation drawn while the real one is still compiling
+ShaderFeatures GetFallbackShaderFeatures()
+{
+	ShaderFeatures features = GetMainShaderFeatures(false);
+	features.shadows = false;
+	features.pcfKernelSize = 1;
+
+	return features;
+}
+
+// Submits the permutations the scene starts with, so they compile while the rest loads
+void WarmMainShaderVariants()
+{
+	mainShaderVariants.GetVariant(GetFallbackShaderFeatures());
+	mainShaderVariants.GetVariant(GetMainShaderFeatures(false));
+	mainShaderVariants.GetVariant(GetMainShaderFeatures(true));
+}
+
+// Sets everything that stays the same during the frame on the bound variant
+void SetMainShaderFrameState(Shader* shader)
+{
+	// Model, normal and MVP matrices come from the per-draw buffer
+	uniformEyePosition = shader->GetEyePositionLocation();
+	uniformSpecularIntensity = shader->GetSpecularIntensityLocation();
+	uniformShininess = shader->GetShininessLocation();
+
+	// Attaching the camera position to the Eye Position for the shaders
+	glUniform3f(uniformEyePosition, camera.getCameraPosition().x, camera.getCameraPosition().y, camera.getCameraPosition().z);
+
+	// Setting up the Light. The omni shadow maps start after the Normal Map unit
+	shader->SetDirectionalLight(&ambientLight);
+	shader->SetPointLights(pointLights, pointLightCount, 4, 0);
+	shader->SetSpotLights(spotLights, spotLightCount, 4 + pointLightCount, pointLightCount);
+	shader->SetDirectionalLightTransform(&ambientLight.CalculateLightTransform());
+
+	// ID of the Texture (It's by default 0 :D)
+	shader->SetTexture(1);
+
+	// ID of the Shadow Map Texture
+	shader->SetDirectionalShadowMap(2);
+
+	// ID of the Normal Map
+	shader->SetNormalMap(3);
+
+	// Texture arrays of the models that have them
+	shader->SetTextureArrays(ALBEDO_ARRAY_UNIT, NORMAL_ARRAY_UNIT);
+
+	// Page table and page cache of the virtual textures
+	shader->SetVirtualTexture(VIRTUAL_TABLE_UNIT, VIRTUAL_CACHE_UNIT);
+
+	// Packed occlusion, roughness, metalness and height
+	shader->SetMaterialMaps(MATERIAL_MAP_UNIT, MATERIAL_ARRAY_UNIT);
+}
+
+// Binds the main shader permutation for the next draw. Does nothing outside the Render Pass
+void SelectMainShader(bool normalMapped)
+{
+	if (!renderingMainPass) return;
+
+	Shader* variant = mainShaderVariants.GetVariant(GetMainShaderFeatures(normalMapped));
+
+	// UseShader() waits for the fallback if even that one isn't done
+	if (!variant->IsReady())
+	{
+		variant = mainShaderVariants.GetVariant(GetFallbackShaderFeatures());
+	}
+
+	if (variant == currentMainShader) return;
+
+	currentMainShader = variant;
+	currentMainShader->UseShader();
+	SetMainShaderFrameState(currentMainShader);
+}
+
+// Fills the model, normal and MVP matrices of every draw, once per frame
+void UpdateSceneDraws(glm::mat4 viewProjection)
 {
+	perDrawBuffer.BeginFrame();
+
+	cullViews.clear();
+	cullViews.push_back(CullView::FromPerspective(viewProjection, camera.getCameraPosition()));
+	cullViews.push_back(CullView::FromOrthographic(ambientLight.CalculateLightTransform(), ambientLight.GetDirection()));
+
+	for (size_t i = 0; i < pointLightCount; i++)
+	{
+		cullViews.push_back(CullView::FromSphere(pointLights[i].GetPosition(), pointLights[i].GetFarPlane()));
+	}
+
+	for (size_t i = 0; i < spotLightCount; i++)
+	{
+		cullViews.push_back(CullView::FromSphere(spotLights[i].GetPosition(), spotLights[i].GetFarPlane()));
+	}
+
 	// Defining the model matrix for the models
 	glm::mat4 model(1.0f);
 
@@ -156,11 +343,7 @@ void RenderScene()
 	model = glm::mat4(1.0f);
 	model = glm::translate(model, glm::vec3(0.0f, -2.0f, 0.0f));
 	model = glm::rotate(model, 90 * toRadians, glm::vec3(0.0f, 1.0f, 0.0f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	floorTexture.UseTexture();
-	//plainTexture.UseTexture();
-	dullMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	meshList[0]->RenderMesh();
+	sceneDraws[DRAW_FLOOR] = perDrawBuffer.AddDraw(model, viewProjection);
 
 	// Adding the SPONZA model
 	model = glm::mat4(1.0f);
@@ -168,9 +351,10 @@ void RenderScene()
 	model = glm::scale(model, glm::vec3(0.01f, 0.01f, 0.01f));
 	model = glm::rotate(model, 90 * toRadians, glm::vec3(0.0f, 1.0f, 0.0f));
 	// model = glm::rotate(model, 90 * toRadians, glm::vec3(1.0f, 0.0f, 0.0f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	dullMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	//sponza.RenderModel();
+	sceneDraws[DRAW_SPONZA] = perDrawBuffer.AddDraw(model, viewProjection);
+	sponza.AddDraws(perDrawBuffer, model, viewProjection);
+	sponza.UpdateStreaming(model, camera.getCameraPosition(), glm::radians(CAMERA_FOV), mainWindow.getBufferHeight());
+	sponza.CullClusters(model, cullViews);
 
 	// Adding the Room
 	model = glm::mat4(1.0f);
@@ -178,9 +362,10 @@ void RenderScene()
 	model = glm::scale(model, glm::vec3(0.5f, 0.5f, 0.5f));
 	// model = glm::rotate(model, 90 * toRadians, glm::vec3(1.0f, 0.0f, 0.0f));
 	//   model = glm::rotate(model, 90 * toRadians, glm::vec3(1.0f, 0.0f, 0.0f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	dullMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	//room.RenderModel();
+	sceneDraws[DRAW_ROOM] = perDrawBuffer.AddDraw(model, viewProjection);
+	room.AddDraws(perDrawBuffer, model, viewProjection);
+	room.UpdateStreaming(model, camera.getCameraPosition(), glm::radians(CAMERA_FOV), mainWindow.getBufferHeight());
+	room.CullClusters(model, cullViews);
 
 	// Adding the Briar
 	model = glm::mat4(1.0f);
@@ -188,9 +373,10 @@ void RenderScene()
 	model = glm::scale(model, glm::vec3(0.01f, 0.01f, 0.01f));
 	//model = glm::rotate(model, 90 * toRadians, glm::vec3(1.0f, 0.0f, 0.0f));
 	//  model = glm::rotate(model, 90 * toRadians, glm::vec3(1.0f, 0.0f, 0.0f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	//dullMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	//briar.RenderModel();
+	sceneDraws[DRAW_BRIAR] = perDrawBuffer.AddDraw(model, viewProjection);
+	briar.AddDraws(perDrawBuffer, model, viewProjection);
+	briar.UpdateStreaming(model, camera.getCameraPosition(), glm::radians(CAMERA_FOV), mainWindow.getBufferHeight());
+	briar.CullClusters(model, cullViews);
 
 	// Adding Formula 1 Ferrari
 	// currentAngle += 0.01f;
@@ -205,12 +391,57 @@ void RenderScene()
 	// model = glm::rotate(model, 90 * toRadians, glm::vec3(0.0f, 1.0f, 0.0f));
 	model = glm::rotate(model, currentAngle * toRadians, glm::vec3(0.0f, 0.5f, 0.0f));
 	//   model = glm::rotate(model, 90 * toRadians, glm::vec3(1.0f, 0.0f, 0.0f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	veryShinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	formula1.RenderModel();
+	sceneDraws[DRAW_FORMULA1] = perDrawBuffer.AddDraw(model, viewProjection);
+	formula1.AddDraws(perDrawBuffer, model, viewProjection);
+	formula1.UpdateStreaming(model, camera.getCameraPosition(), glm::radians(CAMERA_FOV), mainWindow.getBufferHeight());
+	formula1.CullClusters(model, cullViews);
 
-	// Normal Map
-	shaderList[0].setMat4("model", model);
+	perDrawBuffer.Upload();
+}
+
+void RenderScene(int32_t cullView)
+{
+	// // Addind the Floor
+	SelectMainShader(false);
+	if (perDrawBuffer.BindDraw(sceneDraws[DRAW_FLOOR]))
+	{
+		floorTexture.UseTexture();
+		//plainTexture.UseTexture();
+		dullMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
+		meshList[0]->RenderMesh();
+	}
+
+	// Adding the SPONZA model
+	SelectMainShader(sponza.HasNormalMaps());
+	if (perDrawBuffer.BindDraw(sceneDraws[DRAW_SPONZA]))
+	{
+		dullMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
+		//sponza.RenderModel(cullView);
+	}
+
+	// Adding the Room
+	SelectMainShader(room.HasNormalMaps());
+	if (perDrawBuffer.BindDraw(sceneDraws[DRAW_ROOM]))
+	{
+		dullMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
+		//room.RenderModel(cullView);
+	}
+
+	// Adding the Briar
+	SelectMainShader(briar.HasNormalMaps());
+	if (perDrawBuffer.BindDraw(sceneDraws[DRAW_BRIAR]))
+	{
+		//dullMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
+		//briar.RenderModel(cullView);
+	}
+
+	// Adding Formula 1 Ferrari
+	SelectMainShader(formula1.HasNormalMaps());
+	if (perDrawBuffer.BindDraw(sceneDraws[DRAW_FORMULA1]))
+	{
+		veryShinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
+		formula1.RenderModel(cullView);
+	}
 }
 
 void DirectionalShadowMapPass(DirectionalLight* light)
@@ -226,31 +457,27 @@ void DirectionalShadowMapPass(DirectionalLight* light)
 	// Clearing the info already in the Depth Buffer
 	glClear(GL_DEPTH_BUFFER_BIT);
 
-	// Getting the model location fom the Shader
-	uniformModel = directionalShadowShader.GetModelLocation();
-
 	// Calculate the Transform
 	directionalShadowShader.SetDirectionalLightTransform(&light->CalculateLightTransform());
 
 	// Validates the shader
 	directionalShadowShader.Validate();
 
-	RenderScene();
+	RenderScene(CULL_VIEW_DIRECTIONAL_SHADOW);
 
 	// Unbind for the regular Render Pass;
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
 }
 
-void OmniShadowMapPass(PointLight* light)
+void OmniShadowMapPass(PointLight* light, int32_t cullView)
 {
 	// Setting the framebuffer as the same size of the Viewport
 	glViewport(0, 0, light->GetShadowMap()->GetShadowWidth(), light->GetShadowMap()->GetShadowHeight());
 
 	omniShadowShader.UseShader();
 
-	// Getting the model location fom the Shader
-	uniformModel = omniShadowShader.GetModelLocation();
+	// Getting the light locations fom the Shader
 	uniformOmniLightPos = omniShadowShader.GetOmniLightPosLocation();
 	uniformFarPlane = omniShadowShader.GetFarPlaneLocation();
 
@@ -267,82 +494,85 @@ void OmniShadowMapPass(PointLight* light)
 	// Validates the shader
 	omniShadowShader.Validate();
 
-	RenderScene();
+	RenderScene(cullView);
 
 	// Unbind for the regular Render Pass;
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void RenderPass(glm::mat4 projectionMatrix, glm::mat4 viewMatrix)
+// Low resolution render of the virtual pages each pixel wants, read back by VirtualTexture::Update()
+void VirtualTextureFeedbackPass()
 {
-	// Resseting the viewport
-	glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+	if (!VirtualTexture::IsRunning()) return;
 
-	// Clear the screen with a specific color
-	glClearColor(pow(0.63f, 1.0f / gamma), pow(0.75f, 1.0f / gamma), pow(0.90f, 1.0f / gamma), 1.0f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-	// Rendering the Skybox
-	skybox.DrawSkybox(viewMatrix, projectionMatrix);
+	virtualFeedbackShader.UseShader();
+	virtualFeedbackShader.setFloat(UNIFORM_FEEDBACK_BIAS, VirtualTexture::GetFeedbackBias());
 
-	// Make shure we are using the right shader
-	shaderList[0].UseShader();
+	VirtualTexture::BeginFeedback();
 
-	// Use the shader program for rendering
-	uniformModel = shaderList[0].GetModelLocation();
-	uniformProjection = shaderList[0].GetProjectionLocation();
-	uniformView = shaderList[0].GetViewLocation();
-	uniformEyePosition = shaderList[0].GetEyePositionLocation();
-	uniformSpecularIntensity = shaderList[0].GetSpecularIntensityLocation();
-	uniformShininess = shaderList[0].GetShininessLocation();
+	RenderScene(CULL_VIEW_CAMERA);
 
-	// Setting the Projection Matrix
-	glUniformMatrix4fv(uniformProjection, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+	// Also unbinds the feedback framebuffer
+	VirtualTexture::EndFeedback();
+}
 
-	// Setting the View Matrix
-	glUniformMatrix4fv(uniformView, 1, GL_FALSE, glm::value_ptr(viewMatrix));
+void RenderPass(glm::mat4 projectionMatrix, glm::mat4 viewMatrix)
+{
+	// Lighting goes into the HDR target, also sets its viewport
+	hdrBuffer.Write();
 
-	// Attaching the camera position to the Eye Position for the shaders
-	glUniform3f(uniformEyePosition, camera.getCameraPosition().x, camera.getCameraPosition().y, camera.getCameraPosition().z);
+	// Clear the screen with a specific color, linear like the rest of the target
+	glClearColor(0.63f, 0.75f, 0.90f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	// Setting up the Light
-	shaderList[0].SetDirectionalLight(&ambientLight);
-	shaderList[0].SetPointLights(pointLights, pointLightCount, 3, 0);
-	shaderList[0].SetSpotLights(spotLights, spotLightCount, 3 + pointLightCount, pointLightCount);
-	shaderList[0].SetDirectionalLightTransform(&ambientLight.CalculateLightTransform());
+	// Rendering the Skybox
+	skybox.DrawSkybox(viewMatrix, projectionMatrix);
 
 	// Setting shadow map
 	ambientLight.GetShadowMap()->Read(GL_TEXTURE2);
 
-	// ID of the Texture (It's by default 0 :D)
-	shaderList[0].SetTexture(1);
+	VirtualTexture::UseTextures(VIRTUAL_TABLE_UNIT, VIRTUAL_CACHE_UNIT);
 
-	// ID of the Shadow Map Texture
-	shaderList[0].SetDirectionalShadowMap(2);
-
-	// ID of the Shadow Map
-	shaderList[0].SetNormalMap(3);
+	if (neutralMaterialMap) neutralMaterialMap->UseGL_TEXTURE(MATERIAL_MAP_UNIT);
 
 	// Setting the flashlight
 	// glm::vec3 lowerLight = camera.getCameraPosition();
 	// lowerLight.y -= 0.5f;
 	// spotLights[0].SetFlash(lowerLight, camera.getCameraDirection());
 
-	shaderList[0].Validate();
+	// The variant is picked per draw, and the frame state is set when it gets bound
+	currentMainShader = nullptr;
+	renderingMainPass = true;
 
-	// shaderList[1].UseShader();
-	// shaderList[1].SetNormalMap(3);
-	// shaderList[1].Validate();
+	RenderScene(CULL_VIEW_CAMERA);
 
-	RenderScene();
+	renderingMainPass = false;
 
+	// The samples into the texture post-processing reads
+	hdrBuffer.Resolve();
+}
+
+// Post-processing passes for FXAA and SMAA, multisampled HDR target for MSAA
+void SetAntiAliasing(AntiAliasingMode mode)
+{
+	postStack.settings.antiAliasing = mode;
+	hdrBuffer.SetSamples(GetAntiAliasingSamples(mode));
 }
 
+// Runs the post-processing stack from the HDR target to the screen
 void PostProcessingPass()
 {
-	shaderList[0].UseShader();
-	shaderList[0].setInt("screenTexture", 0);
-	shaderList[0].setFloat("gamma", gamma);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	postStack.settings.gamma = gamma;
+	postStack.settings.exposure = exposure;
+	postStack.settings.toneMapMode = toneMapMode;
+
+	glm::uvec2 textureSize(hdrBuffer.GetWidth(), hdrBuffer.GetHeight());
+	glm::uvec2 renderSize(hdrBuffer.GetRenderWidth(), hdrBuffer.GetRenderHeight());
+	glm::uvec2 windowSize(mainWindow.getBufferWidth(), mainWindow.getBufferHeight());
+
+	postStack.Render(hdrBuffer.GetColourBuffer(), textureSize, renderSize, windowSize);
 }
 
 // Main function for the OpenGL application
@@ -357,6 +587,9 @@ int main()
 	cerr << "--------------------------------------------------------\n\n" << endl;
 	cerr << "Loading..." << endl;
 
+	// Every loader looks in the pack first, loose files when there's no pack
+	AssetPack::Open(ASSET_PACK_FILE);
+
 	// Create the main window
 	windowName = "MOAI Engine | Loading...";
 	mainWindow = Window(WINDOW_WIDTH, WINDOW_HEIGHT);
@@ -369,6 +602,31 @@ int main()
 	CreateObjects();
 	CreateShaders();
 
+	perDrawBuffer.Init(MAX_DRAWS_PER_FRAME);
+
+	// Same size as the window, the dynamic resolution only uses a smaller corner of it
+	hdrBuffer.Init(mainWindow.getBufferWidth(), mainWindow.getBufferHeight());
+	dynamicResolution.Init(mainWindow.getBufferWidth(), mainWindow.getBufferHeight());
+	SetAntiAliasing((AntiAliasingMode)ANTI_ALIASING);
+	gpuTimer.Init(GPU_MARK_COUNT);
+
+	// Model textures are decoded on worker threads from here on
+	TextureLoader::Init();
+
+	// White occlusion, no roughness, no metal
+	neutralMaterialMap = TextureRegistry::LoadSolid(255, 0, 0, 0);
+
+	// Model textures only get their small levels up front, the rest follows the camera
+	TextureStreamer::Init((size_t)TEXTURE_STREAMING_BUDGET_MB * 1024 * 1024);
+
+	if (VT_ENABLED)
+	{
+		VirtualTexture::Init(WINDOW_WIDTH, WINDOW_HEIGHT);
+	}
+
+	// Model imports, and the meshes inside each one, run on these
+	JobSystem::Init();
+
 	// Define the Camera
 	camera = Camera(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, 0.0f, 5.0f, 0.2f);
 
@@ -377,7 +635,7 @@ int main()
 	// obamiumTexture.LoadTextureA();
 
 	floorTexture = Texture("Assets/Textures/ground_01.png");
-	floorTexture.LoadTexture();
+	floorTexture.LoadCookedTexture(0);
 
 	// plainTexture = Texture("Assets/Textures/plain.png");
 	// plainTexture.LoadTextureA();
@@ -387,21 +645,21 @@ int main()
 	shinyMaterial = Material(0.5f, 32);
 	dullMaterial = Material(0.05f, 2);
 
-	// Setting the models
+	// Setting the models, each one is imported on its own job and shows up once its meshes are uploaded
 	sponza = Model();
-	//sponza.LoadModel("Assets/Models/Sponza/sponza.obj", "sponza");
+	//ModelLoader::Request(&sponza, "Assets/Models/Sponza/sponza.obj", "sponza", false);
 
 	room = Model();
-	//room.LoadModel("Assets/Models/Room/living_room.obj", "room");
+	//ModelLoader::Request(&room, "Assets/Models/Room/living_room.obj", "room", false);
 
 	briar = Model();
-	//briar.LoadModel("Assets/Models/Briar/scene.gltf", "briar");
+	//ModelLoader::Request(&briar, "Assets/Models/Briar/scene.gltf", "briar", false);
 
 	formula1 = Model();
-	formula1.LoadModel("Assets/Models/FF1/f1.fbx", "ff1");
+	ModelLoader::Request(&formula1, "Assets/Models/FF1/f1.fbx", "ff1", false);
 	
 	testModel = Model();
-	//testModel.LoadModel("Assets/Models/TestModel/scene.gltf", "testModel");
+	//ModelLoader::Request(&testModel, "Assets/Models/TestModel/scene.gltf", "testModel", false);
 
 	ambientLight = DirectionalLight(2048, 2048,				// Shadow Buffer (width, height)
 									1.0f, 1.0f, 1.0f,		// RGB Color
@@ -466,6 +724,9 @@ int main()
 	// 						  20.0f);
 	// spotLightCount++;
 
+	// The light counts are part of the permutation key
+	WarmMainShaderVariants();
+
 	vector<string> skyboxFaces;
 	skyboxFaces.push_back("Assets/Textures/Skybox/Custom1/right.jpg"); // POS X | Right
 	skyboxFaces.push_back("Assets/Textures/Skybox/Custom1/left.jpg"); // NEG X | Left
@@ -479,7 +740,7 @@ int main()
 		   uniformSpecularIntensity = 0, uniformShininess = 0;
 
 	// Setting Projection matrix
-	glm::mat4 projection = glm::perspective(glm::radians(60.0f), (GLfloat)mainWindow.getBufferWidth() / mainWindow.getBufferHeight(), 0.1f, 100.0f);
+	glm::mat4 projection = glm::perspective(glm::radians(CAMERA_FOV), (GLfloat)mainWindow.getBufferWidth() / mainWindow.getBufferHeight(), 0.1f, 100.0f);
 	// shaderList[0].UseShader();
 	// shaderList[0].setMat4("projection", projection);
 
@@ -498,7 +759,8 @@ int main()
 	// Keeps track of the amount of frames in timeDiff
 	unsigned int counter = 0;
 
-	cerr << "\nLoading complete!\n\n" << endl;
+	cerr << "\nStarting the render loop, the models keep loading in the background\n" << endl;
+	bool firstFrame = true;
 	// Render loop: keeps the window open until the user closes it
 	while (!mainWindow.getShouldClose())
 	{
@@ -521,6 +783,41 @@ int main()
 			string FPS = std::to_string((1.0 / timeDiff) * counter);
 			string ms = std::to_string((timeDiff / counter) * 1000);
 			newTitle = newTitle + " | " + FPS.substr(0, 4) + " FPS | " + ms.substr(0, 4) + " ms";
+
+			if (TextureStreamer::IsRunning())
+			{
+				TextureStreamingStats streaming = TextureStreamer::GetStats();
+				newTitle = newTitle + " | Textures: " + std::to_string(streaming.residentBytes / (1024 * 1024)) + "/" +
+					std::to_string(streaming.budgetBytes / (1024 * 1024)) + " MB, " + std::to_string(streaming.pendingRequests) + " streaming";
+			}
+
+			// Clusters the camera kept out of all of them
+			Model* models[] = { &sponza, &room, &briar, &formula1 };
+			uint32_t visibleClusters = 0, totalClusters = 0;
+
+			for (Model* sceneModel : models)
+			{
+				visibleClusters += sceneModel->GetVisibleClusterCount(CULL_VIEW_CAMERA);
+				totalClusters += sceneModel->GetClusterCount();
+			}
+
+			if (totalClusters > 0)
+			{
+				newTitle = newTitle + " | Clusters: " + std::to_string(visibleClusters) + "/" + std::to_string(totalClusters);
+			}
+
+			if (DYNAMIC_RESOLUTION)
+			{
+				string gpuMs = std::to_string(dynamicResolution.GetFrameMs());
+				newTitle = newTitle + " | GPU: " + gpuMs.substr(0, 4) + " ms at " + std::to_string((int)(dynamicResolution.GetScale() * 100.0f + 0.5f)) + "%";
+			}
+
+			newTitle = newTitle + " | AA: " + GetAntiAliasingName(postStack.settings.antiAliasing);
+			if (aaBenchmark.IsRunning()) newTitle = newTitle + " (benchmark)";
+
+			string loadingStatus = ModelLoader::GetStatus();
+			if (!loadingStatus.empty()) newTitle = newTitle + " | " + loadingStatus;
+
 			glfwSetWindowTitle(mainWindowReference, newTitle.c_str());
 
 			// Resets times and counter
@@ -555,25 +852,128 @@ int main()
 		    gamma += 0.001f;
 		}
 
+		// Next antialiasing mode
+		if (mainWindow.getsKeys()[GLFW_KEY_KP_4] && !aaBenchmark.IsRunning())
+		{
+			SetAntiAliasing((AntiAliasingMode)((postStack.settings.antiAliasing + 1) % AA_MODE_COUNT));
+			mainWindow.getsKeys()[GLFW_KEY_KP_4] = false;
+		}
+
+		// Times every mode, the table goes to the console
+		if (mainWindow.getsKeys()[GLFW_KEY_KP_5] && !aaBenchmark.IsRunning())
+		{
+			aaBenchmark.Start(postStack.settings.antiAliasing, mainWindow.getBufferWidth(), mainWindow.getBufferHeight());
+			SetAntiAliasing(aaBenchmark.GetMode());
+			mainWindow.getsKeys()[GLFW_KEY_KP_5] = false;
+		}
+
+		// A few finished images a frame, so streaming them in doesn't hitch
+		TextureLoader::ProcessUploads(TEXTURE_UPLOADS_PER_FRAME);
+
+		// Meshes of the models imported so far, a few a frame too
+		ModelLoader::Update(MODEL_UPLOAD_MESHES_PER_FRAME);
+
+		glm::mat4 viewMatrix = camera.calculateViewMatrix();
+
+		// Every pass reads the same per-draw matrices
+		UpdateSceneDraws(projection * viewMatrix);
+
+		// Uploads the levels read since last frame and asks for the ones wanted above
+		TextureStreamer::Update();
+
+		// Pages asked for by the feedback of a few frames ago
+		VirtualTexture::Update();
+
+		// Scale of the Render Pass, from the frames the GPU finished so far
+		vector<double> gpuMarks;
+
+		if (gpuTimer.ReadFrame(gpuMarks))
+		{
+			double sceneMs = gpuMarks[GPU_MARK_SCENE_END] - gpuMarks[GPU_MARK_SCENE_START];
+
+			// The benchmark holds the scale, so the modes are timed on the same pixels
+			if (aaBenchmark.IsRunning())
+			{
+				aaBenchmark.AddFrame(sceneMs, gpuMarks[GPU_MARK_FRAME_END] - gpuMarks[GPU_MARK_SCENE_END], gpuMarks[GPU_MARK_FRAME_END]);
+				SetAntiAliasing(aaBenchmark.GetMode());
+			}
+			else
+			{
+				dynamicResolution.Update(gpuMarks[GPU_MARK_FRAME_END], sceneMs);
+			}
+		}
+
+		if (aaBenchmark.IsRunning())
+		{
+			hdrBuffer.SetRenderSize(hdrBuffer.GetWidth(), hdrBuffer.GetHeight());
+		}
+		else
+		{
+			hdrBuffer.SetRenderSize(dynamicResolution.GetRenderWidth(), dynamicResolution.GetRenderHeight());
+		}
+
+		gpuTimer.BeginFrame();
+		gpuTimer.Mark(GPU_MARK_FRAME_START);
+
 		DirectionalShadowMapPass(&ambientLight);
 
 		for( size_t i = 0; i < pointLightCount; i++ )
 		{
-			OmniShadowMapPass(&pointLights[i]);
+			OmniShadowMapPass(&pointLights[i], CULL_VIEW_OMNI_SHADOWS + (int32_t)i);
 		}
 
 		for (size_t i = 0; i < spotLightCount; i++)
 		{
-			OmniShadowMapPass(&spotLights[i]);
+			OmniShadowMapPass(&spotLights[i], CULL_VIEW_OMNI_SHADOWS + (int32_t)(pointLightCount + i));
 		}
 
-		RenderPass(projection, camera.calculateViewMatrix());
+		VirtualTextureFeedbackPass();
+
+		gpuTimer.Mark(GPU_MARK_SCENE_START);
+		RenderPass(projection, viewMatrix);
+		gpuTimer.Mark(GPU_MARK_SCENE_END);
+
 		PostProcessingPass();
+		gpuTimer.Mark(GPU_MARK_FRAME_END);
+
+		perDrawBuffer.EndFrame();
 
 		// Swap the front and back buffers to display the rendered frame
 		mainWindow.swapBuffers();
+
+		if (firstFrame)
+		{
+			cerr << "First frame after " << glfwGetTime() << " s" << endl;
+			firstFrame = false;
+		}
 	}
 
+	// The buffer is still mapped, release it while the context exists
+	perDrawBuffer.ClearBuffer();
+	gpuTimer.ClearTimer();
+	hdrBuffer.ClearBuffer();
+	postStack.Clear();
+
+	// Imports still running write into the models
+	ModelLoader::Shutdown();
+
+	// Stops the decode and streaming threads before the textures go away
+	VirtualTexture::Shutdown();
+	TextureStreamer::Shutdown();
+	TextureLoader::Shutdown();
+	JobSystem::Shutdown();
+
+	// Drops the texture handles, the last one out frees the GL texture
+	neutralMaterialMap = nullptr;
+	sponza.ClearModel();
+	room.ClearModel();
+	briar.ClearModel();
+	formula1.ClearModel();
+	testModel.ClearModel();
+
+	// Nothing reads from the mapping anymore
+	AssetPack::Close();
+
 	// Terminate GLFW and release its resources
 	glfwTerminate();
 
@@ -0,0 +1,293 @@
+#include <stdint.h>
+#include <iostream>
+#include <vector>
+#include <unordered_set>
+
+#include "VirtualPageTable.h"
+
+using std::cerr;
+using std::endl;
+using std::vector;
+
+/*
+    Checks the virtual texture bookkeeping (VirtualPageTable) without a GL
+    context: region allocation and removal, the feedback decode, the page
+    requests, the LRU of the page cache and the page table entries.
+
+    Returns the number of failed checks, 0 when everything passes.
+*/
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { if (!(condition)) { cerr << __FILE__ << "(" << __LINE__ << "): failed " << #condition << endl; failures++; } } while (0)
+
+// 16x16 level 0 pages, a 2x2 cache so slots 1-3 hold pages
+static const int32_t TABLE_PAGES = 16;
+static const int32_t CACHE_PAGES = 2;
+
+static uint32_t Key(int32_t level, int32_t pageX, int32_t pageY)
+{
+    return VirtualPageTable::MakeKey(level, pageX, pageY);
+}
+
+static uint32_t SlotEntry(int32_t slot, int32_t level)
+{
+    return (uint32_t)(slot % CACHE_PAGES) | ((uint32_t)(slot / CACHE_PAGES) << 8) | ((uint32_t)level << 16) | 0xFF000000;
+}
+
+static uint32_t GetEntry(const VirtualPageTable& table, int32_t level, int32_t pageX, int32_t pageY)
+{
+    return table.GetEntries(level)[(size_t)pageY * (TABLE_PAGES >> level) + pageX];
+}
+
+static void TestRegions()
+{
+    int32_t maxLevel = -1;
+    CHECK(VirtualPageTable::GetPagesAcross(100, 50, 128, 32, maxLevel) == 1 && maxLevel == 0);
+    CHECK(VirtualPageTable::GetPagesAcross(1024, 300, 128, 32, maxLevel) == 8 && maxLevel == 3);
+    CHECK(VirtualPageTable::GetPagesAcross(16384, 16384, 128, 32, maxLevel) == 32 && maxLevel == 5);
+
+    VirtualPageTable table;
+    table.Init(TABLE_PAGES, CACHE_PAGES);
+    CHECK(table.GetLevelCount() == 5);
+
+    int32_t big = table.AddRegion(8, 3);
+    int32_t small = table.AddRegion(2, 1);
+    CHECK(big == 0 && small == 1);
+
+    // Aligned to their size, next to each other
+    const VirtualRegion* bigRegion = table.GetRegion(big);
+    const VirtualRegion* smallRegion = table.GetRegion(small);
+    CHECK(bigRegion && bigRegion->originX == 0 && bigRegion->originY == 0);
+    CHECK(smallRegion && smallRegion->originX == 8 && smallRegion->originY == 0);
+
+    // AddRegion can move the regions
+    uint32_t oldGeneration = bigRegion->generation;
+
+    CHECK(table.GetOwner(Key(0, 7, 7)) == big);
+    CHECK(table.GetOwner(Key(3, 0, 0)) == big);
+    CHECK(table.GetOwner(Key(4, 0, 0)) < 0);
+    CHECK(table.GetOwner(Key(1, 4, 0)) == small);
+    CHECK(table.GetOwner(Key(0, 15, 15)) < 0);
+    CHECK(table.GetOwner(Key(0, 16, 0)) < 0);
+
+    // Three more 8x8 don't fit next to the first one
+    CHECK(table.AddRegion(8, 3) == 2);
+    CHECK(table.AddRegion(8, 3) == 3);
+    CHECK(table.AddRegion(8, 3) < 0);
+    CHECK(table.AddRegion(16, 4) < 0);
+
+    // The space and the id go to the next texture, with a new generation
+    table.RemoveRegion(big);
+    CHECK(table.GetRegion(big) == nullptr);
+    CHECK(table.GetOwner(Key(0, 0, 0)) < 0);
+
+    int32_t reused = table.AddRegion(4, 2);
+    CHECK(reused == big);
+    CHECK(table.GetRegion(reused)->originX == 0 && table.GetRegion(reused)->originY == 0);
+    CHECK(table.GetRegion(reused)->generation != oldGeneration);
+
+    table.RemoveRegion(-1);
+    table.RemoveRegion(100);
+}
+
+static void TestFeedback()
+{
+    VirtualPageTable table;
+    table.Init(TABLE_PAGES, CACHE_PAGES);
+
+    const uint8_t pixels[] =
+    {
+        3, 4, 0, 255,           // Level 0 page (3, 4)
+        3, 4, 0, 255,           // Same page again
+        1, 1, 2, 255,           // Level 2 page (1, 1)
+        9, 9, 0, 0,             // No page
+        4, 0, 2, 255,           // Past the 4x4 pages of level 2
+        0, 0, 9, 255,           // No such level
+        0, 0, 4, 255,           // Last level
+        7, 7                    // Cut off
+    };
+
+    std::unordered_set<uint32_t> keys;
+    table.DecodeFeedback(pixels, sizeof(pixels), keys);
+
+    CHECK(keys.size() == 3);
+    CHECK(keys.count(Key(0, 3, 4)) == 1);
+    CHECK(keys.count(Key(2, 1, 1)) == 1);
+    CHECK(keys.count(Key(4, 0, 0)) == 1);
+}
+
+static void TestRequests()
+{
+    VirtualPageTable table;
+    table.Init(TABLE_PAGES, CACHE_PAGES);
+
+    int32_t texture = table.AddRegion(4, 2);
+    uint32_t generation = table.GetRegion(texture)->generation;
+
+    // Nothing resident, the page and all its parents, coarsest first
+    std::unordered_set<uint32_t> feedback = { Key(0, 3, 2), Key(1, 9, 9) };
+    vector<uint32_t> requests;
+    table.CollectRequests(feedback, 1, 32, requests);
+
+    CHECK(requests.size() == 3);
+    CHECK(requests.size() == 3 && requests[0] == Key(2, 0, 0) && requests[1] == Key(1, 1, 1) && requests[2] == Key(0, 3, 2));
+    CHECK(table.GetPendingPageCount() == 3);
+
+    // Already pending, not asked again
+    requests.clear();
+    table.CollectRequests(feedback, 2, 32, requests);
+    CHECK(requests.empty());
+
+    // The coarse page arrives, the others sharpen from it
+    CHECK(table.PlacePage(Key(2, 0, 0), generation, true, 2) == 1);
+    CHECK(table.GetPendingPageCount() == 2);
+
+    // A failed read can be asked for again
+    CHECK(table.PlacePage(Key(1, 1, 1), generation, false, 2) < 0);
+
+    requests.clear();
+    table.CollectRequests({ Key(1, 1, 1) }, 3, 32, requests);
+    CHECK(requests.size() == 1 && requests[0] == Key(1, 1, 1));
+
+    // Only up to the pending limit
+    requests.clear();
+    table.CollectRequests({ Key(0, 0, 0), Key(0, 2, 0) }, 4, 4, requests);
+    CHECK(requests.size() == 2);
+    CHECK(table.GetPendingPageCount() == 4);
+}
+
+static void TestCache()
+{
+    VirtualPageTable table;
+    table.Init(TABLE_PAGES, CACHE_PAGES);
+
+    int32_t texture = table.AddRegion(4, 2);
+    uint32_t generation = table.GetRegion(texture)->generation;
+
+    vector<uint32_t> requests;
+    table.CollectRequests({ Key(0, 0, 0), Key(0, 1, 0), Key(0, 2, 0), Key(0, 3, 0) }, 1, 32, requests);
+
+    CHECK(table.PlacePage(Key(0, 0, 0), generation, true, 1) == 1);
+    CHECK(table.PlacePage(Key(0, 1, 0), generation, true, 1) == 2);
+    CHECK(table.PlacePage(Key(0, 2, 0), generation, true, 1) == 3);
+
+    // Every page was placed after the latest feedback, nothing can go
+    CHECK(table.PlacePage(Key(0, 3, 0), generation, true, 1) < 0);
+    CHECK(table.GetResidentPageCount() == 3);
+
+    // The next feedback only sees two of them, the third one is the victim
+    requests.clear();
+    table.CollectRequests({ Key(0, 0, 0), Key(0, 2, 0), Key(0, 3, 0) }, 5, 32, requests);
+    CHECK(requests.size() == 1 && requests[0] == Key(0, 3, 0));
+
+    CHECK(table.PlacePage(Key(0, 3, 0), generation, true, 5) == 2);
+    CHECK(table.FindSlot(Key(0, 1, 0)) < 0);
+    CHECK(table.FindSlot(Key(0, 3, 0)) == 2);
+    CHECK(table.FindSlot(Key(0, 0, 0)) == 1);
+    CHECK(table.GetResidentPageCount() == 3);
+}
+
+static void TestEntries()
+{
+    VirtualPageTable table;
+    table.Init(TABLE_PAGES, CACHE_PAGES);
+
+    CHECK(table.UpdateEntries());
+    CHECK(!table.UpdateEntries());
+    CHECK(GetEntry(table, 0, 0, 0) == VirtualPageTable::WHITE_PAGE_ENTRY);
+
+    int32_t texture = table.AddRegion(4, 2);
+    uint32_t generation = table.GetRegion(texture)->generation;
+
+    vector<uint32_t> requests;
+    table.CollectRequests({ Key(0, 1, 1), Key(0, 2, 2) }, 1, 32, requests);
+    CHECK(table.PlacePage(Key(2, 0, 0), generation, true, 1) == 1);
+    CHECK(table.PlacePage(Key(0, 1, 1), generation, true, 1) == 2);
+
+    CHECK(table.UpdateEntries());
+
+    // Resident pages point to their slot, the rest to their closest resident parent
+    CHECK(GetEntry(table, 2, 0, 0) == SlotEntry(1, 2));
+    CHECK(GetEntry(table, 0, 1, 1) == SlotEntry(2, 0));
+    CHECK(GetEntry(table, 0, 2, 2) == SlotEntry(1, 2));
+    CHECK(GetEntry(table, 1, 1, 1) == SlotEntry(1, 2));
+
+    // Outside the texture, and past its last level
+    CHECK(GetEntry(table, 0, 4, 0) == VirtualPageTable::WHITE_PAGE_ENTRY);
+    CHECK(GetEntry(table, 3, 0, 0) == VirtualPageTable::WHITE_PAGE_ENTRY);
+}
+
+static void TestRemove()
+{
+    VirtualPageTable table;
+    table.Init(TABLE_PAGES, CACHE_PAGES);
+
+    int32_t first = table.AddRegion(4, 2);
+    int32_t second = table.AddRegion(4, 2);
+    uint32_t firstGeneration = table.GetRegion(first)->generation;
+    uint32_t secondGeneration = table.GetRegion(second)->generation;
+
+    vector<uint32_t> requests;
+    table.CollectRequests({ Key(0, 0, 0), Key(0, 4, 0) }, 1, 32, requests);
+    CHECK(table.PlacePage(Key(2, 0, 0), firstGeneration, true, 1) == 1);
+    CHECK(table.PlacePage(Key(2, 1, 0), secondGeneration, true, 1) == 2);
+    table.UpdateEntries();
+
+    // Its cached pages, pending pages and entries go, the other texture keeps its own
+    table.RemoveRegion(first);
+
+    CHECK(table.GetResidentPageCount() == 1);
+    CHECK(table.FindSlot(Key(2, 0, 0)) < 0);
+    CHECK(table.FindSlot(Key(2, 1, 0)) == 2);
+    CHECK(table.GetPendingPageCount() == 2);
+
+    CHECK(table.UpdateEntries());
+    CHECK(GetEntry(table, 0, 0, 0) == VirtualPageTable::WHITE_PAGE_ENTRY);
+    CHECK(GetEntry(table, 2, 0, 0) == VirtualPageTable::WHITE_PAGE_ENTRY);
+    CHECK(GetEntry(table, 0, 4, 0) == SlotEntry(2, 2));
+
+    // A page of the removed texture arrives late, after a new one took the space
+    int32_t third = table.AddRegion(4, 2);
+    uint32_t thirdGeneration = table.GetRegion(third)->generation;
+    CHECK(third == first);
+
+    requests.clear();
+    table.CollectRequests({ Key(1, 0, 0) }, 2, 32, requests);
+    CHECK(requests.size() == 2);
+
+    CHECK(table.PlacePage(Key(1, 0, 0), firstGeneration, true, 2) < 0);
+    CHECK(table.FindSlot(Key(1, 0, 0)) < 0);
+
+    // And doesn't cancel the new texture's request for the same page
+    requests.clear();
+    table.CollectRequests({ Key(1, 0, 0) }, 3, 32, requests);
+    CHECK(requests.empty());
+
+    CHECK(table.PlacePage(Key(1, 0, 0), thirdGeneration, true, 3) >= 0);
+    CHECK(table.FindSlot(Key(1, 0, 0)) >= 0);
+
+    // Nothing is left behind
+    table.RemoveRegion(second);
+    table.RemoveRegion(third);
+    CHECK(table.GetResidentPageCount() == 0);
+    CHECK(table.GetPendingPageCount() == 0);
+}
+
+int main()
+{
+    TestRegions();
+    TestFeedback();
+    TestRequests();
+    TestCache();
+    TestEntries();
+    TestRemove();
+
+    if (failures == 0)
+    {
+        cerr << "All virtual texture checks passed" << endl;
+    }
+
+    return failures;
+}